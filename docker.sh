@@ -26,10 +26,7 @@ cp bin/report .
 # Run report
 mkdir reports
 ./report fiber:energy > reports/fiber_energy.txt verbose=0
-./report fiber:energy > reports/fiber_energy_labels.txt
-./report fiber:segment_energy > reports/fiber_segment_curvature.txt
-./report fiber:points > reports/fiber_points.txt
-./report single:position > reports/singles.txt
+./report fiber:energy=reports/fiber_energy_labels.txt fiber:segment_energy=reports/fiber_segment_curvature.txt fiber:points=reports/fiber_points.txt single:position=reports/singles.txt
 
 # Save output filess
 case ${SIMULATION_TYPE} in
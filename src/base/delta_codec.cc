@@ -0,0 +1,213 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "delta_codec.h"
+#include "exceptions.h"
+// avoid the macros defining zlib names, such as `compress`:
+#define MINIZ_NO_ZLIB_COMPATIBLE_NAMES
+#include "miniz.h"
+#include <algorithm>
+#include <cmath>
+
+
+/// encoding of an array
+enum DeltaMode { DELTA_SPACE = 0, DELTA_TIME = 1 };
+
+
+/// write integer `x` with 7 bits per byte, after mapping it to an unsigned value
+static inline void putVarInt(int64_t x, FILE* f)
+{
+    uint64_t u = ( (uint64_t)x << 1 ) ^ (uint64_t)( x >> 63 );
+    while ( u >= 128 )
+    {
+        putc_unlocked((int)( u & 127 ) | 128, f);
+        u >>= 7;
+    }
+    putc_unlocked((int)u, f);
+}
+
+
+/// read integer written by putVarInt()
+static inline int64_t getVarInt(FILE* f)
+{
+    uint64_t u = 0;
+    int s = 0;
+    int c;
+    do {
+        c = getc_unlocked(f);
+        if ( c == EOF || s > 63 )
+            throw InvalidIO("invalid compressed coordinates");
+        u |= (uint64_t)( c & 127 ) << s;
+        s += 7;
+    } while ( c & 128 );
+    return (int64_t)( u >> 1 ) ^ -(int64_t)( u & 1 );
+}
+
+//------------------------------------------------------------------------------
+
+void DeltaCodec::clear()
+{
+    quantum_ = 0;
+    distance_ = 0;
+    valid_ = false;
+    name_.clear();
+    past_.clear();
+    next_.clear();
+    cursor_ = 0;
+}
+
+
+/**
+ A frame that is not a keyframe can only be processed if the previous frame
+ was the one preceding it in the same sequence.
+ */
+void DeltaCodec::begin(size_t dis, real quantum)
+{
+    if ( quantum <= 0 )
+        throw InvalidIO("the precision of compressed coordinates must be > 0");
+
+    if ( dis == 0 )
+        past_.clear();
+    else if ( !valid_ || dis != distance_ + 1 || quantum != quantum_ )
+    {
+        valid_ = false;
+        throw InvalidIO("compressed frame cannot be decoded without the preceding frames");
+    }
+    quantum_ = quantum;
+    distance_ = dis;
+    valid_ = false;
+    next_.clear();
+    cursor_ = 0;
+}
+
+
+void DeltaCodec::end()
+{
+    std::swap(past_, next_);
+    next_.clear();
+    cursor_ = 0;
+    valid_ = true;
+}
+
+
+int64_t const* DeltaCodec::previous(const uint64_t key, const size_t n)
+{
+    std::vector<Record> const& rec = past_.rec;
+    if ( cursor_ >= rec.size() || rec[cursor_].key != key )
+    {
+        // search in the list sorted by key:
+        std::vector<std::pair<uint64_t, size_t>>& srt = past_.sorted;
+        if ( srt.empty() && !rec.empty() )
+        {
+            srt.reserve(rec.size());
+            for ( size_t i = 0; i < rec.size(); ++i )
+                srt.emplace_back(rec[i].key, i);
+            std::sort(srt.begin(), srt.end());
+        }
+        auto i = std::lower_bound(srt.begin(), srt.end(), std::make_pair(key, (size_t)0));
+        if ( i == srt.end() || i->first != key )
+            return nullptr;
+        cursor_ = i->second;
+    }
+    Record const& r = rec[cursor_++];
+    if ( r.size != n )
+        return nullptr;
+    return past_.val.data() + r.start;
+}
+
+
+int64_t* DeltaCodec::current(const uint64_t key, const size_t n)
+{
+    const size_t s = next_.val.size();
+    next_.rec.push_back(Record{key, s, n});
+    next_.val.resize(s+n);
+    return next_.val.data() + s;
+}
+
+
+void DeltaCodec::write(FILE* f, uint64_t key, real const* ptr, size_t cnt, unsigned D)
+{
+    const size_t n = cnt * D;
+    int64_t * val = current(key, n);
+    for ( size_t i = 0; i < n; ++i )
+        val[i] = std::llround(ptr[i] / quantum_);
+
+    int64_t const* old = previous(key, n);
+    if ( old )
+    {
+        putc_unlocked(DELTA_TIME, f);
+        for ( size_t i = 0; i < n; ++i )
+            putVarInt(val[i] - old[i], f);
+    }
+    else
+    {
+        putc_unlocked(DELTA_SPACE, f);
+        for ( size_t i = 0; i < n && i < D; ++i )
+            putVarInt(val[i], f);
+        for ( size_t i = D; i < n; ++i )
+            putVarInt(val[i] - val[i-D], f);
+    }
+
+    if ( ferror(f) )
+        throw InvalidIO("failed to write compressed coordinates");
+}
+
+
+void DeltaCodec::read(FILE* f, uint64_t key, real* ptr, size_t cnt, unsigned V, unsigned D)
+{
+    const size_t n = cnt * V;
+    int64_t * val = current(key, n);
+
+    int mode = getc_unlocked(f);
+    if ( mode == DELTA_TIME )
+    {
+        int64_t const* old = previous(key, n);
+        if ( !old )
+            throw InvalidIO("compressed coordinates refer to missing data");
+        for ( size_t i = 0; i < n; ++i )
+            val[i] = old[i] + getVarInt(f);
+    }
+    else if ( mode == DELTA_SPACE )
+    {
+        for ( size_t i = 0; i < n && i < V; ++i )
+            val[i] = getVarInt(f);
+        for ( size_t i = V; i < n; ++i )
+            val[i] = val[i-V] + getVarInt(f);
+    }
+    else
+        throw InvalidIO("invalid compressed coordinates");
+
+    const size_t m = ( V < D ? V : D );
+    for ( size_t u = 0; u < cnt; ++u )
+    {
+        size_t d = 0;
+        for ( ; d < m; ++d )
+            ptr[D*u+d] = quantum_ * (real)val[V*u+d];
+        for ( ; d < D; ++d )
+            ptr[D*u+d] = 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+/**
+ The fastest level is used: on trajectory data, higher levels are several times
+ slower for a gain in size below 1%.
+ */
+void DeltaCodec::compress(std::vector<unsigned char>& dst, void const* src, size_t len)
+{
+    mz_ulong sup = mz_compressBound(len);
+    dst.resize(sup);
+    if ( MZ_OK != mz_compress2(dst.data(), &sup, (const unsigned char*)src, len, MZ_BEST_SPEED) )
+        throw InvalidIO("data compression failed");
+    dst.resize(sup);
+}
+
+
+void DeltaCodec::uncompress(std::vector<char>& dst, size_t size, void const* src, size_t len)
+{
+    mz_ulong cnt = size;
+    dst.resize(size);
+    if ( MZ_OK != mz_uncompress((unsigned char*)dst.data(), &cnt, (const unsigned char*)src, len) || cnt != size )
+        throw InvalidIO("data decompression failed");
+}
+
@@ -0,0 +1,133 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef DELTA_CODEC_H
+#define DELTA_CODEC_H
+
+#include "real.h"
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+
+/// Quantization and delta-encoding of coordinates, used for compressed trajectories
+/**
+ Coordinates are rounded to the nearest multiple of `quantum`, and the resulting
+ integers are encoded as differences:
+ - if an array with the same key and size was encoded in the previous frame,
+   the difference with this previous array is stored,
+ - otherwise, the difference between consecutive vectors of the array is stored.
+ .
+ The differences are stored with a variable number of bytes (7 bits per byte),
+ such that small values use a single byte. This data compresses well.
+
+ The arrays are identified by a key, which is derived from the object identity.
+ The values encoded in the current frame are recorded, to serve as reference
+ for the next frame. Since objects are usually written in the same order from
+ one frame to the next, the reference is first searched after the previous match.
+ At a keyframe, the history is cleared and all the arrays are encoded
+ independently of the previous frames.
+ Frames must thus be decoded in the same order in which they were encoded,
+ starting from a keyframe.
+
+ The class also provides compression of a memory buffer, using miniz.
+ */
+class DeltaCodec
+{
+private:
+
+    /// location of the values associated with a key
+    struct Record
+    {
+        uint64_t key;
+        size_t   start;
+        size_t   size;
+    };
+
+    /// quantized values of one frame
+    struct History
+    {
+        /// location of each array, in the order in which they were processed
+        std::vector<Record>  rec;
+
+        /// quantized values of all arrays
+        std::vector<int64_t> val;
+
+        /// pairs (key, index in `rec`) sorted by key, built when needed
+        std::vector<std::pair<uint64_t, size_t>> sorted;
+
+        /// clear content but keep memory allocated
+        void clear() { rec.clear(); val.clear(); sorted.clear(); }
+    };
+
+    /// precision of the coordinates
+    real        quantum_;
+
+    /// number of frames since last keyframe
+    size_t      distance_;
+
+    /// true if the history corresponds to the last frame that was processed
+    bool        valid_;
+
+    /// name of the stream being encoded
+    std::string name_;
+
+    /// values of the previous frame
+    History     past_;
+
+    /// values of the current frame
+    History     next_;
+
+    /// index in `past_.rec` of the array expected next
+    size_t      cursor_;
+
+    /// return values of previous frame associated with `key`, if there are `n` of them
+    int64_t const* previous(uint64_t key, size_t n);
+
+    /// allocate `n` values associated with `key` in the current frame
+    int64_t*    current(uint64_t key, size_t n);
+
+public:
+
+    /// constructor
+    DeltaCodec() { clear(); }
+
+    /// forget all history
+    void        clear();
+
+    /// precision of the current frame
+    real        quantum() const { return quantum_; }
+
+    /// number of frames since last keyframe, for the current frame
+    size_t      distance() const { return distance_; }
+
+    /// true if the previous frame was processed successfully
+    bool        valid() const { return valid_; }
+
+    /// name of the stream
+    std::string const& name() const { return name_; }
+
+    /// set name of the stream
+    void        name(std::string const& s) { name_ = s; }
+
+    /// start a frame located `dis` frames after the last keyframe
+    void        begin(size_t dis, real quantum);
+
+    /// complete the current frame, which becomes the reference for the next one
+    void        end();
+
+    /// encode `cnt` vectors of size `D` from `ptr[]`
+    void        write(FILE*, uint64_t key, real const* ptr, size_t cnt, unsigned D);
+
+    /// decode `cnt` vectors of size `V`, storing `D` coordinates for each in `ptr[]`
+    void        read(FILE*, uint64_t key, real* ptr, size_t cnt, unsigned V, unsigned D);
+
+    /// compress `len` bytes from `src` into `dst`
+    static void compress(std::vector<unsigned char>& dst, void const* src, size_t len);
+
+    /// uncompress `len` bytes from `src` into `dst`, which should contain `size` bytes
+    static void uncompress(std::vector<char>& dst, size_t size, void const* src, size_t len);
+};
+
+#endif
+
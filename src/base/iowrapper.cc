@@ -24,6 +24,7 @@ void Inputter::reset()
     format_  = 0;
     vecsize_ = 3;
     binary_  = 0;
+    codec_   = nullptr;
     
     if ( nonStandardTypes() )
     {
@@ -268,44 +269,59 @@ void Inputter::readFloats(double a[], const unsigned D)
 
 /**
  This will read `n * vecsize_` floats, and store `n * D` values in a[].
+ The values are read in chunks, using a single call to fread() per chunk
+ in binary mode.
  */
-void Inputter::readFloats(double a[], const size_t n, const unsigned D)
+template < typename T >
+void Inputter::readVectors(T a[], const size_t n, const unsigned D)
 {
-    const size_t nd = n * vecsize_;
-    float * v = new float[nd];
+    constexpr size_t CHUNK = 1024;
+    float buf[CHUNK];
     
-    if ( binary_ )
+    const size_t V = vecsize_;
+    const size_t m = ( V < D ? V : D );
+    const size_t sup = CHUNK / V;
+    
+    size_t u = 0;
+    while ( u < n )
     {
-        if ( nd != fread(v, 4, nd, mFile) )
+        const size_t k = ( n - u < sup ? n - u : sup );
+        const size_t nv = k * V;
+        if ( binary_ )
         {
-            delete[] v;
-            throw InvalidIO("readFloatVector(double) failed");
+            if ( nv != fread(buf, 4, nv, mFile) )
+                throw InvalidIO("readFloats() failed");
+            if ( binary_ == 2 )
+                for ( size_t i = 0; i < nv; ++i )
+                    swap4(reinterpret_cast<unsigned char*>(buf+i));
+        }
+        else
+        {
+            for ( size_t i = 0; i < nv; ++i )
+                if ( 1 != fscanf(mFile, " %f", buf+i) )
+                    throw InvalidIO("readFloats() failed");
+        }
+        for ( size_t j = 0; j < k; ++j, ++u )
+        {
+            size_t i = 0;
+            for ( ; i < m; ++i )
+                a[D*u+i] = buf[V*j+i];
+            for ( ; i < D; ++i )
+                a[D*u+i] = 0;
         }
-        if ( binary_ == 2 )
-            for ( size_t u = 0; u < nd; ++u )
-                swap4(reinterpret_cast<unsigned char*>(v+u));
-    }
-    else
-    {
-        for ( size_t u = 0; u < nd; ++u )
-            if ( 1 != fscanf(mFile, " %f", v+u) )
-            {
-                delete[] v;
-                throw InvalidIO("readFloatVector(double) failed");
-            }
     }
+}
 
-    const size_t m = ( vecsize_ < D ? vecsize_ : D );
-    
-    for ( size_t u = 0; u < n; ++u )
-    {
-        size_t i = 0;
-        for ( ; i < m; ++i )
-            a[D*u+i] = v[vecsize_*u+i];
-        for ( ; i < D; ++i )
-            a[D*u+i] = 0;
-    }
-    delete[] v;
+
+void Inputter::readFloats(float a[], const size_t n, const unsigned D)
+{
+    readVectors(a, n, D);
+}
+
+
+void Inputter::readFloats(double a[], const size_t n, const unsigned D)
+{
+    readVectors(a, n, D);
 }
 
 
@@ -316,6 +332,7 @@ Outputter::Outputter()
 : FileWrapper(stdout) 
 {
     binary_ = false;
+    codec_ = nullptr;
     
     if ( nonStandardTypes() )
     {
@@ -326,6 +343,7 @@ Outputter::Outputter()
 
 
 Outputter::Outputter(const char* name, const bool a, const bool b)
+: codec_(nullptr)
 {
     open(name, a, b);
     
@@ -337,6 +355,9 @@ Outputter::Outputter(const char* name, const bool a, const bool b)
 }
 
 
+/**
+ The file is given a large buffer, such that frames are written with few system calls.
+ */
 int Outputter::open(const char* name, const bool a, const bool b)
 {
     binary_ = b;
@@ -352,7 +373,13 @@ int Outputter::open(const char* name, const bool a, const bool b)
     if ( b )
         m[1] = 'b';
         
-    return FileWrapper::open(name, m);
+    int res = FileWrapper::open(name, m);
+    if ( mFile )
+    {
+        buffer_.resize(BUFFER_SIZE);
+        setvbuf(mFile, buffer_.data(), _IOFBF, buffer_.size());
+    }
+    return res;
 }
 
 
@@ -550,9 +577,38 @@ void Outputter::writeFloat(const float x)
 }
 
 
+/**
+ The values are converted to float in chunks, each written with one call to fwrite()
+ */
+template < typename T >
+void Outputter::writeBinary(const T* a, size_t n)
+{
+    constexpr size_t CHUNK = 1024;
+    float buf[CHUNK];
+    
+    while ( n > 0 )
+    {
+        const size_t m = ( n < CHUNK ? n : CHUNK );
+        for ( size_t i = 0; i < m; ++i )
+            buf[i] = (float)a[i];
+        if ( m != fwrite(buf, 4, m, mFile) )
+            throw InvalidIO("writeFloats()-binary failed");
+        a += m;
+        n -= m;
+    }
+}
+
+
 void Outputter::writeFloats(const float* a, const size_t n, char before)
 {
-    if ( before && !binary_ )
+    if ( binary_ )
+    {
+        if ( n != fwrite(a, 4, n, mFile) )
+            throw InvalidIO("writeFloats()-binary failed");
+        return;
+    }
+    
+    if ( before )
         putc(before, mFile);
     
     for ( size_t d = 0; d < n; ++d )
@@ -562,7 +618,10 @@ void Outputter::writeFloats(const float* a, const size_t n, char before)
 
 void Outputter::writeFloats(const double* a, const size_t n, char before)
 {
-    if ( before && !binary_ )
+    if ( binary_ )
+        return writeBinary(a, n);
+    
+    if ( before )
         putc(before, mFile);
     
     for ( size_t d = 0; d < n; ++d )
@@ -570,6 +629,26 @@ void Outputter::writeFloats(const double* a, const size_t n, char before)
 }
 
 
+void Outputter::writeFloats(const float* a, const size_t cnt, const unsigned D, char before)
+{
+    if ( binary_ )
+        return writeFloats(a, cnt*D);
+    
+    for ( size_t u = 0; u < cnt; ++u )
+        writeFloats(a+D*u, D, before);
+}
+
+
+void Outputter::writeFloats(const double* a, const size_t cnt, const unsigned D, char before)
+{
+    if ( binary_ )
+        return writeBinary(a, cnt*D);
+    
+    for ( size_t u = 0; u < cnt; ++u )
+        writeFloats(a+D*u, D, before);
+}
+
+
 void Outputter::writeDouble(const double x)
 {
     if ( binary_ )
@@ -6,6 +6,9 @@
 #include <cstdio>
 #include <stdint.h>
 #include "filewrapper.h"
+#include <vector>
+
+class DeltaCodec;
 
 /// Input with automatic binary/text mode and byte-swapping for cross-platform compatibility
 class Inputter : public FileWrapper
@@ -25,6 +28,9 @@ private:
         */
     int       binary_;
     
+    /// decoder of coordinates, used for compressed frames
+    DeltaCodec * codec_;
+    
     /// reverse order of bytes in c[2]
     /**
      Can use the Intel SIMD function _bswap() and _bswap64()
@@ -96,6 +102,12 @@ public:
     /// initialize the automatic swapping of bytes in the binary format
     void      setEndianess(const char[2]);
     
+    /// decoder of coordinates, or nullptr if coordinates are not compressed
+    DeltaCodec* codec()         const { return codec_; }
+    
+    /// set decoder of coordinates
+    void      codec(DeltaCodec* c)    { codec_ = c; }
+    
     /// Read integer on 2 bytes
     int16_t   readInt16();
     /// Read integer on 4 bytes
@@ -125,6 +137,12 @@ public:
     /// Reads `n` vector, returning D coordinates for each, in the array of size n*D
     void      readFloats(double[], size_t n, unsigned D);
 
+private:
+    
+    /// implementation of readFloats(n, D)
+    template < typename T >
+    void      readVectors(T[], size_t n, unsigned D);
+
 };
 
 
@@ -139,14 +157,30 @@ private:
         
     /// Flag for binary output
     bool    binary_;
+    
+    /// encoder of coordinates, used for compressed frames
+    DeltaCodec * codec_;
+    
+    /// buffer used by the FILE, if the file was opened by this class
+    std::vector<char> buffer_;
+
+    /// Write `n` values using 4 bytes each, converted to float in chunks
+    template < typename T >
+    void    writeBinary(const T*, size_t n);
 
 public:
 
+    /// size of the buffer used for files opened by open()
+    static constexpr size_t BUFFER_SIZE = 1 << 20;
+
     /// constructor
     Outputter();
     
+    /// destructor
+    ~Outputter() { close(); }
+    
     /// constructor which opens a file
-    Outputter(FILE* f, bool b) : FileWrapper(f, nullptr), binary_(b) {};
+    Outputter(FILE* f, bool b) : FileWrapper(f, nullptr), binary_(b), codec_(nullptr) {};
 
     /// constructor which opens a file where `a` specifies append and `b` binary mode.
     Outputter(const char* name, bool a, bool b=false);
@@ -159,6 +193,12 @@ public:
     
     /// Return the current binary format
     bool    binary() const { return binary_; }
+    
+    /// encoder of coordinates, or nullptr if coordinates are not compressed
+    DeltaCodec* codec() const { return codec_; }
+    
+    /// set encoder of coordinates, which requires binary format
+    void    codec(DeltaCodec* c) { codec_ = c; }
 
     /// Puts given string, and '01' or '10', to specify the byte order 
     void    writeEndianess();
@@ -195,6 +235,11 @@ public:
     /// Write `n` values using 4 bytes each (converted to float)
     void    writeFloats(const double*, size_t n, char before=0);
 
+    /// Write `cnt` vectors of `D` values using 4 bytes each, each vector preceded by `before`
+    void    writeFloats(const float*, size_t cnt, unsigned D, char before);
+    /// Write `cnt` vectors of `D` values using 4 bytes each, each vector preceded by `before`
+    void    writeFloats(const double*, size_t cnt, unsigned D, char before);
+
     /// Write value on 8 bytes
     void    writeDouble(double);
     /// Write `n` values using 8 bytes each
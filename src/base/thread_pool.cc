@@ -0,0 +1,221 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "thread_pool.h"
+#include "exceptions.h"
+#include <unistd.h>
+
+
+/// number of polls done by an idle thread before it goes to sleep
+constexpr unsigned SPIN_LIMIT = 1 << 14;
+
+
+/// hint to the processor that we are in a polling loop
+static inline void relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+
+ThreadPool::ThreadPool()
+: nb_workers_(1), spin_(0), workers_(nullptr), func_(nullptr), arg_(nullptr)
+{
+    generation_ = 0;
+    birth_ = 0;
+    pending_ = 0;
+    halt_ = false;
+    pthread_mutex_init(&mutex_, nullptr);
+    pthread_cond_init(&wake_, nullptr);
+    pthread_cond_init(&done_, nullptr);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+    pthread_cond_destroy(&done_);
+    pthread_cond_destroy(&wake_);
+    pthread_mutex_destroy(&mutex_);
+}
+
+
+unsigned ThreadPool::nbProcessors()
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return ( n > 0 ) ? (unsigned)n : 1;
+}
+
+
+void* ThreadPool::launcher(void* arg)
+{
+    Worker * w = static_cast<Worker*>(arg);
+    w->pool->loop(w->rank);
+    return nullptr;
+}
+
+
+void ThreadPool::start(unsigned n)
+{
+    if ( n < 1 )
+        n = 1;
+
+    if ( n == nb_workers_ && workers_ )
+        return;
+
+    stop();
+
+    workers_ = new Worker[n];
+    nb_workers_ = n;
+    halt_ = false;
+    birth_ = generation_.load();
+    // polling is counterproductive if threads compete for processors:
+    spin_ = ( n <= nbProcessors() ) ? SPIN_LIMIT : 0;
+
+    for ( unsigned r = 0; r < n; ++r )
+    {
+        workers_[r].next = 0;
+        workers_[r].end  = 0;
+        workers_[r].pool = this;
+        workers_[r].rank = r;
+    }
+
+    // worker 0 is the calling thread:
+    for ( unsigned r = 1; r < n; ++r )
+    {
+        if ( pthread_create(&workers_[r].thread, nullptr, launcher, workers_+r) )
+        {
+            // terminate the threads that were created, which may be asleep:
+            nb_workers_ = r;
+            stop();
+            throw Exception("failed to create thread");
+        }
+    }
+}
+
+
+void ThreadPool::stop()
+{
+    if ( workers_ )
+    {
+        pthread_mutex_lock(&mutex_);
+        halt_ = true;
+        ++generation_;
+        pthread_cond_broadcast(&wake_);
+        pthread_mutex_unlock(&mutex_);
+
+        for ( unsigned r = 1; r < nb_workers_; ++r )
+            pthread_join(workers_[r].thread, nullptr);
+
+        delete[] workers_;
+        workers_ = nullptr;
+    }
+    nb_workers_ = 1;
+    halt_ = false;
+}
+
+
+void ThreadPool::work(unsigned rank)
+{
+    // process own range first, and then steal from the others:
+    for ( unsigned k = 0; k < nb_workers_; ++k )
+    {
+        unsigned r = rank + k;
+        if ( r >= nb_workers_ )
+            r -= nb_workers_;
+        Worker & w = workers_[r];
+        size_t i = w.next.fetch_add(1, std::memory_order_relaxed);
+        while ( i < w.end )
+        {
+            func_(arg_, i, rank);
+            i = w.next.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+
+void ThreadPool::loop(unsigned rank)
+{
+    unsigned seen = birth_;
+    while ( 1 )
+    {
+        // poll for a while, as jobs are often issued in quick succession:
+        unsigned gen = generation_.load(std::memory_order_acquire);
+        for ( unsigned n = 0; gen == seen && n < spin_; ++n )
+        {
+            relax();
+            gen = generation_.load(std::memory_order_acquire);
+        }
+
+        // and then go to sleep:
+        if ( gen == seen )
+        {
+            pthread_mutex_lock(&mutex_);
+            while ( seen == ( gen = generation_.load(std::memory_order_acquire) ))
+                pthread_cond_wait(&wake_, &mutex_);
+            pthread_mutex_unlock(&mutex_);
+        }
+
+        if ( halt_ )
+            break;
+
+        seen = gen;
+        work(rank);
+        
+        // the last worker to complete signals the calling thread:
+        if ( 1 == pending_.fetch_sub(1, std::memory_order_acq_rel) )
+        {
+            pthread_mutex_lock(&mutex_);
+            pthread_cond_signal(&done_);
+            pthread_mutex_unlock(&mutex_);
+        }
+    }
+}
+
+
+void ThreadPool::run(size_t cnt, size_t const* split, Function func, void* arg)
+{
+    if ( nb_workers_ < 2 || cnt < 2 )
+    {
+        for ( size_t i = 0; i < cnt; ++i )
+            func(arg, i, 0);
+        return;
+    }
+
+    func_ = func;
+    arg_ = arg;
+    for ( unsigned r = 0; r < nb_workers_; ++r )
+    {
+        if ( split )
+        {
+            workers_[r].next.store(split[r], std::memory_order_relaxed);
+            workers_[r].end = split[r+1];
+        }
+        else
+        {
+            workers_[r].next.store(( cnt * r ) / nb_workers_, std::memory_order_relaxed);
+            workers_[r].end = ( cnt * ( r + 1 ) ) / nb_workers_;
+        }
+    }
+    pending_.store(nb_workers_-1, std::memory_order_relaxed);
+
+    pthread_mutex_lock(&mutex_);
+    generation_.fetch_add(1, std::memory_order_release);
+    pthread_cond_broadcast(&wake_);
+    pthread_mutex_unlock(&mutex_);
+
+    work(0);
+
+    // wait for other workers to complete:
+    for ( unsigned n = 0; n < spin_; ++n )
+    {
+        if ( 0 == pending_.load(std::memory_order_acquire) )
+            return;
+        relax();
+    }
+    pthread_mutex_lock(&mutex_);
+    while ( pending_.load(std::memory_order_acquire) )
+        pthread_cond_wait(&done_, &mutex_);
+    pthread_mutex_unlock(&mutex_);
+}
+
@@ -0,0 +1,147 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <atomic>
+#include <cstddef>
+
+
+/// A persistent set of threads executing loops with work stealing
+/**
+ The threads are created by start() and remain alive between calls to run(),
+ polling for a new job for a short while, before waiting on a condition variable.
+ Polling is disabled if there are more threads than processors.
+ The calling thread participates in the work as the worker of rank 0,
+ such that `start(1)` does not create any thread.
+
+ The indices [0, cnt) of a loop are initially distributed in contiguous ranges,
+ one per worker, as specified by `split[]`. Each worker first processes its own
+ range, and then steals the indices remaining in the ranges of other workers.
+ Each index is claimed with an atomic increment, and is thus processed once.
+
+ The ranges can be chosen by the caller to balance the load a priori,
+ and work stealing corrects for any remaining imbalance.
+ */
+class ThreadPool
+{
+public:
+
+    /// function called for each index `i` of the loop by worker `rank`
+    typedef void (*Function)(void* arg, size_t i, unsigned rank);
+
+private:
+
+    /// one worker, padded to occupy its own cache line
+    struct Worker
+    {
+        /// next index to be processed in this range
+        std::atomic<size_t> next;
+
+        /// end of this range
+        size_t      end;
+
+        /// the pool
+        ThreadPool* pool;
+
+        /// rank of this worker
+        unsigned    rank;
+
+        /// thread handle
+        pthread_t   thread;
+
+        /// padding to avoid false sharing
+        char        pad[64];
+    };
+
+    /// number of workers, including the calling thread
+    unsigned    nb_workers_;
+    
+    /// number of polls done by a waiting thread before it goes to sleep
+    unsigned    spin_;
+
+    /// array of workers
+    Worker *    workers_;
+
+    /// function of the current job
+    Function    func_;
+
+    /// argument of the current job
+    void *      arg_;
+
+    /// incremented every time a job is started
+    std::atomic<unsigned> generation_;
+    
+    /// value of `generation_` when the threads were created
+    unsigned    birth_;
+
+    /// number of workers that have not yet completed the current job
+    std::atomic<unsigned> pending_;
+
+    /// flag to request termination of the threads
+    std::atomic<bool> halt_;
+
+    /// mutex associated with `wake_`
+    pthread_mutex_t mutex_;
+
+    /// condition used to wake up idle threads
+    pthread_cond_t  wake_;
+    
+    /// condition used to signal completion of a job
+    pthread_cond_t  done_;
+
+    /// process indices of the current job, starting with range `rank`
+    void        work(unsigned rank);
+
+    /// main loop executed by the threads
+    void        loop(unsigned rank);
+
+    /// entry point of threads
+    static void* launcher(void*);
+
+    /// convert a callable object to a Function
+    template < typename FUNC >
+    static void  call(void* arg, size_t i, unsigned rank)
+    {
+        (*static_cast<FUNC*>(arg))(i, rank);
+    }
+
+public:
+
+    /// create an empty pool
+    ThreadPool();
+
+    /// stop all threads
+    ~ThreadPool();
+
+    /// set number of workers to `n` (including calling thread)
+    void        start(unsigned n);
+
+    /// terminate all threads
+    void        stop();
+
+    /// number of workers, including calling thread
+    unsigned    size() const { return nb_workers_; }
+
+    /// call `func(arg, i, rank)` for `i` in [0, cnt), with initial ranges given by `split`
+    /**
+     `split` should contain size()+1 values, with split[0]=0 and split[size()]=cnt.
+     If `split==nullptr`, the indices are distributed in equal ranges.
+     This returns after all indices have been processed.
+     */
+    void        run(size_t cnt, size_t const* split, Function func, void* arg);
+
+    /// call `func(i, rank)` for `i` in [0, cnt), with initial ranges given by `split`
+    template < typename FUNC >
+    void        run(size_t cnt, size_t const* split, FUNC& func)
+    {
+        run(cnt, split, &call<FUNC>, &func);
+    }
+
+    /// number of processors available on this machine
+    static unsigned nbProcessors();
+};
+
+#endif
+
@@ -0,0 +1,224 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef IDRS_H
+#define IDRS_H
+
+#include "real.h"
+#include "cblas.h"
+#include "allocator.h"
+#include "monitor.h"
+#include <algorithm>
+#include <cstdint>
+
+/// Maximum dimension of the shadow space in IDR(s)
+#define IDRS_MAX 8
+
+/// Induced Dimension Reduction method to solve a system of linear equations
+/**
+ This implements IDR(s) with bi-orthogonalization described in:
+
+     Algorithm 913: An Elegant IDR(s) Variant that Efficiently Exploits
+     Biorthogonality Properties, M. B. van Gijzen and P. Sonneveld
+     ACM Transactions on Mathematical Software 38 (2011)
+
+ IDR(1) is mathematically equivalent to BiCGStab, and larger values of `s`
+ usually reduce the number of matrix-vector products for non-symmetric systems,
+ at the cost of storing 3*s+3 vectors.
+*/
+namespace LinearSolvers
+{
+    /// fill the `s` vectors of `P` with pseudo-random numbers and orthonormalize them
+    /**
+     A local generator is used, such that the random number generator of the
+     simulation is not affected, and the results are reproducible
+     */
+    inline void idrs_shadow(unsigned dim, unsigned s, real* P, size_t ldp)
+    {
+        uint32_t z = 2463534242U;
+        for ( unsigned k = 0; k < s; ++k )
+        {
+            real * p = P + k * ldp;
+            for ( unsigned i = 0; i < dim; ++i )
+            {
+                z ^= z << 13;
+                z ^= z >> 17;
+                z ^= z << 5;
+                p[i] = real(int32_t(z)) * 0x1p-31;
+            }
+            // modified Gram-Schmidt:
+            for ( unsigned j = 0; j < k; ++j )
+                blas::xaxpy(dim, -blas::dot(dim, P+j*ldp, p), P+j*ldp, 1, p, 1);
+            blas::xscal(dim, 1.0/blas::nrm2(dim, p), p, 1);
+        }
+    }
+
+
+    /// IDR(s), preconditionned on the right if `PC == true`
+    /*
+     This solves `mat * x = rhs` with a tolerance specified in 'monitor'
+     Error flags: 4 = breakdown in the bi-orthogonalization, 3 = stagnation
+     */
+    template < bool PC, typename LinearOperator, typename Monitor, typename Allocator >
+    void IDRS_(const LinearOperator& mat, const real* rhs, real* sol, unsigned s,
+               Monitor& monitor, Allocator& allocator)
+    {
+        // parameter to keep the residual polynomial well-conditioned:
+        const real angle = 0.7;
+        s = std::max(1U, std::min(s, (unsigned)IDRS_MAX));
+
+        const int dim = mat.dimension();
+        allocator.allocate(dim, 3*s+3);
+        real * r = allocator.bind(0);
+        real * v = allocator.bind(1);
+        real * t = allocator.bind(2);
+        real * P = allocator.bind(3);
+        real * G = allocator.bind(3+s);
+        real * U = allocator.bind(3+2*s);
+        const size_t ldp = allocator.bind(1) - r;
+
+        // small matrix M = P' * G, which is lower triangular, and vectors
+        real M[IDRS_MAX*IDRS_MAX], f[IDRS_MAX], c[IDRS_MAX];
+
+        mat.multiply(sol, r);
+        blas::xcopy(dim, rhs, 1, v, 1);
+        blas::xaxpy(dim, -1.0, r, 1, v, 1);     // v = rhs - A * x
+        blas::xcopy(dim, v, 1, r, 1);           // r = v
+
+        if ( monitor.finished(dim, r) )
+            return;
+
+        idrs_shadow(dim, s, P, ldp);
+        zero_real(s*ldp, G);
+        zero_real(s*ldp, U);
+        for ( unsigned i = 0; i < s; ++i )
+        for ( unsigned j = 0; j < s; ++j )
+            M[i+IDRS_MAX*j] = ( i == j );
+
+        real omega = 1.0;
+
+        while ( ! monitor.finished(dim, r) )
+        {
+            // f = P' * r
+            for ( unsigned i = 0; i < s; ++i )
+                f[i] = blas::dot(dim, P+i*ldp, r);
+
+            for ( unsigned k = 0; k < s; ++k )
+            {
+                // solve the lower triangular system M(k:s,k:s) * c = f(k:s)
+                for ( unsigned i = k; i < s; ++i )
+                {
+                    real x = f[i];
+                    for ( unsigned j = k; j < i; ++j )
+                        x -= M[i+IDRS_MAX*j] * c[j];
+                    c[i] = x / M[i+IDRS_MAX*i];
+                }
+
+                // v = r - G(:,k:s) * c
+                blas::xcopy(dim, r, 1, v, 1);
+                for ( unsigned i = k; i < s; ++i )
+                    blas::xaxpy(dim, -c[i], G+i*ldp, 1, v, 1);
+
+                if ( PC )
+                    mat.precondition(v, v);
+
+                // U(:,k) = U(:,k:s) * c + omega * v, calculated in t
+                blas::xcopy(dim, v, 1, t, 1);
+                blas::xscal(dim, omega, t, 1);
+                for ( unsigned i = k; i < s; ++i )
+                    blas::xaxpy(dim, c[i], U+i*ldp, 1, t, 1);
+                real * u = U + k * ldp;
+                real * g = G + k * ldp;
+                blas::xcopy(dim, t, 1, u, 1);
+
+                // G(:,k) = A * U(:,k)
+                mat.multiply(u, g);
+                ++monitor;
+
+                // bi-orthogonalize the new vectors with respect to P(:,1:k-1)
+                for ( unsigned i = 0; i < k; ++i )
+                {
+                    real alpha = blas::dot(dim, P+i*ldp, g) / M[i+IDRS_MAX*i];
+                    blas::xaxpy(dim, -alpha, G+i*ldp, 1, g, 1);
+                    blas::xaxpy(dim, -alpha, U+i*ldp, 1, u, 1);
+                }
+
+                // new column of M = P' * G
+                for ( unsigned i = k; i < s; ++i )
+                    M[i+IDRS_MAX*k] = blas::dot(dim, P+i*ldp, g);
+
+                if ( M[k+IDRS_MAX*k] == 0.0 )
+                {
+                    monitor.finish(4, dim, r);
+                    goto finish;
+                }
+
+                // make r orthogonal to P(:,1:k)
+                real beta = f[k] / M[k+IDRS_MAX*k];
+                blas::xaxpy(dim, -beta, g, 1, r, 1);
+                blas::xaxpy(dim,  beta, u, 1, sol, 1);
+
+                if ( monitor.finished(dim, r) )
+                    goto finish;
+
+                for ( unsigned i = k+1; i < s; ++i )
+                    f[i] -= beta * M[i+IDRS_MAX*k];
+            }
+
+            // enter the next subspace: dimension reduction step
+            blas::xcopy(dim, r, 1, v, 1);
+            if ( PC )
+                mat.precondition(v, v);
+            mat.multiply(v, t);
+            ++monitor;
+
+            real nt = blas::nrm2(dim, t);
+            real nr = blas::nrm2(dim, r);
+            real tr = blas::dot(dim, t, r);
+
+            if ( nt == 0.0 || tr == 0.0 )
+            {
+                monitor.finish(3, dim, r);
+                break;
+            }
+
+            omega = tr / ( nt * nt );
+            real rho = std::abs(tr / ( nt * nr ));
+            if ( rho < angle )
+                omega *= angle / rho;
+
+            blas::xaxpy(dim, -omega, t, 1, r, 1);    // r = r - omega * t
+            blas::xaxpy(dim,  omega, v, 1, sol, 1);  // x = x + omega * v
+        }
+
+    finish:
+#if ( 0 )
+        // calculate true residual = rhs - A * x
+        mat.multiply(sol, r);
+        blas::xaxpy(dim, -1.0, rhs, 1, r, 1);
+        real resid = blas::nrm2(dim, r);
+        fprintf(stderr, "IDR(%u) %4i count %4u residual %10.6f\n", s, dim, monitor.count(), resid);
+#endif
+        allocator.release();
+    }
+
+
+    /// IDR(s) without Preconditionning
+    template < typename LinearOperator, typename Monitor, typename Allocator >
+    void IDRS(const LinearOperator& mat, const real* rhs, real* sol, unsigned s,
+              Monitor& monitor, Allocator& allocator)
+    {
+        IDRS_<false>(mat, rhs, sol, s, monitor, allocator);
+    }
+
+
+    /// IDR(s) with Preconditionning
+    template < typename LinearOperator, typename Monitor, typename Allocator >
+    void IDRSP(const LinearOperator& mat, const real* rhs, real* sol, unsigned s,
+               Monitor& monitor, Allocator& allocator)
+    {
+        IDRS_<true>(mat, rhs, sol, s, monitor, allocator);
+    }
+}
+
+#endif
+
@@ -0,0 +1,80 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef LU_MIXED_H
+#define LU_MIXED_H
+
+#include "real.h"
+
+#if defined(__AVX__) && REAL_IS_DOUBLE
+#  include "simd.h"
+#  define LU_MIXED_USES_AVX 1
+#else
+#  define LU_MIXED_USES_AVX 0
+#endif
+
+/**
+ Functions to apply a LU factorization stored in single precision,
+ to a vector in double precision (mixed precision).
+ The matrix is read from memory as `float`, which halves the memory traffic,
+ but all the arithmetic is done with `real`, such that only the representation
+ of the factors is affected by rounding. This is sufficient for a preconditionner.
+ */
+namespace LUMixed
+{
+    /// convert `cnt` values to single precision
+    inline void convert(size_t cnt, real const* src, float* dst)
+    {
+        for ( size_t i = 0; i < cnt; ++i )
+            dst[i] = float(src[i]);
+    }
+
+    /// Y[i] <- Y[i] - alpha * X[i] for i in [0, cnt[
+    inline void axpy(size_t cnt, real alpha, float const* X, real* Y)
+    {
+        size_t i = 0;
+#if LU_MIXED_USES_AVX
+        vec4 a = set4(alpha);
+        for ( ; i+4 <= cnt; i += 4 )
+            storeu4(Y+i, fnmadd4(a, _mm256_cvtps_pd(_mm_loadu_ps(X+i)), loadu4(Y+i)));
+#endif
+        for ( ; i < cnt; ++i )
+            Y[i] -= alpha * X[i];
+    }
+
+    /**
+     Solve `A * X = Y` in place, where `A = P * L * U` was factorized by
+     LAPACK xgetrf() or xgetf2(), and then converted to single precision.
+     `LU` is stored column-major with leading dimension `N`, and `ipiv`
+     contains the pivots in Fortran convention (starting at 1).
+     */
+    inline void solve(int N, float const* LU, int const* ipiv, real* Y)
+    {
+        // apply row interchanges:
+        for ( int i = 0; i < N; ++i )
+        {
+            int p = ipiv[i] - 1;
+            if ( p != i )
+            {
+                real t = Y[i];
+                Y[i] = Y[p];
+                Y[p] = t;
+            }
+        }
+
+        // forward substitution with unit lower triangular L:
+        for ( int j = 0; j < N-1; ++j )
+            axpy(N-1-j, Y[j], LU+j+1+N*j, Y+j+1);
+
+        // backward substitution with upper triangular U:
+        for ( int j = N-1; j > 0; --j )
+        {
+            float const* col = LU + N * j;
+            Y[j] /= col[j];
+            axpy(j, Y[j], col, Y);
+        }
+        Y[0] /= LU[0];
+    }
+}
+
+#endif
+
@@ -0,0 +1,350 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "matsparsesell.h"
+#include "matsparsesym1.h"
+#include "assert_macro.h"
+
+#include <algorithm>
+#include <sstream>
+
+#if defined(__AVX2__) && defined(__FMA__) && ( SELL_CHUNK == 4 )
+#  define SELL_USES_AVX REAL_IS_DOUBLE
+#  include "simd.h"
+#else
+#  define SELL_USES_AVX 0
+#endif
+
+/// value used in row_[] to indicate padding
+constexpr index_t NO_ROW = ~0U;
+
+
+MatrixSparseSELL::MatrixSparseSELL()
+{
+    size_    = 0;
+    nrow_    = 0;
+    nchk_    = 0;
+    sigma_   = 1;
+    single_  = false;
+    row_max_ = 0;
+    val_max_ = 0;
+    flt_max_ = 0;
+    row_     = nullptr;
+    chk_     = nullptr;
+    val_     = nullptr;
+    flt_     = nullptr;
+    col_     = nullptr;
+    len_     = nullptr;
+}
+
+
+void MatrixSparseSELL::deallocate()
+{
+    delete[] row_;
+    delete[] chk_;
+    delete[] len_;
+    delete[] col_;
+    free_real(val_);
+    delete[] flt_;
+    row_ = nullptr;
+    chk_ = nullptr;
+    len_ = nullptr;
+    col_ = nullptr;
+    val_ = nullptr;
+    flt_ = nullptr;
+    row_max_ = 0;
+    val_max_ = 0;
+    flt_max_ = 0;
+    single_ = false;
+}
+
+
+void MatrixSparseSELL::allocateRows(size_t alc)
+{
+    if ( alc > row_max_ )
+    {
+        constexpr size_t chunk = 64;
+        alc = ( alc + chunk - 1 ) & ~( chunk - 1 );
+        delete[] row_;
+        delete[] chk_;
+        delete[] len_;
+        row_max_ = alc;
+        row_ = new index_t[alc];
+        chk_ = new size_t[alc/SELL_CHUNK+2];
+        len_ = new size_t[alc];
+    }
+}
+
+
+void MatrixSparseSELL::allocateValues(size_t alc)
+{
+    if ( alc > val_max_ )
+    {
+        alc = chunk_real(alc + alc / 4);
+        delete[] col_;
+        free_real(val_);
+        val_max_ = alc;
+        col_ = new index_t[alc];
+        val_ = new_real(alc);
+    }
+}
+
+
+/**
+ The content of `mat` is copied, using both the lower and upper halves.
+ Within each row, elements are stored in order of increasing column index.
+ If `single`, the values are also copied in single precision.
+ */
+void MatrixSparseSELL::build(MatrixSparseSymmetric1 const& mat, unsigned sigma, bool single)
+{
+    size_ = mat.size();
+    sigma_ = std::max(sigma, 1U);
+    allocateRows(size_+SELL_CHUNK);
+
+    // count elements in each row:
+    for ( index_t jj = 0; jj < size_; ++jj )
+        len_[jj] = 0;
+    for ( index_t jj = 0; jj < size_; ++jj )
+    {
+        const unsigned cnt = mat.columnSize(jj);
+        if ( cnt > 0 )
+        {
+            MatrixSparseSymmetric1::Element const* col = mat.column(jj);
+            assert_true( col[0].inx == jj );
+            len_[jj] += cnt;
+            for ( unsigned n = 1; n < cnt; ++n )
+                ++len_[col[n].inx];
+        }
+    }
+
+    // list non-empty rows:
+    nrow_ = 0;
+    for ( index_t jj = 0; jj < size_; ++jj )
+    {
+        if ( len_[jj] > 0 )
+            row_[nrow_++] = jj;
+    }
+
+    // sort rows by decreasing number of elements, within windows of size `sigma`
+    if ( sigma_ > 1 )
+    {
+        size_t const* len = len_;
+        auto longer = [len](index_t a, index_t b) { return len[a] > len[b]; };
+        for ( index_t i = 0; i < nrow_; i += sigma_ )
+            std::stable_sort(row_+i, row_+std::min(i+sigma_, nrow_), longer);
+    }
+
+    // pad the last group:
+    nchk_ = ( nrow_ + SELL_CHUNK - 1 ) / SELL_CHUNK;
+    for ( index_t i = nrow_; i < SELL_CHUNK * nchk_; ++i )
+        row_[i] = NO_ROW;
+
+    // set the start of each group, and the width given by its longest row:
+    size_t sum = 0;
+    for ( index_t c = 0; c < nchk_; ++c )
+    {
+        chk_[c] = sum;
+        size_t wid = 0;
+        for ( index_t i = SELL_CHUNK * c; i < SELL_CHUNK * ( c + 1 ); ++i )
+        {
+            if ( row_[i] != NO_ROW )
+                wid = std::max(wid, len_[row_[i]]);
+        }
+        sum += SELL_CHUNK * wid;
+    }
+    chk_[nchk_] = sum;
+
+    allocateValues(sum);
+    zero_real(sum, val_);
+    for ( size_t n = 0; n < sum; ++n )
+        col_[n] = 0;
+
+    // len_[] now indicates where the next element of each row should be stored:
+    for ( index_t i = 0; i < SELL_CHUNK * nchk_; ++i )
+    {
+        if ( row_[i] != NO_ROW )
+            len_[row_[i]] = chk_[i/SELL_CHUNK] + i % SELL_CHUNK;
+    }
+
+    // distribute the elements, which are visited in order of increasing column:
+    for ( index_t jj = 0; jj < size_; ++jj )
+    {
+        const unsigned cnt = mat.columnSize(jj);
+        MatrixSparseSymmetric1::Element const* col = mat.column(jj);
+        for ( unsigned n = 0; n < cnt; ++n )
+        {
+            const index_t ii = col[n].inx;
+            size_t & k = len_[jj];
+            val_[k] = col[n].val;
+            col_[k] = ii;
+            k += SELL_CHUNK;
+            if ( ii != jj )
+            {
+                size_t & p = len_[ii];
+                val_[p] = col[n].val;
+                col_[p] = jj;
+                p += SELL_CHUNK;
+            }
+        }
+    }
+
+    single_ = single;
+    if ( single )
+    {
+        if ( sum > flt_max_ )
+        {
+            delete[] flt_;
+            flt_max_ = val_max_;
+            flt_ = new float[flt_max_];
+        }
+        for ( size_t n = 0; n < sum; ++n )
+            flt_[n] = (float)val_[n];
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - Multiplication
+
+/**
+ Generic implementation for isotropic multiplication in dimension D,
+ with values of type VAL, and products accumulated in type `real`
+ */
+template < int D, typename VAL >
+static void sell_multiply(const real* X, real* Y, index_t start, index_t stop,
+                          index_t const* row, size_t const* chk,
+                          VAL const* val, index_t const* col)
+{
+    for ( index_t c = start; c < stop; ++c )
+    {
+        real sum[SELL_CHUNK][D] = { { 0 } };
+        for ( size_t k = chk[c]; k < chk[c+1]; k += SELL_CHUNK )
+        {
+            for ( int i = 0; i < SELL_CHUNK; ++i )
+            {
+                const real a = val[k+i];
+                real const* x = X + D * col[k+i];
+                for ( int d = 0; d < D; ++d )
+                    sum[i][d] += a * x[d];
+            }
+        }
+        index_t const* R = row + SELL_CHUNK * c;
+        for ( int i = 0; i < SELL_CHUNK; ++i )
+        {
+            if ( R[i] != NO_ROW )
+            {
+                for ( int d = 0; d < D; ++d )
+                    Y[D*R[i]+d] += sum[i][d];
+            }
+        }
+    }
+}
+
+
+#if SELL_USES_AVX
+
+/// load 4 values in double precision
+inline static vec4 sell_load(double const* v) { return load4(v); }
+
+/// load 4 values in single precision, converting them to double precision
+inline static vec4 sell_load(float const* v) { return _mm256_cvtps_pd(_mm_loadu_ps(v)); }
+
+/**
+ AVX2 implementation for isotropic multiplication in dimension D,
+ in which the 4 rows of a group are calculated in the 4 lanes of the registers,
+ and the coordinates of X are collected with 'gather' instructions.
+ */
+template < int D, typename VAL >
+static void sell_multiplyAVX(const real* X, real* Y, index_t start, index_t stop,
+                             index_t const* row, size_t const* chk,
+                             VAL const* val, index_t const* col)
+{
+    alignas(32) real res[D][4];
+    // gather all lanes with a defined source, which avoids -Wmaybe-uninitialized:
+    const vec4 all = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+    for ( index_t c = start; c < stop; ++c )
+    {
+        vec4 s[D];
+        for ( int d = 0; d < D; ++d )
+            s[d] = setzero4();
+        for ( size_t k = chk[c]; k < chk[c+1]; k += 4 )
+        {
+            vec4 a = sell_load(val+k);
+            __m128i i = _mm_loadu_si128((__m128i const*)(col+k));
+            if ( D == 2 )
+                i = _mm_add_epi32(i, i);
+            else if ( D == 3 )
+                i = _mm_add_epi32(i, _mm_add_epi32(i, i));
+            for ( int d = 0; d < D; ++d )
+                s[d] = _mm256_fmadd_pd(a, _mm256_mask_i32gather_pd(setzero4(), X+d, i, all, 8), s[d]);
+        }
+        for ( int d = 0; d < D; ++d )
+            store4(res[d], s[d]);
+        index_t const* R = row + 4 * c;
+        for ( int i = 0; i < 4; ++i )
+        {
+            if ( R[i] != NO_ROW )
+            {
+                for ( int d = 0; d < D; ++d )
+                    Y[D*R[i]+d] += res[d][i];
+            }
+        }
+    }
+}
+
+#  define SELL_MULTIPLY sell_multiplyAVX
+#else
+#  define SELL_MULTIPLY sell_multiply
+#endif
+
+
+void MatrixSparseSELL::vecMulAdd(const real* X, real* Y, index_t start, index_t stop) const
+{
+    assert_true( stop <= nchk_ );
+    SELL_MULTIPLY<1>(X, Y, start, stop, row_, chk_, val_, col_);
+}
+
+
+void MatrixSparseSELL::vecMulAddIso2D(const real* X, real* Y, index_t start, index_t stop) const
+{
+    assert_true( stop <= nchk_ );
+    SELL_MULTIPLY<2>(X, Y, start, stop, row_, chk_, val_, col_);
+}
+
+
+void MatrixSparseSELL::vecMulAddIso3D(const real* X, real* Y, index_t start, index_t stop) const
+{
+    assert_true( stop <= nchk_ );
+    SELL_MULTIPLY<3>(X, Y, start, stop, row_, chk_, val_, col_);
+}
+
+
+void MatrixSparseSELL::vecMulAddSingle(const real* X, real* Y, index_t start, index_t stop) const
+{
+    assert_true( single_ && stop <= nchk_ );
+    SELL_MULTIPLY<1>(X, Y, start, stop, row_, chk_, flt_, col_);
+}
+
+
+void MatrixSparseSELL::vecMulAddIso2DSingle(const real* X, real* Y, index_t start, index_t stop) const
+{
+    assert_true( single_ && stop <= nchk_ );
+    SELL_MULTIPLY<2>(X, Y, start, stop, row_, chk_, flt_, col_);
+}
+
+
+void MatrixSparseSELL::vecMulAddIso3DSingle(const real* X, real* Y, index_t start, index_t stop) const
+{
+    assert_true( single_ && stop <= nchk_ );
+    SELL_MULTIPLY<3>(X, Y, start, stop, row_, chk_, flt_, col_);
+}
+
+
+std::string MatrixSparseSELL::what() const
+{
+    std::ostringstream msg;
+#if SELL_USES_AVX
+    msg << "SELLx" << SELL_CHUNK << "-" << sigma_ << ( single_ ? "f " : " " ) << nbElements();
+#else
+    msg << "SELL" << SELL_CHUNK << "-" << sigma_ << ( single_ ? "f " : " " ) << nbElements();
+#endif
+    return msg.str();
+}
@@ -0,0 +1,152 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef MATSPARSESELL_H
+#define MATSPARSESELL_H
+
+#include "real.h"
+#include "matrix.h"
+#include <string>
+
+class MatrixSparseSymmetric1;
+
+/// Number of rows processed together by MatrixSparseSELL (the 'C' of SELL-C-sigma)
+#define SELL_CHUNK 4
+
+///real symmetric sparse Matrix in SELL-C-sigma format, used only for multiplication
+/**
+ MatrixSparseSELL holds a copy of a MatrixSparseSymmetric1, in the
+ 'Sliced ELLPACK' format described by Kreutzer et al. SIAM J. Sci. Comput. 2014:
+
+ - both halves of the symmetric matrix are stored, such that each row contains
+   all its non-zero elements and can be multiplied independently of the others,
+ - empty rows are skipped, and the other rows are sorted by decreasing number of
+   elements, within windows of `sigma` consecutive rows,
+ - rows are grouped by SELL_CHUNK, and the elements of a group are interleaved,
+   such that SELL_CHUNK rows are processed in parallel by SIMD instructions,
+ - in each group, rows are padded with zeros to have the same length.
+ .
+
+ Since the result of a group only depends on this group, multiplication can
+ be distributed to multiple threads by specifying ranges of groups.
+ The matrix is built from MatrixSparseSymmetric1 by build(), which should be
+ called after all the elements have been set.
+
+ Optionally, build() also makes a copy of the values in single precision,
+ which is used by the '*Single' functions. The products are then accumulated
+ in double precision, but the memory read for the values is halved.
+*/
+class MatrixSparseSELL
+{
+private:
+
+    /// size of matrix
+    index_t   size_;
+
+    /// number of non-empty rows
+    index_t   nrow_;
+
+    /// number of groups of SELL_CHUNK rows
+    index_t   nchk_;
+
+    /// size of the windows in which rows were sorted
+    unsigned  sigma_;
+
+    /// true if flt_[] is up-to-date
+    bool      single_;
+
+    /// allocated size of row_[]
+    size_t    row_max_;
+
+    /// allocated size of val_[] and col_[]
+    size_t    val_max_;
+
+    /// allocated size of flt_[]
+    size_t    flt_max_;
+
+    /// original index of the row stored at each position (size = SELL_CHUNK * nchk_)
+    index_t * row_;
+
+    /// start of each group in val_[] and col_[] (size = nchk_+1)
+    size_t  * chk_;
+
+    /// values of the elements, interleaved by groups of SELL_CHUNK rows
+    real    * val_;
+
+    /// values of the elements in single precision, if requested in build()
+    float   * flt_;
+
+    /// column indices of the elements in val_[]
+    index_t * col_;
+
+    /// number of elements in each row, and then position, used during construction
+    size_t  * len_;
+
+    /// allocate memory
+    void allocateRows(size_t);
+
+    /// allocate memory
+    void allocateValues(size_t);
+
+public:
+
+    /// default constructor
+    MatrixSparseSELL();
+
+    /// default destructor
+    ~MatrixSparseSELL() { deallocate(); }
+
+    /// release memory
+    void deallocate();
+
+    /// return the size of the matrix
+    index_t size() const { return size_; }
+
+    /// number of groups of SELL_CHUNK rows, which can be multiplied independently
+    index_t nbChunks() const { return nchk_; }
+
+    /// copy `mat`, sorting rows within windows of `sigma` rows, and also in single precision if `single`
+    void build(MatrixSparseSymmetric1 const& mat, unsigned sigma, bool single = false);
+
+
+    /// multiplication of a vector, for groups in [start, stop[: Y <- Y + M * X with dim(X) = dim(M)
+    void vecMulAdd(const real* X, real* Y, index_t start, index_t stop) const;
+
+    /// 2D isotropic multiplication, for groups in [start, stop[: Y <- Y + M * X with dim(X) = 2 * dim(M)
+    void vecMulAddIso2D(const real* X, real* Y, index_t start, index_t stop) const;
+
+    /// 3D isotropic multiplication, for groups in [start, stop[: Y <- Y + M * X with dim(X) = 3 * dim(M)
+    void vecMulAddIso3D(const real* X, real* Y, index_t start, index_t stop) const;
+
+
+    /// multiplication with values in single precision, for groups in [start, stop[: Y <- Y + M * X with dim(X) = dim(M)
+    void vecMulAddSingle(const real* X, real* Y, index_t start, index_t stop) const;
+
+    /// 2D isotropic multiplication with values in single precision, for groups in [start, stop[
+    void vecMulAddIso2DSingle(const real* X, real* Y, index_t start, index_t stop) const;
+
+    /// 3D isotropic multiplication with values in single precision, for groups in [start, stop[
+    void vecMulAddIso3DSingle(const real* X, real* Y, index_t start, index_t stop) const;
+
+
+    /// multiplication of a vector: Y <- Y + M * X with dim(X) = dim(M)
+    void vecMulAdd(const real* X, real* Y) const { vecMulAdd(X, Y, 0, nchk_); }
+
+    /// 2D isotropic multiplication of a vector: Y <- Y + M * X with dim(X) = 2 * dim(M)
+    void vecMulAddIso2D(const real* X, real* Y) const { vecMulAddIso2D(X, Y, 0, nchk_); }
+
+    /// 3D isotropic multiplication of a vector: Y <- Y + M * X with dim(X) = 3 * dim(M)
+    void vecMulAddIso3D(const real* X, real* Y) const { vecMulAddIso3D(X, Y, 0, nchk_); }
+
+
+    /// number of elements stored, including padding
+    size_t nbElements() const { return nchk_ ? chk_[nchk_] : 0; }
+
+    /// true if the values were also copied in single precision by the last build()
+    bool hasSingle() const { return single_; }
+
+    /// returns a string which a description of the type of matrix
+    std::string what() const;
+};
+
+
+#endif
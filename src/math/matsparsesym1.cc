@@ -340,6 +340,24 @@ void MatrixSparseSymmetric1::scale(const real alpha)
 }
 
 
+/**
+ This is used to combine matrices that were filled independently,
+ and different ranges of columns can be processed in parallel.
+ */
+void MatrixSparseSymmetric1::addColumns(MatrixSparseSymmetric1 const& mat,
+                                        const index_t start, const index_t stop)
+{
+    assert_true( mat.size_ <= size_ );
+    assert_true( stop <= mat.size_ );
+    for ( index_t jj = start; jj < stop; ++jj )
+    {
+        Element const* col = mat.column_[jj];
+        for ( unsigned n = 0; n < mat.col_size_[jj]; ++n )
+            operator()(col[n].inx, jj) += col[n].val;
+    }
+}
+
+
 void MatrixSparseSymmetric1::addTriangularBlock(real* mat, const unsigned ldd,
                                                 const index_t si,
                                                 const unsigned nb,
@@ -391,6 +409,38 @@ void MatrixSparseSymmetric1::addDiagonalBlock(real* mat, unsigned ldd,
 }
 
 
+/**
+ The element (i, j) of the result, for j <= i <= j + kd, is stored in `band[i-j+(kd+1)*j]`.
+ Each element of the matrix is added on the `dim` subspaces, and elements
+ further away from the diagonal than `kd` are ignored.
+ */
+void MatrixSparseSymmetric1::addDiagonalBand(real* band, const unsigned kd,
+                                             const index_t si,
+                                             const unsigned nb,
+                                             const unsigned dim) const
+{
+    index_t up = si + nb;
+    assert_true( up <= size_ );
+    const unsigned ldb = kd + 1;
+    
+    for ( index_t jj = si; jj < up; ++jj )
+    {
+        for ( unsigned n = 0; n < col_size_[jj]; ++n )
+        {
+            index_t ii = column_[jj][n].inx;
+            // assuming lower triangle is stored:
+            assert_true( ii >= jj );
+            if ( ii < up && dim * ( ii - jj ) <= kd )
+            {
+                real * dst = band + dim * ( ii - jj ) + ldb * dim * ( jj - si );
+                for ( unsigned d = 0; d < dim; ++d )
+                    dst[ldb*d] += column_[jj][n].val;
+            }
+        }
+    }
+}
+
+
 int MatrixSparseSymmetric1::bad() const
 {
     if ( size_ <= 0 ) return 1;
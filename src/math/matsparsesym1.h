@@ -134,6 +134,12 @@ public:
     /// allocate the matrix to hold ( sz * sz )
     void allocate(size_t sz);
     
+    /// number of elements in column `jj`, including the diagonal element
+    unsigned columnSize(index_t jj) const { return col_size_[jj]; }
+    
+    /// elements of column `jj`, starting with the diagonal element
+    Element const* column(index_t jj) const { return column_[jj]; }
+
     /// returns the address of element at (x, y), no allocation is done
     real* addr(index_t x, index_t y) const;
 
@@ -146,12 +152,18 @@ public:
     /// scale the matrix by a scalar factor
     void scale(real);
     
+    /// add the elements of `mat` located in columns [start, stop[ to this matrix
+    void addColumns(MatrixSparseSymmetric1 const& mat, index_t start, index_t stop);
+    
     /// add the diagonal block ( x, x, x+sx, x+sx ) from this matrix to M
     void addDiagonalBlock(real* mat, unsigned ldd, index_t si, unsigned nb) const;
     
     /// add upper triangular half of 'this' block ( idx, idx, idx+siz, idx+siz ) to `mat`
     void addTriangularBlock(real* mat, index_t ldd, index_t si, unsigned nb, unsigned dim) const;
     
+    /// add the block ( si, si, si+nb, si+nb ) repeated `dim` times, to `band` in LAPACK symmetric lower band storage with `kd` subdiagonals
+    void addDiagonalBand(real* band, unsigned kd, index_t si, unsigned nb, unsigned dim) const;
+    
     /// create compressed storage from column-based data
     void prepareForMultiply(int);
 
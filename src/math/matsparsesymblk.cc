@@ -18,6 +18,9 @@ MatrixSparseSymmetricBlock::MatrixSparseSymmetricBlock()
 {
     allocated_ = 0;
     column_    = nullptr;
+    flt_       = nullptr;
+    flt_max_   = 0;
+    single_    = false;
     
     next_  = new index_t[1];
     next_[0] = 0;
@@ -60,9 +63,13 @@ void MatrixSparseSymmetricBlock::deallocate()
 {
     delete[] column_;
     delete[] next_;
+    delete[] flt_;
     column_ = nullptr;
     next_   = nullptr;
+    flt_    = nullptr;
     allocated_ = 0;
+    flt_max_ = 0;
+    single_ = false;
 }
 
 
@@ -276,6 +283,24 @@ void MatrixSparseSymmetricBlock::scale(const real alpha)
 }
 
 
+/**
+ This is used to combine matrices that were filled independently,
+ and different ranges of columns can be processed in parallel.
+ */
+void MatrixSparseSymmetricBlock::addColumns(MatrixSparseSymmetricBlock const& mat,
+                                            const index_t start, const index_t stop)
+{
+    assert_true( mat.size_ <= size_ );
+    assert_true( stop <= mat.size_ );
+    for ( index_t jj = start; jj < stop; ++jj )
+    {
+        Column const& col = mat.column_[jj];
+        for ( unsigned n = 0 ; n < col.size_ ; ++n )
+            column_[jj].block(col.inx_[n], jj).add_full(col.blk_[n]);
+    }
+}
+
+
 void MatrixSparseSymmetricBlock::addTriangularBlock(real* mat, const unsigned ldd,
                                                 const index_t si,
                                                 const unsigned nb,
@@ -346,6 +371,48 @@ void MatrixSparseSymmetricBlock::addDiagonalBlock(real* mat, unsigned ldd,
 }
 
 
+/**
+ The element (i, j) of the result, for j <= i <= j + kd, is stored in `band[i-j+(kd+1)*j]`.
+ Elements further away from the diagonal than `kd` are ignored.
+ */
+void MatrixSparseSymmetricBlock::addDiagonalBand(real* band, const unsigned kd,
+                                                 const index_t si,
+                                                 const unsigned nb) const
+{
+    if ( si % BLOCK_SIZE )  ABORT_NOW("index incompatible with matrix block size");
+    if ( nb % BLOCK_SIZE )  ABORT_NOW("size incompatible with matrix block size");
+    
+    index_t up = si + nb;
+    assert_true( up <= size_ );
+    const unsigned ldb = kd + 1;
+    
+    for ( index_t jj = si; jj < up; ++jj )
+    {
+        Column & col = column_[jj];
+        for ( index_t n = 0; n < col.size_; ++n )
+        {
+            index_t ii = col.inx_[n];
+            // assuming lower triangle is stored:
+            assert_true( ii >= jj );
+            if ( ii < up )
+            {
+                SquareBlock const& blk = col[n];
+                for ( int b = 0; b < BLOCK_SIZE; ++b )
+                {
+                    // only the lower part of the diagonal block is used:
+                    for ( int a = ( ii == jj ? b : 0 ); a < BLOCK_SIZE; ++a )
+                    {
+                        const index_t d = ii + a - ( jj + b );
+                        if ( d <= kd )
+                            band[d+ldb*(jj+b-si)] += blk(a, b);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
 int MatrixSparseSymmetricBlock::bad() const
 {
     if ( size_ <= 0 ) return 1;
@@ -509,7 +576,11 @@ size_t newElements(MatrixSparseSymmetricBlock::Element*& ptr, size_t size)
 }
 
 
-void MatrixSparseSymmetricBlock::prepareForMultiply(int)
+/**
+ If `single`, the blocks are also copied in single precision, in the order in
+ which they are visited by vecMulAddSingle()
+ */
+void MatrixSparseSymmetricBlock::prepareForMultiply(int, bool single)
 {
     next_[size_] = size_;
     
@@ -565,6 +636,31 @@ void MatrixSparseSymmetricBlock::prepareForMultiply(int)
     
     newElements(tmp, 0);
     //std::clog << "MatrixSparseSymmetricBlock " << size_ << " with " << cnt << " non-empty columns\n";
+
+    single_ = single;
+    if ( single )
+    {
+        constexpr size_t BB = BLOCK_SIZE * BLOCK_SIZE;
+        size_t cnt = BB * nbElements();
+        if ( cnt > flt_max_ )
+        {
+            delete[] flt_;
+            flt_max_ = cnt + cnt / 4;
+            flt_ = new float[flt_max_];
+        }
+        float * F = flt_;
+        for ( index_t jj = next_[0]; jj < size_; jj = next_[jj+1] )
+        {
+            Column const& col = column_[jj];
+            for ( unsigned n = 0; n < col.size_; ++n )
+            {
+                for ( int j = 0; j < BLOCK_SIZE; ++j )
+                for ( int i = 0; i < BLOCK_SIZE; ++i )
+                    F[i+BLOCK_SIZE*j] = (float)col.blk_[n](i, j);
+                F += BB;
+            }
+        }
+    }
 }
 
 
@@ -1190,6 +1286,47 @@ void MatrixSparseSymmetricBlock::vecMulAdd_ALT(const real* X, real* Y) const
     }
 }
 
+/**
+ Multiplication using the blocks in single precision, made by prepareForMultiply().
+ The products are accumulated in double precision.
+ */
+void MatrixSparseSymmetricBlock::vecMulAddSingle(const real* X, real* Y) const
+{
+    assert_true( single_ );
+    float const* M = flt_;
+    for ( index_t jj = next_[0]; jj < size_; jj = next_[jj+1] )
+    {
+        Column const& col = column_[jj];
+        real const* x = X + jj;
+        real y[BLOCK_SIZE] = { 0 };
+        // the diagonal block is symmetric:
+        for ( int j = 0; j < BLOCK_SIZE; ++j )
+        for ( int i = 0; i < BLOCK_SIZE; ++i )
+            y[i] += M[i+BLOCK_SIZE*j] * x[j];
+        M += BLOCK_SIZE * BLOCK_SIZE;
+        for ( unsigned n = 1; n < col.size_; ++n )
+        {
+            real const* xi = X + col.inx_[n];
+            real * yi = Y + col.inx_[n];
+            for ( int j = 0; j < BLOCK_SIZE; ++j )
+            {
+                real sum = 0;
+                for ( int i = 0; i < BLOCK_SIZE; ++i )
+                {
+                    const real m = M[i+BLOCK_SIZE*j];
+                    yi[i] += m * x[j];
+                    sum += m * xi[i];
+                }
+                y[j] += sum;
+            }
+            M += BLOCK_SIZE * BLOCK_SIZE;
+        }
+        for ( int i = 0; i < BLOCK_SIZE; ++i )
+            Y[jj+i] += y[i];
+    }
+}
+
+
 #define TIME_PRINTOUT 0
 
 // multiplication of a vector: Y = Y + M * X
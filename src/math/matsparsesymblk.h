@@ -149,6 +149,15 @@ private:
     /// next_[ii] is the index of the first non-empty column of index >= ii
     index_t * next_;
 
+    /// copy of the blocks in single precision, in the order of the columns
+    float   * flt_;
+
+    /// allocated size of flt_[]
+    size_t    flt_max_;
+
+    /// true if flt_[] is up-to-date
+    bool      single_;
+
 public:
     
     /// return the size of the matrix
@@ -202,15 +211,21 @@ public:
     /// scale the matrix by a scalar factor
     void scale(real);
     
+    /// add the blocks of `mat` located in columns [start, stop[ to this matrix
+    void addColumns(MatrixSparseSymmetricBlock const& mat, index_t start, index_t stop);
+    
     /// add the diagonal block ( x, x, x+sx, x+sx ) from this matrix to M
     void addDiagonalBlock(real* mat, unsigned ldd, index_t si, unsigned nb) const;
     
     /// add upper triangular half of 'this' block ( idx, idx, idx+siz, idx+siz ) to `mat`
     void addTriangularBlock(real* mat, index_t ldd, index_t si, unsigned nb, unsigned dim) const;
     
+    /// add the block ( si, si, si+nb, si+nb ) to `band` in LAPACK symmetric lower band storage with `kd` subdiagonals
+    void addDiagonalBand(real* band, unsigned kd, index_t si, unsigned nb) const;
+    
     
-    ///optional optimization that may accelerate multiplications by a vector
-    void prepareForMultiply(int dim);
+    ///optional optimization that may accelerate multiplications by a vector, also copying the blocks in single precision if `single`
+    void prepareForMultiply(int dim, bool single = false);
 
     /// multiplication of a vector, for columns within [start, end[
     void vecMulAdd(const real*, real* Y, index_t start, index_t end) const;
@@ -218,6 +233,9 @@ public:
     /// multiplication of a vector: Y <- Y + M * X with dim(X) = dim(Y) = dim(M)
     void vecMulAdd(const real* X, real* Y) const { vecMulAdd(X, Y, 0, size_); }
 
+    /// multiplication using the copy in single precision: Y <- Y + M * X with dim(X) = dim(Y) = dim(M)
+    void vecMulAddSingle(const real* X, real* Y) const;
+
     /// multiplication of a vector: Y <- Y + M * X with dim(X) = dim(Y) = dim(M)
     void vecMulAdd_TIME(const real* X, real* Y) const;
 
@@ -144,7 +144,7 @@ void Bead::projectForces(const real* X, real* Y) const
 
 void Bead::write(Outputter& out) const
 {
-    out.writeFloats(position(), DIM, '\n');
+    writePoints(out, position(), 1, '\n');
     out.writeSoftSpace(2);
     out.writeFloat(paRadius);
 }
@@ -153,7 +153,7 @@ void Bead::write(Outputter& out) const
 void Bead::read(Inputter& in, Simul&, ObjectTag)
 {
     Vector pos;
-    in.readFloats(pos, DIM);
+    readPoints(in, pos, 1);
     setPoint(0, pos);
     real r = in.readFloat();
     resize(r);
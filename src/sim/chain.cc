@@ -1093,7 +1093,6 @@ std::vector<double> Chain::bendingEnergySegments() const
             e_length.push_back(e_seg_energy);
         }
     }
-    std::cout << std::setprecision(10);
     return e_length;
 }
 
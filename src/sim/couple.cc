@@ -19,7 +19,7 @@ extern Modulo const* modulo;
 //------------------------------------------------------------------------------
 
 Couple::Couple(CoupleProp const* p, Vector const& w)
-: prop(p), cPos(w), cHand1(nullptr), cHand2(nullptr)
+: prop(p), cPos(w), cHand1(nullptr), cHand2(nullptr), cSlot(0)
 {
     cHand1 = prop->hand1_prop->newHand(this);
     cHand2 = prop->hand2_prop->newHand(this);
@@ -418,7 +418,7 @@ void Couple::write(Outputter& out) const
     cHand1->write(out);
     cHand2->write(out);
     if ( !attached1() && !attached2() )
-        out.writeFloats(cPos, DIM);
+        writePoints(out, cPos, 1);
 }
 
 
@@ -433,7 +433,7 @@ void Couple::read(Inputter& in, Simul& sim, ObjectTag tag)
     if ( attached1() || attached2() )
         cPos = position();
     else
-        in.readFloats(cPos, DIM);
+        readPoints(in, cPos, 1);
     
     /*
      Because the CoupleSet contains 4 sublists where Couple are stored depending
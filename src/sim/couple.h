@@ -40,6 +40,8 @@ class Meca;
  */
 class Couple : public Object, public HandMonitor
 {
+    friend class CoupleSet;
+    
 public:
 
     /// associated properties
@@ -56,6 +58,9 @@ protected:
     /// second Hand
     Hand * cHand2;
     
+    /// position in CoupleSet's batch, used with simul:batch_couples
+    size_t cSlot;
+    
     
     /// specialization of HandMonitor
     bool      allowAttachment(FiberSite const&);
@@ -32,10 +32,12 @@ void CoupleProp::clear()
     hand2             = "";
     hand1_prop        = nullptr;
     hand2_prop        = nullptr;
+    detach_scheduled  = false;
     stiffness         = -1;
     length            = 0;
     diffusion         = 0;
     fast_diffusion    = false;
+    reservoir_step    = 0;
     trans_activated   = 0;
     stiff             = true;
     specificity       = BIND_ALWAYS;
@@ -60,6 +62,7 @@ void CoupleProp::read(Glossary& glos)
     else
         glos.set(diffusion,       "diffusion");
     glos.set(fast_diffusion,  "fast_diffusion");
+    glos.set(reservoir_step,  "reservoir_step", 0, "fast_diffusion", 1);
     
     glos.set(trans_activated, "trans_activated");
     glos.set(stiff,           "stiff");
@@ -110,6 +113,9 @@ void CoupleProp::complete(Simul const& sim)
         if ( !confine_space_ptr )
             throw InvalidParameter(name()+":confine_space `"+confine_space+"' was not found");
     }
+
+    if ( reservoir_step < 0 )
+        throw InvalidParameter(name()+":reservoir_step must be >= 0");
     
     if ( length < 0 )
         throw InvalidParameter("couple:length must be >= 0");
@@ -136,6 +142,14 @@ void CoupleProp::complete(Simul const& sim)
         throw InvalidParameter("couple:hand2 must be defined");
     hand2_prop = sim.findProperty<HandProp>("hand", hand2);
     
+    /*
+     With simul:detach_queue, the detachment of Hands that unbind with a
+     constant rate is scheduled at the time of attachment.
+     */
+    detach_scheduled = sim.prop->detach_queue && plainSteps()
+                    && hand1_prop->constantUnbinding()
+                    && hand2_prop->constantUnbinding();
+    
     if ( sim.ready() )
     {
         hand1_prop->checkStiffness(stiffness, length, 2, sim.prop->kT);
@@ -167,6 +181,7 @@ void CoupleProp::write_values(std::ostream& os) const
     write_value(os, "length",          length);
     write_value(os, "diffusion",       diffusion);
     write_value(os, "fast_diffusion",  fast_diffusion);
+    write_value(os, "reservoir_step",  reservoir_step);
     write_value(os, "trans_activated", trans_activated);
     write_value(os, "stiff",           stiff);
     write_value(os, "specificity",     specificity);
@@ -17,6 +17,7 @@ class Space;
 class CoupleProp : public Property
 {
     friend class Couple;
+    friend class CoupleSet;
     
 public:
     
@@ -100,6 +101,21 @@ public:
      */
     int          fast_diffusion;
     
+    /// if set > 0, free Couples are counted on a grid of this size (also known as `fast_diffusion[1]`)
+    /**
+     This refines `fast_diffusion = 1`, for systems where the free Couples or the
+     fibers are not uniformly distributed. The Space is divided in voxels of size
+     `reservoir_step`, and each free Couple is only recorded in the voxel in which
+     it was released. Couples hop between adjacent voxels at a rate derived from
+     `diffusion`, and attach along the fibers in proportion to the local
+     concentration in the voxel containing each segment of the fiber.
+     
+     The step should be larger than the segmentation of the fibers, and
+     comparable to `sqrt(diffusion * time_step)` or larger.
+     This is ignored if `fast_diffusion != 1`.
+     */
+    real         reservoir_step;
+    
     /// if ( trans_activated == 1 ), Hand2 is active only if Hand1 is bound
     /**
      Both Hands of a Couple are normally equally active. With this feature,
@@ -163,6 +179,9 @@ public:
     HandProp *    hand1_prop;
     /// pointer to Property of Hand 2
     HandProp *    hand2_prop;
+    
+    /// derived variable: true if detachment of both Hands is handled by CoupleSet's HandQueue
+    bool          detach_scheduled;
 
 protected:
     
@@ -193,6 +212,9 @@ public:
     /// compute derived parameter values
     void complete(Simul const&);
     
+    /// true if the Couple class does not redefine stepAF(), stepFA() and stepAA()
+    virtual bool plainSteps() const { return true; }
+    
     /// return a carbon copy of object
     Property* clone() const { return new CoupleProp(*this); }
 
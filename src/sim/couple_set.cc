@@ -8,8 +8,10 @@
 #include "shackle_prop.h"
 #include "bridge_prop.h"
 #include "duo_prop.h"
+#include "motor.h"
 #include "glossary.h"
 #include "simul.h"
+#include <algorithm>
 
 
 /**
@@ -79,9 +81,26 @@ Property* CoupleSet::newProperty(const std::string& cat, const std::string& nom,
 
 //------------------------------------------------------------------------------
 
+CoupleSet::~CoupleSet()
+{
+    for ( Reservoir * r : uniGrids )
+        delete r;
+}
+
+
 void CoupleSet::prepare(PropertyList const& properties)
 {
     uni = uniPrepare(properties);
+    queued = queuePrepare(properties);
+    batch = batchPrepare(properties);
+}
+
+
+void CoupleSet::relax()
+{
+    uniRelax();
+    queue.release(simul.time());
+    batchRelax();
 }
 
 
@@ -93,6 +112,20 @@ void CoupleSet::step()
         uniCollect();
         uniAttach(simul.fibers);
     }
+    
+    // process Couples by class:
+    if ( batch )
+    {
+        stepBatches();
+        return;
+    }
+    
+    // use alternative detachment strategy:
+    if ( queued )
+    {
+        stepQueued();
+        return;
+    }
 
     /*
      ATTENTION: We ensure here that step() is called exactly once for each object.
@@ -188,6 +221,392 @@ void CoupleSet::step()
 }
 
 
+//------------------------------------------------------------------------------
+#pragma mark - Detachment queue
+
+/**
+ simul:detach_queue is enabled if any Couple class has `detach_scheduled`
+ */
+bool CoupleSet::queuePrepare(PropertyList const& properties)
+{
+    bool res = false;
+    queuedAll = true;
+    
+    for ( Property const* i : properties.find_all("couple") )
+    {
+        CoupleProp const * p = static_cast<CoupleProp const*>(i);
+        res |= p->detach_scheduled;
+        queuedAll &= p->detach_scheduled;
+    }
+    
+    return res;
+}
+
+
+/**
+ This is done at the first step following prepare() or relax(),
+ since relax() converts the queue back into Hand::nextDetach.
+ Afterwards, Hands are scheduled by relinkA1() and relinkA2().
+ */
+void CoupleSet::queueCollect()
+{
+    if ( queue.active() )
+        return;
+    
+    queue.activate();
+    const real now = simul.time();
+
+    for ( Couple * c = firstAA(); c; c = c->next() )
+    {
+        if ( c->prop->detach_scheduled )
+        {
+            queue.schedule(c->hand1(), now);
+            queue.schedule(c->hand2(), now);
+        }
+    }
+    for ( Couple * c = firstAF(); c; c = c->next() )
+    {
+        if ( c->prop->detach_scheduled )
+            queue.schedule(c->hand1(), now);
+    }
+    for ( Couple * c = firstFA(); c; c = c->next() )
+    {
+        if ( c->prop->detach_scheduled )
+            queue.schedule(c->hand2(), now);
+    }
+}
+
+
+/**
+ The Hands whose time has come are detached first, and the Couples are then
+ processed as in step(), except that for Couples with `detach_scheduled`:
+ - a bridging Couple is skipped,
+ - for a Couple with one Hand attached, only the other Hand is stepped.
+ .
+ If all Couple classes have `detach_scheduled`, the list of bridging Couples
+ is not traversed at all.
+ */
+void CoupleSet::stepQueued()
+{
+    queueCollect();
+    queue.fire(simul.time());
+
+    Couple *const ffHead = firstFF();
+    Couple *const afHead = firstAF();
+    Couple *const faHead = firstFA();
+    
+    Couple * obj, * nxt;
+
+    if ( !queuedAll )
+    {
+        for ( obj = firstAA(); obj; obj = nxt )
+        {
+            nxt = obj->next();
+            if ( !obj->prop->detach_scheduled )
+                obj->stepAA();
+        }
+    }
+    
+    for ( obj = faHead; obj; obj = nxt )
+    {
+        nxt = obj->next();
+        if ( obj->prop->detach_scheduled )
+            obj->hand1()->stepUnattached(simul, obj->hand2()->pos());
+        else
+            obj->stepFA(simul);
+    }
+    
+    for ( obj = afHead; obj; obj = nxt )
+    {
+        nxt = obj->next();
+        if ( obj->prop->detach_scheduled )
+            obj->hand2()->stepUnattached(simul, obj->hand1()->pos());
+        else
+            obj->stepAF(simul);
+    }
+    
+    for ( obj = ffHead; obj; obj = nxt )
+    {
+        nxt = obj->next();
+        obj->stepFF(simul);
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - Batches
+
+/// calls the virtual functions of Hand
+struct AnyHand
+{
+    static void stepUnattached(Hand * h, Simul& sim, Vector const& pos) { h->stepUnattached(sim, pos); }
+    static void stepUnloaded(Hand * h) { h->stepUnloaded(); }
+    static void stepLoaded(Hand * h, Vector const& f, real fn) { h->stepLoaded(f, fn); }
+};
+
+
+/// calls the functions of class HAND directly, which must be the exact class of the Hand
+template < typename HAND >
+struct ExactHand
+{
+    static void stepUnattached(Hand * h, Simul& sim, Vector const& pos) { static_cast<HAND*>(h)->HAND::stepUnattached(sim, pos); }
+    static void stepUnloaded(Hand * h) { static_cast<HAND*>(h)->HAND::stepUnloaded(); }
+    static void stepLoaded(Hand * h, Vector const& f, real fn) { static_cast<HAND*>(h)->HAND::stepLoaded(f, fn); }
+};
+
+
+/**
+ Return a code designating the class of Hand created by HandProp::newProperty():
+ - 1 for Hand (activity = bind),
+ - 2 for Motor (activity = move),
+ - 0 otherwise.
+ .
+ */
+static int handKind(HandProp const* p)
+{
+    if ( p->activity == "bind" )
+        return 1;
+    if ( p->activity == "move" || p->activity == "motor" )
+        return 2;
+    return 0;
+}
+
+
+bool CoupleSet::batchPrepare(PropertyList const& properties)
+{
+    batches.clear();
+    
+    if ( !simul.prop->batch_couples )
+        return false;
+    
+    unsigned last = 0;
+    for ( Property const* i : properties.find_all("couple") )
+        last = std::max(last, i->number());
+    
+    CoupleBatch nil = { nullptr, -1 };
+    batches.resize(last+1, nil);
+    
+    for ( Property const* i : properties.find_all("couple") )
+    {
+        CoupleProp const * p = static_cast<CoupleProp const*>(i);
+        CoupleBatch & bat = batches[p->number()];
+        bat.prop = p;
+        if ( p->plainSteps() )
+            bat.kind = 3 * handKind(p->hand1_prop) + handKind(p->hand2_prop);
+    }
+    
+    return true;
+}
+
+
+CoupleSet::CoupleReserveList * CoupleSet::batchList(Couple const* obj, bool a1, bool a2)
+{
+    assert_true( obj->prop->number() < batches.size() );
+    CoupleBatch & bat = batches[obj->prop->number()];
+    if ( a1 )
+    {
+        if ( a2 ) return &bat.aa; else return &bat.af;
+    }
+    else
+    {
+        if ( a2 ) return &bat.fa; else return nullptr;
+    }
+}
+
+
+void CoupleSet::batchLink(Couple * obj, bool a1, bool a2)
+{
+    CoupleReserveList * list = batchList(obj, a1, a2);
+    if ( list )
+    {
+        obj->cSlot = list->size();
+        list->push_back(obj);
+    }
+}
+
+
+void CoupleSet::batchUnlink(Couple * obj, bool a1, bool a2)
+{
+    CoupleReserveList * list = batchList(obj, a1, a2);
+    if ( list )
+    {
+        assert_true( list->at(obj->cSlot) == obj );
+        Couple * last = list->back();
+        (*list)[obj->cSlot] = last;
+        last->cSlot = obj->cSlot;
+        list->pop_back();
+    }
+}
+
+
+/**
+ This is done at the first step following prepare() or relax().
+ Afterwards, the batches are updated by link(), unlink() and the relink functions.
+ */
+void CoupleSet::batchCollect()
+{
+    if ( batchActive )
+        return;
+    
+    batchActive = true;
+    Couple * obj;
+    for ( obj = firstAA(); obj; obj = obj->next() )
+        batchLink(obj, true, true);
+    for ( obj = firstFA(); obj; obj = obj->next() )
+        batchLink(obj, false, true);
+    for ( obj = firstAF(); obj; obj = obj->next() )
+        batchLink(obj, true, false);
+}
+
+
+void CoupleSet::batchRelax()
+{
+    for ( CoupleBatch & bat : batches )
+    {
+        bat.aa.clear();
+        bat.fa.clear();
+        bat.af.clear();
+    }
+    batchActive = false;
+}
+
+
+/// distance at which Couples and their Hands are prefetched in stepBatch()
+#define BATCH_PREFETCH 8
+
+/// request the Couple and its Hands to be loaded in the cache
+static inline void prefetchCouple(Couple const* obj)
+{
+    __builtin_prefetch(obj->hand1());
+    __builtin_prefetch(obj->hand2());
+}
+
+
+/**
+ This reproduces Couple::stepAA(), stepFA() and stepAF(), for a Couple class
+ that does not redefine them (CoupleProp::plainSteps()).
+ Since the Couples are stored in arrays, they can be prefetched.
+ */
+template < typename H1, typename H2 >
+void CoupleSet::stepBatch(CoupleBatch const& bat)
+{
+    CoupleReserveList const& aa = bat.aa;
+    CoupleReserveList const& fa = bat.fa;
+    CoupleReserveList const& af = bat.af;
+
+    // bridging Couples have nothing to do if detachment is scheduled:
+    if ( !bat.prop->detach_scheduled )
+    {
+        for ( size_t i = 0; i < aa.size(); ++i )
+        {
+            if ( i + BATCH_PREFETCH < aa.size() )
+                prefetchCouple(aa[i+BATCH_PREFETCH]);
+            Couple * obj = aa[i];
+            Vector f = obj->force();
+            real fn = f.norm();
+            H1::stepLoaded(obj->hand1(),  f, fn);
+            H2::stepLoaded(obj->hand2(), -f, fn);
+        }
+    }
+    
+    for ( size_t i = 0; i < fa.size(); ++i )
+    {
+        if ( i + BATCH_PREFETCH < fa.size() )
+            prefetchCouple(fa[i+BATCH_PREFETCH]);
+        Couple * obj = fa[i];
+        //we use hand2->pos() first, because stepUnloaded() may detach hand2
+        H1::stepUnattached(obj->hand1(), simul, obj->hand2()->pos());
+        if ( !bat.prop->detach_scheduled )
+            H2::stepUnloaded(obj->hand2());
+    }
+    
+    for ( size_t i = 0; i < af.size(); ++i )
+    {
+        if ( i + BATCH_PREFETCH < af.size() )
+            prefetchCouple(af[i+BATCH_PREFETCH]);
+        Couple * obj = af[i];
+        H2::stepUnattached(obj->hand2(), simul, obj->hand1()->pos());
+        if ( !bat.prop->detach_scheduled )
+            H1::stepUnloaded(obj->hand1());
+    }
+}
+
+
+void CoupleSet::stepBatch(CoupleBatch const& bat)
+{
+    for ( Couple * obj : bat.aa )
+        obj->stepAA();
+    for ( Couple * obj : bat.fa )
+        obj->stepFA(simul);
+    for ( Couple * obj : bat.af )
+        obj->stepAF(simul);
+}
+
+
+/**
+ Rotate the array in the same way as NodeList::shuffle()
+ */
+static void shuffleBatch(std::vector<Couple*>& vec)
+{
+    if ( vec.size() > 2 )
+    {
+        size_t p = RNG.pint32(vec.size());
+        std::rotate(vec.begin(), vec.begin()+p, vec.end());
+    }
+}
+
+
+/**
+ The attached Couples are processed by class, and the free Couples as in step().
+ Each batch is copied before it is processed, since Couples are transferred
+ from one list to another if their Hands bind or unbind, and the copy is
+ rotated by a random amount, to vary the order in which Couples are processed.
+ */
+void CoupleSet::stepBatches()
+{
+    if ( queued )
+    {
+        queueCollect();
+        queue.fire(simul.time());
+    }
+    batchCollect();
+    
+    Couple *const ffHead = firstFF();
+
+    for ( CoupleBatch const& bat : batches )
+    {
+        if ( !bat.prop )
+            continue;
+        batchCopy.prop = bat.prop;
+        batchCopy.aa = bat.aa;
+        batchCopy.fa = bat.fa;
+        batchCopy.af = bat.af;
+        shuffleBatch(batchCopy.aa);
+        shuffleBatch(batchCopy.fa);
+        shuffleBatch(batchCopy.af);
+        
+        switch ( bat.kind )
+        {
+            case 0: stepBatch<AnyHand, AnyHand>(batchCopy); break;
+            case 1: stepBatch<AnyHand, ExactHand<Hand>>(batchCopy); break;
+            case 2: stepBatch<AnyHand, ExactHand<Motor>>(batchCopy); break;
+            case 3: stepBatch<ExactHand<Hand>, AnyHand>(batchCopy); break;
+            case 4: stepBatch<ExactHand<Hand>, ExactHand<Hand>>(batchCopy); break;
+            case 5: stepBatch<ExactHand<Hand>, ExactHand<Motor>>(batchCopy); break;
+            case 6: stepBatch<ExactHand<Motor>, AnyHand>(batchCopy); break;
+            case 7: stepBatch<ExactHand<Motor>, ExactHand<Hand>>(batchCopy); break;
+            case 8: stepBatch<ExactHand<Motor>, ExactHand<Motor>>(batchCopy); break;
+            default: stepBatch(batchCopy); break;
+        }
+    }
+    
+    Couple * obj, * nxt;
+    for ( obj = ffHead; obj; obj = nxt )
+    {
+        nxt = obj->next();
+        obj->stepFF(simul);
+    }
+}
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -263,6 +682,12 @@ ObjectList CoupleSet::newObjects(const std::string& name, Glossary& opt)
 void CoupleSet::relinkA1(Couple * obj)
 {
     assert_true( obj->attached1() );
+    
+    if ( batchActive )
+    {
+        batchUnlink(obj, false, obj->attached2());
+        batchLink(obj, true, obj->attached2());
+    }
 
     if ( obj->attached2() )
     {
@@ -274,12 +699,22 @@ void CoupleSet::relinkA1(Couple * obj)
         ffList.pop(obj);
         afList.push_front(obj);
     }
+    
+    if ( queue.active() && obj->prop->detach_scheduled )
+        queue.schedule(obj->hand1(), simul.time());
 }
 
 
 void CoupleSet::relinkD1(Couple * obj)
 {
     assert_true( obj->attached1() );
+    queue.remove(obj->hand1());
+    
+    if ( batchActive )
+    {
+        batchUnlink(obj, true, obj->attached2());
+        batchLink(obj, false, obj->attached2());
+    }
     
     if ( obj->attached2() )
     {
@@ -297,6 +732,12 @@ void CoupleSet::relinkD1(Couple * obj)
 void CoupleSet::relinkA2(Couple * obj)
 {
     assert_true( obj->attached2() );
+    
+    if ( batchActive )
+    {
+        batchUnlink(obj, obj->attached1(), false);
+        batchLink(obj, obj->attached1(), true);
+    }
 
     if ( obj->attached1() )
     {
@@ -308,12 +749,23 @@ void CoupleSet::relinkA2(Couple * obj)
         ffList.pop(obj);
         faList.push_front(obj);
     }
+    
+    if ( queue.active() && obj->prop->detach_scheduled )
+        queue.schedule(obj->hand2(), simul.time());
 }
 
 
 void CoupleSet::relinkD2(Couple * obj)
 {
     assert_true( obj->attached2() );
+    queue.remove(obj->hand2());
+    
+    if ( batchActive )
+    {
+        batchUnlink(obj, obj->attached1(), true);
+        batchLink(obj, obj->attached1(), false);
+    }
+    
 
     if ( obj->attached1() )
     {
@@ -336,6 +788,22 @@ void CoupleSet::link(Object * obj)
     obj->objset(this);
     Couple * c = static_cast<Couple*>(obj);
     sublist(c->attached1(), c->attached2()).push_front(obj);
+    
+    if ( batchActive )
+        batchLink(c, c->attached1(), c->attached2());
+    
+    /*
+     A Couple can be linked with Hands already attached, for example by uniAttach(),
+     and since afterAttachment() was then called without a CoupleSet,
+     the Hands must be scheduled here, as done by relinkA1() and relinkA2()
+     */
+    if ( queue.active() && c->prop->detach_scheduled )
+    {
+        if ( c->attached1() )
+            queue.schedule(c->hand1(), simul.time());
+        if ( c->attached2() )
+            queue.schedule(c->hand2(), simul.time());
+    }
 }
 
 
@@ -365,6 +833,12 @@ void CoupleSet::relink(Object * obj, const bool s1, const bool s2)
     sublist(s1, s2).pop(obj);
     Couple * c = static_cast<Couple*>(obj);
     sublist(c->attached1(), c->attached2()).push_front(obj);
+    
+    if ( batchActive )
+    {
+        batchUnlink(c, s1, s2);
+        batchLink(c, c->attached1(), c->attached2());
+    }
 }
 
 
@@ -413,7 +887,11 @@ void CoupleSet::freeze(ObjectFlag f)
 
 void CoupleSet::deleteAA(Couple * c)
 {
+    if ( batchActive )
+        batchUnlink(c, true, true);
+    queue.remove(c->hand1());
     c->hand1()->detachHand();
+    queue.remove(c->hand2());
     c->hand2()->detachHand();
     inventory.unassign(c);
     c->objset(nullptr);
@@ -424,6 +902,9 @@ void CoupleSet::deleteAA(Couple * c)
 
 void CoupleSet::deleteFA(Couple * c)
 {
+    if ( batchActive )
+        batchUnlink(c, false, true);
+    queue.remove(c->hand2());
     c->hand2()->detachHand();
     inventory.unassign(c);
     c->objset(nullptr);
@@ -434,6 +915,9 @@ void CoupleSet::deleteFA(Couple * c)
 
 void CoupleSet::deleteAF(Couple * c)
 {
+    if ( batchActive )
+        batchUnlink(c, true, false);
+    queue.remove(c->hand1());
     c->hand1()->detachHand();
     inventory.unassign(c);
     c->objset(nullptr);
@@ -762,13 +1246,93 @@ void CoupleSet::uniAttach(FiberSet const& fibers)
         
         uniAttach2(loc, reserve);
     }
+    
+    // attachment from the local concentration of gridded reserves:
+    for ( Reservoir * r : uniGrids )
+    {
+        if ( r )
+            uniAttach(fibers, *r);
+    }
+}
+
+
+/**
+ Distribute Hand1 of Couples on the sites specified in `loc`,
+ taking the Couples from the voxels specified in `vox`
+ */
+void CoupleSet::uniAttach1(Array<FiberSite>& loc, Array<Reservoir::index_t>& vox, Reservoir& res)
+{
+    for ( size_t n = 0; n < loc.size(); ++n )
+    {
+        Reservoir::Pool & can = res.pool(vox[n]);
+        if ( can.empty() )
+            continue;
+        Couple * c = static_cast<Couple*>(can.back());
+        if ( c->hand1()->attachmentAllowed(loc[n]) )
+        {
+            can.pop_back();
+            c->attach1(loc[n]);
+            link(c);
+        }
+    }
+}
+
+
+/**
+ Distribute Hand2 of Couples on the sites specified in `loc`,
+ taking the Couples from the voxels specified in `vox`
+ */
+void CoupleSet::uniAttach2(Array<FiberSite>& loc, Array<Reservoir::index_t>& vox, Reservoir& res)
+{
+    for ( size_t n = 0; n < loc.size(); ++n )
+    {
+        Reservoir::Pool & can = res.pool(vox[n]);
+        if ( can.empty() )
+            continue;
+        Couple * c = static_cast<Couple*>(can.back());
+        if ( c->hand2()->attachmentAllowed(loc[n]) )
+        {
+            can.pop_back();
+            c->attach2(loc[n]);
+            link(c);
+        }
+    }
+}
+
+
+/**
+ Variant of uniAttach() used if ( couple:reservoir_step > 0 ), in which the
+ free Couples are counted in the voxels of a coarse grid, and diffuse between
+ adjacent voxels. The density of binding sites along a segment of fiber is
+ derived from the number of Couples in the voxel containing this segment,
+ rather than from the total number of free Couples.
+ */
+void CoupleSet::uniAttach(FiberSet const& fibers, Reservoir& res)
+{
+    CoupleProp const * p = static_cast<CoupleProp const*>(res.property());
+
+    Array<FiberSite> loc(1024);
+    Array<Reservoir::index_t> vox(1024);
+    
+    res.diffuse();
+
+    res.fiberSites(fibers, 2 / p->hand1_prop->bindingSectionProb(), loc, vox);
+    uniAttach1(loc, vox, res);
+    
+    // if ( couple:trans_activated == true ), Hand2 cannot bind
+    if ( p->trans_activated )
+        return;
+    
+    res.fiberSites(fibers, 2 / p->hand2_prop->bindingSectionProb(), loc, vox);
+    uniAttach2(loc, vox, res);
 }
 
 
 /**
  
  Return true if at least one couple:fast_diffusion is true,
- and in this case allocate uniLists.
+ and in this case allocate uniLists, and uniGrids for the classes
+ with `couple:reservoir_step > 0`.
  
  The Volume of the Space is assumed to remain constant until the next uniPrepare() 
  */
@@ -784,8 +1348,28 @@ bool CoupleSet::uniPrepare(PropertyList const& properties)
         last = std::max(last, p->number());
     }
     
+    // objects that are still held by the Reservoirs are returned to the lists:
+    uniRelax();
+    for ( Reservoir * r : uniGrids )
+        delete r;
+    uniGrids.clear();
+
     if ( res )
+    {
         uniLists.resize(last+1);
+        uniGrids.resize(last+1, nullptr);
+        
+        for ( Property const* i : properties.find_all("couple") )
+        {
+            CoupleProp const * p = static_cast<CoupleProp const*>(i);
+            if ( p->fast_diffusion == 1 && p->reservoir_step > 0 )
+            {
+                Reservoir * r = new Reservoir(p);
+                r->setGrid(p->confine_space_ptr, p->reservoir_step, p->diffusion, simul.time_step());
+                uniGrids[p->number()] = r;
+            }
+        }
+    }
     
     return res;
 }
@@ -805,7 +1389,10 @@ void CoupleSet::uniCollect()
         {
             unlink(obj);
             assert_true((size_t)p->number() < uniLists.size());
-            uniLists[p->number()].push_back(obj);
+            if ( uniGrids[p->number()] )
+                uniGrids[p->number()]->add(obj, obj->position());
+            else
+                uniLists[p->number()].push_back(obj);
         }
         obj = nxt;
     }
@@ -828,6 +1415,24 @@ void CoupleSet::uniRelax()
         }
         reserve.clear();
     }
+    
+    // Couples are placed randomly within their voxel:
+    for ( Reservoir * r : uniGrids )
+    {
+        if ( !r )
+            continue;
+        for ( Reservoir::index_t i = 0; i < r->nbCells(); ++i )
+        {
+            for ( Object * o : r->pool(i) )
+            {
+                Couple * c = static_cast<Couple*>(o);
+                assert_true(!c->attached1() && !c->attached2());
+                c->setPosition(r->randomPosition(i));
+                link(c);
+            }
+            r->pool(i).clear();
+        }
+    }
 }
 
 
@@ -6,6 +6,8 @@
 #include "object_set.h"
 #include "couple.h"
 #include "couple_prop.h"
+#include "hand_queue.h"
+#include "reservoir.h"
 
 /// Set for Couple
 /**
@@ -80,13 +82,97 @@ private:
     /// couple:fast_diffusion attachment algorithm; assumes free Couples are uniformly distributed
     void          uniAttach(FiberSet const&);
     
+    /// uniGrids[p] contains the diffusing Couples of class p, if ( couple:reservoir_step > 0 )
+    std::vector<Reservoir*> uniGrids;
+    
+    /// attach Hand1 of Couple from the voxels specified in `vox`
+    void          uniAttach1(Array<FiberSite>&, Array<Reservoir::index_t>& vox, Reservoir&);
+    
+    /// attach Hand2 of Couple from the voxels specified in `vox`
+    void          uniAttach2(Array<FiberSite>&, Array<Reservoir::index_t>& vox, Reservoir&);
+    
+    /// couple:reservoir_step attachment algorithm, using the local concentration of free Couples
+    void          uniAttach(FiberSet const&, Reservoir&);
+    
     /// return Couples in uniLists to the normal lists
     void          uniRelax();
     
+    /// detachment times of the Hands of Couples with `detach_scheduled`
+    HandQueue     queue;
+    
+    /// flag to enable simul:detach_queue
+    bool          queued;
+    
+    /// true if all Couple classes have `detach_scheduled`
+    bool          queuedAll;
+    
+    /// initialize simul:detach_queue
+    bool          queuePrepare(PropertyList const& properties);
+    
+    /// schedule the detachment of all attached Hands that qualify
+    void          queueCollect();
+    
+    /// Monte-Carlo step, if some Couples have `detach_scheduled`
+    void          stepQueued();
+    
+    /// the attached Couples of one class, for simul:batch_couples
+    struct CoupleBatch
+    {
+        /// class of the Couples
+        CoupleProp const* prop;
+        /// code designating the classes of the Hands, or -1 to call Couple's functions
+        int               kind;
+        /// Couples in state AA, FA and AF
+        CoupleReserveList aa, fa, af;
+    };
+    
+    /// batches[p] contains the Couples with ( property()->number() == p )
+    std::vector<CoupleBatch> batches;
+    
+    /// copy of a batch made at the start of the time step
+    CoupleBatch   batchCopy;
+    
+    /// flag to enable simul:batch_couples
+    bool          batch;
+    
+    /// true if the batches are up-to-date
+    bool          batchActive;
+    
+    /// initialize simul:batch_couples
+    bool          batchPrepare(PropertyList const& properties);
+    
+    /// return batch list corresponding to given state, or zero for state FF
+    CoupleReserveList * batchList(Couple const*, bool attached1, bool attached2);
+    
+    /// add Couple to the batch list corresponding to given state
+    void          batchLink(Couple *, bool attached1, bool attached2);
+    
+    /// remove Couple from the batch list corresponding to given state
+    void          batchUnlink(Couple *, bool attached1, bool attached2);
+    
+    /// distribute all attached Couples into batches
+    void          batchCollect();
+    
+    /// empty all batches
+    void          batchRelax();
+    
+    /// step all Couples in one batch, calling Hand functions through H1 and H2
+    template < typename H1, typename H2 >
+    void          stepBatch(CoupleBatch const&);
+
+    /// step all Couples in one batch, calling the virtual functions of Couple
+    void          stepBatch(CoupleBatch const&);
+
+    /// Monte-Carlo step, if simul:batch_couples
+    void          stepBatches();
+    
 public:
     
     ///creator
-    CoupleSet(Simul& s) : ObjectSet(s), uni(false) {}
+    CoupleSet(Simul& s) : ObjectSet(s), uni(false), queued(false), queuedAll(false), batch(false), batchActive(false) {}
+    
+    /// destructor
+    ~CoupleSet();
     
     //--------------------------
     
@@ -212,7 +298,7 @@ public:
     void         step();
     
     /// cleanup at end of simulation period
-    void         relax() { uniRelax(); }
+    void         relax();
     
     /// bring all objects to centered image using periodic boundary conditions
     void         foldPositions(Modulo const*) const;
@@ -62,6 +62,9 @@ public:
     /// compute values derived from the parameters
     void complete(Simul const&);
     
+    /// Duo::stepAF(), stepFA() and stepAA() also handle deactivation
+    bool plainSteps() const { return false; }
+    
     /// return a carbon copy of object
     Property* clone() const { return new DuoProp(*this); }
 
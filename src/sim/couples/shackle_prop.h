@@ -45,6 +45,9 @@ public:
     /// compute values derived from the parameters
     void complete(Simul const&);
     
+    /// Shackle::stepAA() also moves Hand1
+    bool plainSteps() const { return false; }
+    
     /// return a carbon copy of object
     Property* clone() const { return new ShackleProp(*this); }
 
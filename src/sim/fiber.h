@@ -238,6 +238,9 @@ public:
     /// number of attached Hands
     unsigned       nbHands() const;
     
+    /// number of attached Hands, used to detect changes in the preconditionner
+    unsigned       nbAttachedHands() const { return nbHands(); }
+    
     /// a function to count Hands using a custom criteria
     int            nbHands(int (*count)(Hand const*)) const;
 
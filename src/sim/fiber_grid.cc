@@ -5,6 +5,7 @@
 #include "exceptions.h"
 #include "fiber_segment.h"
 #include "fiber_site.h"
+#include "fiber_set.h"
 #include "messages.h"
 #include "space.h"
 #include "modulo.h"
@@ -74,9 +75,24 @@ unsigned FiberGrid::setGrid(Space const* space, real max_step)
 }
 
 
-void FiberGrid::createCells()
+void FiberGrid::createCells(unsigned layout)
 {
-    fGrid.createCells();
+    layout_ = layout;
+    paintedWidth_ = -1;
+    cSpans.clear();
+    cSegments.clear();
+    if ( layout_ )
+    {
+        // only the geometry of fGrid is used:
+        fGrid.deleteCells();
+        cOffset.resize(fGrid.nbCells()+1);
+        cOffset.zero(0);
+    }
+    else
+    {
+        fGrid.createCells();
+        cOffset.deallocate();
+    }
 #if ( 0 )
     if ( fGrid.nbCells() > 4096 )
         fGrid.printSummary(std::cerr, "FiberGrid");
@@ -86,6 +102,8 @@ void FiberGrid::createCells()
 
 size_t FiberGrid::hasGrid() const
 {
+    if ( layout_ )
+        return cOffset.size();
     return fGrid.hasCells();
 }
 
@@ -96,6 +114,7 @@ size_t FiberGrid::hasGrid() const
 struct PaintJob
 {
     FiberGrid::grid_type * grid;
+    Array<FiberGrid::Span> * spans;
     FiberSegment segment;
 };
 
@@ -158,6 +177,54 @@ void paintCellPeriodic(const int x_inf, const int x_sup, const int y, const int
 }
 
 
+/**
+ paintSpan(x,y,z) records that a Segment covers the cells (x_inf...x_sup, y, z),
+ for the compact layout. These cells are consecutive in the Grid.
+ It is called by the rasterizer function paintFatLine().
+ */
+void paintSpan(const int x_inf, const int x_sup, const int y, const int z, void * arg)
+{
+    auto* grid = static_cast<PaintJob*>(arg)->grid;
+    const auto& seg = static_cast<PaintJob*>(arg)->segment;
+
+#if   ( DIM == 1 )
+    FiberGrid::index_t inf = grid->pack1D( x_inf );
+    FiberGrid::index_t sup = grid->pack1D( x_sup );
+#elif ( DIM == 2 )
+    FiberGrid::index_t inf = grid->pack2D( x_inf, y );
+    FiberGrid::index_t sup = grid->pack2D( x_sup, y );
+#else
+    FiberGrid::index_t inf = grid->pack3D( x_inf, y, z );
+    FiberGrid::index_t sup = grid->pack3D( x_sup, y, z );
+#endif
+    
+    static_cast<PaintJob*>(arg)->spans->push_back(FiberGrid::Span{inf, sup, seg});
+}
+
+
+/**
+ paintSpanPeriodic(x,y,z) records that a Segment covers the cells (x_inf...x_sup, y, z),
+ for the compact layout, with periodic boundary conditions.
+ */
+void paintSpanPeriodic(const int x_inf, const int x_sup, const int y, const int z, void * arg)
+{
+    auto* grid = static_cast<PaintJob*>(arg)->grid;
+    const auto& seg = static_cast<PaintJob*>(arg)->segment;
+    
+    for ( int x = x_inf; x <= x_sup; ++x )
+    {
+#if   ( DIM == 1 )
+        FiberGrid::index_t i = grid->pack1D( x );
+#elif ( DIM == 2 )
+        FiberGrid::index_t i = grid->pack2D( x, y );
+#else
+        FiberGrid::index_t i = grid->pack3D( x, y, z );
+#endif
+        static_cast<PaintJob*>(arg)->spans->push_back(FiberGrid::Span{i, i, seg});
+    }
+}
+
+
 /**
 paintGrid(first_fiber, last_fiber) links all segments found in 'fiber' and its
  descendant, in the point-list GP that match distance(GP, segment) < H.
@@ -185,49 +252,233 @@ paintGrid(first_fiber, last_fiber) links all segments found in 'fiber' and its
  calls the function paint() above.
  */
 
-void FiberGrid::paintGrid(const Fiber * first, const Fiber * last, real range)
+void FiberGrid::paintFiber(const Fiber * fib, const real width)
 {
-    assert_true(hasGrid());
-    assert_true(range >= 0);
-    
-    fGrid.clear();
     const Vector offset(fGrid.inf());
     const Vector deltas(fGrid.delta());
-    const real width = range + 0.5 * fGrid.diagonalLength();
     
     //define the painting function used:
-    void (*paint)(int, int, int, int, void*) = modulo ? paintCellPeriodic : paintCell;
+    void (*paint)(int, int, int, int, void*);
+    if ( layout_ )
+        paint = modulo ? paintSpanPeriodic : paintSpan;
+    else
+        paint = modulo ? paintCellPeriodic : paintCell;
     
-    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
-    {
-        PaintJob job;
-        job.grid = &fGrid;
-        Vector P, Q = fib->posP(0);
-        const real iPQ = 1.0 / fib->segmentation();
+    PaintJob job;
+    job.grid = &fGrid;
+    job.spans = &cSpans;
+    Vector P, Q = fib->posP(0);
+    const real iPQ = 1.0 / fib->segmentation();
 
-        for ( unsigned n = 1; n < fib->nbPoints(); ++n )
-        {
-            P = Q;
-            Q = fib->posP(n);
-            job.segment.set(fib, n-1);
+    for ( unsigned n = 1; n < fib->nbPoints(); ++n )
+    {
+        P = Q;
+        Q = fib->posP(n);
+        job.segment.set(fib, n-1);
 
 #if   ( DIM == 1 )
-            Rasterizer::paintFatLine1D(paint, &job, P, Q, width, offset, deltas);
+        Rasterizer::paintFatLine1D(paint, &job, P, Q, width, offset, deltas);
 #elif ( DIM == 2 )
-            Rasterizer::paintFatLine2D(paint, &job, P, Q, iPQ, width, offset, deltas);
+        Rasterizer::paintFatLine2D(paint, &job, P, Q, iPQ, width, offset, deltas);
 #else
-            //Rasterizer::paintHexLine3D(paint, &job, P, Q, iPQ, width, offset, deltas);
-            Rasterizer::paintFatLine3D(paint, &job, P, Q, iPQ, width, offset, deltas);
-            //Rasterizer::paintBox3D(paint, &job, P, Q, width, offset, deltas);
+        //Rasterizer::paintHexLine3D(paint, &job, P, Q, iPQ, width, offset, deltas);
+        Rasterizer::paintFatLine3D(paint, &job, P, Q, iPQ, width, offset, deltas);
+        //Rasterizer::paintBox3D(paint, &job, P, Q, width, offset, deltas);
 #endif
+    }
+}
+
+
+void FiberGrid::clearCells()
+{
+    if ( layout_ )
+        cSpans.clear();
+    else
+        fGrid.clear();
+}
+
+
+/**
+ The spans recorded by paintSpan() are converted to the compact layout in two passes:
+ - the number of segments in each cell is counted, by marking the start and end
+   of each span, and the offsets of the cells are obtained by a prefix sum,
+ - the segments are copied to their final position in cSegments.
+ .
+ Within each cell, the segments are ordered as they were painted.
+ */
+void FiberGrid::buildCompact()
+{
+    const index_t nbc = fGrid.nbCells();
+    index_t * off = cOffset.data();
+    
+    // count: after the prefix sum, off[i+1] is the number of segments in cell i
+    for ( index_t i = 0; i <= nbc; ++i )
+        off[i] = 0;
+    for ( Span const& s : cSpans )
+    {
+        ++off[s.inf];
+        --off[s.sup+1];
+    }
+    index_t cnt = 0, sum = 0;
+    for ( index_t i = 0; i < nbc; ++i )
+    {
+        cnt += off[i];
+        off[i] = sum;
+        sum += cnt;
+    }
+    off[nbc] = sum;
+    
+    // scatter: off[i] is used as cursor, and will be shifted to off[i+1]
+    cSegments.resize(sum);
+    FiberSegment * seg = cSegments.data();
+    for ( Span const& s : cSpans )
+    {
+        for ( index_t i = s.inf; i <= s.sup; ++i )
+            seg[off[i]++] = s.seg;
+    }
+    
+    // restore the offsets:
+    for ( index_t i = nbc; i > 0; --i )
+        off[i] = off[i-1];
+    off[0] = 0;
+}
+
+
+void FiberGrid::paintGrid(const Fiber * first, const Fiber * last, real range)
+{
+    assert_true(hasGrid());
+    assert_true(range >= 0);
+    
+    clearCells();
+    paintedWidth_ = -1;
+    const real width = range + 0.5 * fGrid.diagonalLength();
+    
+    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+        paintFiber(fib, width);
+
+    if ( layout_ )
+        buildCompact();
+}
+
+
+/**
+ Returns true if any Fiber painted by the last updateGrid() was deleted,
+ if its number of vertices has changed, or if any vertex has moved by `skin` or more.
+ Fibers created since then are detected by comparing the number of Fibers.
+ */
+bool FiberGrid::needsRepaint(FiberSet const& fibers, const real skin) const
+{
+    if ( fibers.size() != painted_.size() )
+        return true;
+
+    const real skinSqr = skin * skin;
+    for ( Painted const& rec : painted_ )
+    {
+        Fiber const* fib = fibers.findID(rec.id);
+        if ( fib != rec.fib || fib->nbPoints() != rec.cnt )
+            return true;
+        real const* ref = paintedPos_ + rec.off;
+        for ( unsigned n = 0; n < rec.cnt; ++n )
+        {
+            if ( distanceSqr(fib->posP(n), Vector(ref+DIM*n)) >= skinSqr )
+                return true;
         }
     }
+    return false;
+}
+
+
+/**
+ This has the same effect as paintGrid(fibers.first(), nullptr, range), but the
+ painted width is extended by `skin`, which allows the Fibers to move by up to `skin`
+ before the grid must be painted again. Segments painted in this way will be found
+ by tryToAttach() at any position closer than `range` from their current location,
+ since no point of a segment can move more than its two vertices.
+ 
+ The grid is repainted if:
+ - this is the first call after the grid was created, or after paintGrid(),
+ - `range` or `skin` have changed,
+ - a Fiber was created or deleted,
+ - a Fiber has gained or lost vertices (via Chain::growP, cutP or resegment),
+ - a vertex has moved by `skin` or more since the last painting.
+ .
+ The return value is true if the grid was repainted.
+ */
+bool FiberGrid::updateGrid(FiberSet const& fibers, real range, real skin)
+{
+    assert_true(hasGrid());
+    assert_true(range >= 0);
+    assert_true(skin > 0);
+    
+    if ( paintedWidth_ == range + skin && !needsRepaint(fibers, skin) )
+        return false;
+    
+    clearCells();
+    painted_.clear();
+    paintedWidth_ = range + skin;
+    const real width = range + skin + 0.5 * fGrid.diagonalLength();
+    
+    size_t cnt = 0;
+    for ( const Fiber * fib = fibers.first(); fib; fib=fib->next() )
+        cnt += DIM * fib->nbPoints();
+    if ( cnt > paintedAlc_ )
+    {
+        free_real(paintedPos_);
+        paintedAlc_ = chunk_real(cnt);
+        paintedPos_ = new_real(paintedAlc_);
+    }
+    
+    size_t off = 0;
+    for ( const Fiber * fib = fibers.first(); fib; fib=fib->next() )
+    {
+        painted_.push_back(Painted{fib, fib->identity(), fib->nbPoints(), off});
+        copy_real(DIM*fib->nbPoints(), fib->data(), paintedPos_+off);
+        off += DIM * fib->nbPoints();
+        paintFiber(fib, width);
+    }
+
+    if ( layout_ )
+        buildCompact();
+    return true;
 }
 
 
 //------------------------------------------------------------------------------
 #pragma mark - Access
 
+/**
+ Test attachment of `ha` to `seg`, returning true if the Hand was attached.
+ The test is made with probability `binding_prob`.
+ */
+static inline bool attachToSegment(FiberSegment const& seg, Vector const& place, Hand& ha)
+{
+    if ( RNG.test(ha.prop->binding_prob) )
+    {
+        real dis = INFINITY;
+        // Compute the distance from the hand to the rod, and abscissa of projection:
+        real abs = seg.projectPoint(place, dis);      // always works
+        //real abs = seg->projectPointF(place, dis);    // faster, but not compatible with periodic boundaries
+        
+        /*
+         Compare to the maximum attachment range of the hand,
+         and compare a newly tossed random number with 'prob'
+         */
+        if ( dis < ha.prop->binding_range_sqr )
+        {
+            Fiber * fib = const_cast<Fiber*>(seg.fiber());
+            FiberSite pos(fib, seg.abscissa1()+abs);
+            
+            if ( ha.attachmentAllowed(pos) )
+            {
+                ha.attach(pos);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
 /**
  This will bind the given Hand to any Fiber found within `binding_range`, with a
  probability that is encoded in `prob`.
@@ -235,6 +486,9 @@ void FiberGrid::paintGrid(const Fiber * first, const Fiber * last, real range)
  The result is thus stochastic, and will depend on the number of Fiber
  within the range, but it will saturate if there are more than '4' possible targets.
  
+ In both layouts, the segments are visited in a random order, by shuffling
+ the list of segments in place.
+ 
  NOTE:
  The distance at which Fibers are detected is limited to the range given in paintGrid()
  */
@@ -245,6 +499,29 @@ void FiberGrid::tryToAttach(Vector const& place, Hand& ha) const
     //get the cell index closest to the position in space:
     const auto indx = fGrid.index(place, 0.5);
     
+    if ( layout_ )
+    {
+        FiberSegment * seg = cSegments.data() + cOffset[indx];
+        const index_t cnt = cOffset[indx+1] - cOffset[indx];
+        if ( cnt == 0 )
+            return;
+        
+        /*
+         Shuffle the segments of the cell in place, as in the default layout,
+         but with the Fisher-Yates algorithm proceeding from the front, such that
+         each segment can be tested as soon as its position is drawn.
+         */
+        for ( index_t i = 0; i+1 < cnt; ++i )
+        {
+            index_t j = i + RNG.pint32(cnt-i);
+            std::swap(seg[i], seg[j]);
+            if ( attachToSegment(seg[i], place, ha) )
+                return;
+        }
+        attachToSegment(seg[cnt-1], place, ha);
+        return;
+    }
+    
     //get the list of rods associated with this cell:
     SegmentList & segments = fGrid.icell(indx);
 
@@ -262,29 +539,8 @@ void FiberGrid::tryToAttach(Vector const& place, Hand& ha) const
     
     for ( FiberSegment const& seg : segments )
     {
-        if ( RNG.test(ha.prop->binding_prob) )
-        {
-            real dis = INFINITY;
-            // Compute the distance from the hand to the rod, and abscissa of projection:
-            real abs = seg.projectPoint(place, dis);      // always works
-            //real abs = seg->projectPointF(place, dis);    // faster, but not compatible with periodic boundaries
-            
-            /*
-             Compare to the maximum attachment range of the hand,
-             and compare a newly tossed random number with 'prob'
-             */
-            if ( dis < ha.prop->binding_range_sqr )
-            {
-                Fiber * fib = const_cast<Fiber*>(seg.fiber());
-                FiberSite pos(fib, seg.abscissa1()+abs);
-                
-                if ( ha.attachmentAllowed(pos) )
-                {
-                    ha.attach(pos);
-                    return;
-                }
-            }
-        }
+        if ( attachToSegment(seg, place, ha) )
+            return;
     }
 }
 
@@ -296,12 +552,13 @@ FiberGrid::SegmentList FiberGrid::nearbySegments(Vector const& place, const real
 {
     SegmentList res;
     
-    //get the grid node list index closest to the position in space:
-    const auto indx = fGrid.index(place, 0.5);
+    //get the list of rods associated with the cell closest to the position in space:
+    size_t cnt = 0;
+    FiberSegment const* list = segments(place, cnt);
     
-    //get the list of rods associated with this cell:
-    for ( FiberSegment const& seg : fGrid.icell(indx) )
+    for ( size_t i = 0; i < cnt; ++i )
     {
+        FiberSegment const& seg = list[i];
         if ( seg.fiber() != exclude )
         {
             real dis = INFINITY;
@@ -318,15 +575,16 @@ FiberGrid::SegmentList FiberGrid::nearbySegments(Vector const& place, const real
 
 FiberSegment FiberGrid::closestSegment(Vector const& place) const
 {
-    //get the cell index from the position in space:
-    const auto indx = fGrid.index(place, 0.5);
-    
     FiberSegment res(nullptr, 0);
     real hit = INFINITY;
     
-    //get the list of rods associated with this cell:
-    for ( FiberSegment const& seg : fGrid.icell(indx) )
+    //get the list of rods associated with the cell closest to the position in space:
+    size_t cnt = 0;
+    FiberSegment const* list = segments(place, cnt);
+    
+    for ( size_t i = 0; i < cnt; ++i )
     {
+        FiberSegment const& seg = list[i];
         //we compute the distance from the hand to the candidate rod,
         //and compare it to the best we have so far.
         real dis = INFINITY;
@@ -428,9 +686,10 @@ void FiberGrid::testAttach(FILE* out, const Vector pos, FiberSet const& set, Han
         pos.println(out);
 #if ( 0 )
         //report content of grid's list
-        const auto indx = fGrid.index(pos, 0.5);
-        for ( FiberSegment const& seg : fGrid.icell(indx) )
-            fprintf(out, "    target f%04d:%02i\n", seg.fiber()->identity(), seg.point());
+        size_t cnt = 0;
+        FiberSegment const* list = segments(pos, cnt);
+        for ( size_t i = 0; i < cnt; ++i )
+            fprintf(out, "    target f%04d:%02i\n", list[i].fiber()->identity(), list[i].point());
 #endif
         //report for all the segments that were targeted:
         for ( auto const& hit : hits )
@@ -454,6 +713,47 @@ void FiberGrid::testAttach(FILE* out, const Vector pos, FiberSet const& set, Han
     }
 }
 
+
+/**
+ This calls nearbySegments() at `cnt` random positions within `space`, and compares
+ the results with a brute-force search over all the segments of `set`, as done
+ by the reference implementation in `fiber_grid2.cc`.
+ `range` should not exceed the range given to paintGrid().
+ The number of segments that were missed or wrongly reported is returned.
+ */
+size_t FiberGrid::checkSegments(FiberSet const& set, Space const* space, real range, size_t cnt) const
+{
+    size_t err = 0;
+    const real sup = square(range);
+    
+    for ( size_t n = 0; n < cnt; ++n )
+    {
+        Vector pos = space->randomPlace();
+        SegmentList list = nearbySegments(pos, sup);
+        size_t hit = 0;
+        
+        for ( Fiber const* fib=set.first(); fib; fib=fib->next() )
+        {
+            for ( unsigned p = 0; p < fib->nbSegments(); ++p )
+            {
+                FiberSegment seg(fib, p);
+                real dis = INFINITY;
+                seg.projectPoint(pos, dis);
+                if ( dis < sup )
+                {
+                    ++hit;
+                    bool found = false;
+                    for ( FiberSegment const& s : list )
+                        found |= ( s.fiber() == fib && s.point() == p );
+                    err += !found;
+                }
+            }
+        }
+        err += ( list.size() > hit ) ? list.size() - hit : 0;
+    }
+    return err;
+}
+
 //==============================================================================
 #pragma mark - Display
 
@@ -7,11 +7,12 @@
 #include "vector.h"
 #include "array.h"
 #include "grid.h"
+#include "inventoried.h"
+#include "fiber_segment.h"
 //#include <vector>
 
 class Simul;
 class PropertyList;
-class FiberSegment;
 class FiberSet;
 class Modulo;
 class Space;
@@ -39,12 +40,26 @@ A divide-and-conquer algorithm is used to find all segments of fibers close to a
     Finally, using a random number it tests the probability of attachment for the Hand given as argument.
  .
  
- @todo we could call paintGrid() only if the objects have moved by a certain threshold.
- This would work if we also extend the painted area around the rod, by the same threshold.
- we must also redo the paintGrid() when MT points are added or removed.
+ Two layouts are available to store the segments, selected by createCells():
+ - with `layout == 0`, each cell of fGrid has its own SegmentList,
+ - with `layout == 1`, all segments are stored in a single array `cSegments`,
+   with the segments of cell `i` at indices [ cOffset[i], cOffset[i+1] [.
+   This array is built in two passes: the painting functions record spans of
+   consecutive cells in `cSpans`, which are then counted and scattered.
+ .
+ The compact layout avoids allocating memory for each cell, and the segments
+ of a cell are contiguous in memory. In both layouts, tryToAttach() visits the
+ segments of a cell in a random order, but the random permutation is drawn
+ progressively with the compact layout, stopping at the first attachment.
  
- Such algortihm should lead to large CPU gain, if calling clear() or paintGrid() is limiting,
- which is the case in particular in 3D, because the number of grid-cells is large.
+ updateGrid() is an alternative to paintGrid(), in which the segments are painted
+ with a width extended by a `skin`, and the positions of the vertices are recorded.
+ In the following steps, the grid is only repainted if a vertex has moved by `skin`
+ or more, or if a Fiber was created, deleted or has gained or lost vertices.
+ Since the lists then contain all the segments closer than `range+skin`,
+ tryToAttach() remains correct, because it checks the exact distance.
+ This saves calling clear() and paintGrid() at every step, which is costly
+ in particular in 3D, because the number of grid-cells is large.
 */
 
 class FiberGrid 
@@ -61,15 +76,77 @@ public:
     /// type of index
     typedef grid_type::index_t index_t;
     
+    /// a range of consecutive cells, painted with one segment
+    struct Span
+    {
+        index_t      inf;
+        index_t      sup;
+        FiberSegment seg;
+    };
+
 private:
     
     /// grid for divide-and-conquer strategies:
     grid_type fGrid;
     
+    /// 0 = one SegmentList per cell; 1 = compact layout
+    unsigned layout_;
+    
+    /// for compact layout: segments painted in each cell, contiguously, shuffled by tryToAttach()
+    mutable Array<FiberSegment> cSegments;
+    
+    /// for compact layout: index in cSegments of the first segment of each cell
+    Array<index_t> cOffset;
+    
+    /// for compact layout: spans recorded while painting
+    Array<Span> cSpans;
+    
+    /// record of a Fiber painted by updateGrid()
+    struct Painted
+    {
+        Fiber const* fib;
+        ObjectID     id;
+        unsigned     cnt;
+        size_t       off;
+    };
+    
+    /// Fibers painted by updateGrid()
+    Array<Painted> painted_;
+    
+    /// coordinates of the vertices of the Fibers at the time of painting
+    real * paintedPos_;
+    
+    /// allocated size of paintedPos_[]
+    size_t paintedAlc_;
+    
+    /// range + skin used in the last call to updateGrid(), or -1 if invalid
+    real paintedWidth_;
+    
+    /// reset all cells, before painting
+    void         clearCells();
+    
+    /// paint one Fiber with given width
+    void         paintFiber(Fiber const*, real width);
+    
+    /// for compact layout, build cSegments and cOffset from cSpans
+    void         buildCompact();
+
+    /// true if the Fibers have moved or changed since the last call to updateGrid()
+    bool         needsRepaint(FiberSet const&, real skin) const;
+
+    /// disabled copy constructor
+    FiberGrid(FiberGrid const&);
+    
+    /// disabled copy assignment
+    FiberGrid& operator = (FiberGrid const&);
+
 public:
     
     /// constructor
-    FiberGrid()  { }
+    FiberGrid()  { layout_ = 0; paintedWidth_ = -1; paintedPos_ = nullptr; paintedAlc_ = 0; }
+    
+    /// destructor
+    ~FiberGrid() { free_real(paintedPos_); }
    
     /// number of cells in grid
     index_t      nbCells() const { return fGrid.nbCells(); }
@@ -77,8 +154,11 @@ public:
     /// set a grid to cover the specified Space with cells of width `max_step` at most
     unsigned     setGrid(Space const*, real max_step);
     
-    /// allocate memory for the grid, with the dimensions set by setGrid()
-    void         createCells();
+    /// allocate memory for the grid, with the dimensions set by setGrid(), and specified layout
+    void         createCells(unsigned layout = 0);
+    
+    /// layout specified to createCells()
+    unsigned     layout() const { return layout_; }
     
     /// true if the grid was initialized by calling setGrid()
     size_t       hasGrid() const;
@@ -86,6 +166,9 @@ public:
     /// register the Fiber segments on the grid cells
     void         paintGrid(const Fiber * first, const Fiber * last, real);
     
+    /// register the Fiber segments with a margin `skin`, repainting only if needed
+    bool         updateGrid(FiberSet const&, real range, real skin);
+    
     /// given a position, find nearby Fiber segments and test attachement of the provided Hand
     void         tryToAttach(Vector const&, Hand&) const;
     
@@ -93,12 +176,20 @@ public:
     /// return a list of all fiber segments located at a distance D or less from P, except those belonging to `exclude`
     SegmentList  nearbySegments(Vector const&, real disSqr, Fiber * exclude = nullptr) const;
 
-    SegmentList& segments(Vector const& pos) const
+    /// return the segments associated with the cell containing `pos`, and set `cnt` to their number
+    FiberSegment const* segments(Vector const& pos, size_t& cnt) const
     {
         // get the cell index from the position in space:
         const index_t indx = fGrid.index(pos, 0.5);
+        if ( layout_ )
+        {
+            cnt = cOffset[indx+1] - cOffset[indx];
+            return cSegments.data() + cOffset[indx];
+        }
         // get the list of rods associated with this cell:
-        return fGrid.icell(indx);
+        SegmentList & list = fGrid.icell(indx);
+        cnt = list.size();
+        return list.data();
     }
     
     /// Among the segments closer than grid:range, return the closest one
@@ -106,6 +197,9 @@ public:
     
     /// test the results of tryToAttach(), at a particular position
     void         testAttach(FILE *, Vector place, FiberSet const&, HandProp const*) const;
+    
+    /// compare the segments found near `cnt` random positions with a brute-force search
+    size_t       checkSegments(FiberSet const&, Space const*, real range, size_t cnt) const;
 
     /// OpenGL display function
     void         draw() const;
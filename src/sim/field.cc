@@ -5,6 +5,7 @@
 #include "fiber_site.h"
 #include "fiber_set.h"
 #include "cblas.h"
+#include "meca.h"
 #include "sim.h"
 
 
@@ -82,6 +83,45 @@ void Field::prepareDiffusion(real theta, unsigned char * domain)
 }
 
 
+/**
+ Initialize the links used by diffuseImplicit().
+ Bit `d` of fiLinks[c] is set if cell `c` exchanges with the next cell in the
+ direction `d`. With periodic boundary conditions, the last cell of a line
+ is linked to the first one.
+ If `domain` is not null, cells are linked only if they are in the same domain:
+ 
+     ( domain[c] > 0 ) && ( domain[c] == domain[n] )
+ 
+ */
+void Field::prepareLinks(unsigned char const* domain)
+{
+    const FieldGrid::index_t nbc = mGrid.nbCells();
+    
+    delete[] fiLinks;
+    fiLinks = new unsigned char[nbc];
+    
+    for ( FieldGrid::index_t c = 0; c < nbc; ++c )
+    {
+        int coord[3] = { 0, 0, 0 };
+        mGrid.setCoordinatesFromIndex(coord, c);
+        unsigned char L = 0;
+        for ( int d = 0; d < DIM; ++d )
+        {
+            const int n = mGrid.breadth(d);
+            if ( coord[d] + 1 < n )
+            {
+                FieldGrid::index_t x = c + mGrid.stride(d);
+                if ( !domain || ( domain[c] && domain[c] == domain[x] ) )
+                    L |= 1 << d;
+            }
+            else if ( prop->periodic && n > 2 )
+                L |= 1 << d;
+        }
+        fiLinks[c] = L;
+    }
+}
+
+
 /**
  Initialize Field to be ready for step()
  */
@@ -104,7 +144,12 @@ void Field::prepare()
         real theta = prop->diffusion * prop->time_step / ( prop->step * prop->step );
 
         if ( DIM == 1 || prop->periodic )
-            prepareDiffusion(theta);
+        {
+            if ( prop->implicit )
+                prepareLinks(nullptr);
+            else
+                prepareDiffusion(theta);
+        }
         else
         {
             unsigned char * domain = new unsigned char[nbc];
@@ -128,7 +173,10 @@ void Field::prepare()
             }
 #endif
             
-            prepareDiffusion(theta, domain);
+            if ( prop->implicit )
+                prepareLinks(domain);
+            else
+                prepareDiffusion(theta, domain);
             
             delete[] domain;
         }
@@ -186,6 +234,215 @@ void Field::diffuseX(real * field, real c)
 }
 
 
+/// number of lines of the grid that are solved together
+constexpr size_t LINE_GRAIN = 16;
+
+
+/**
+ Solve diffusion along `nbl` lines of `cnt` cells, corresponding to dimension `d`.
+ Line `k` starts at index `base[k]` and has stride `inc`.
+ With implicit Euler, this solves ( I - theta L ) u' = u,
+ and with Crank-Nicolson ( I - theta/2 L ) u' = ( I + theta/2 L ) u,
+ where L is the 1D Laplacian restricted to the links of the cells.
+
+ The matrix is tridiagonal, symmetric and diagonally dominant, and the Thomas
+ algorithm is used without pivoting. The lines are solved in lockstep, such that
+ the elimination chains of different lines are independent and can be pipelined.
+ A periodic line leads to a cyclic system, which is solved with the
+ Sherman-Morrison formula (Numerical Recipes 2.7).
+ `tmp` should have space for 4 * cnt * LINE_GRAIN values.
+ */
+void Field::diffuseLines(real * field, size_t const* base, size_t nbl, size_t inc,
+                         size_t cnt, int d, real theta, real * tmp) const
+{
+    const size_t G = LINE_GRAIN;
+    const unsigned char bit = 1 << d;
+    const real h = ( prop->implicit == 2 ) ? 0.5 * theta : theta;
+    assert_true( nbl <= G );
+
+    // arrays indexed as [ i * G + k ] for cell `i` of line `k`:
+    real * W = tmp;           // link to the next cell
+    real * R = tmp + cnt * G; // inverse of the pivots
+    real * B = R + cnt * G;   // right-hand side and solution
+    real * Z = B + cnt * G;   // auxiliary solution for cyclic system
+
+    bool any = false;
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        for ( size_t k = 0; k < nbl; ++k )
+        {
+            size_t c = base[k] + i * inc;
+            B[i*G+k] = field[c];
+            W[i*G+k] = ( fiLinks[c] & bit ) ? h : 0;
+            any |= ( fiLinks[c] & bit );
+        }
+        for ( size_t k = nbl; k < G; ++k )
+        {
+            B[i*G+k] = 0;
+            W[i*G+k] = 0;
+        }
+    }
+    if ( !any )
+        return;
+    
+    // link between the last and the first cells of a periodic line:
+    real const* wrap = W + ( cnt - 1 ) * G;
+    const bool cyclic = prop->periodic && cnt > 2;
+
+    if ( prop->implicit == 2 )
+    {
+        // B = ( I + theta/2 L ) B
+        real u0[G], prev[G];
+        for ( size_t k = 0; k < G; ++k )
+        {
+            u0[k] = B[k];
+            prev[k] = wrap[k] * ( u0[k] - B[(cnt-1)*G+k] );
+        }
+        for ( size_t i = 0; i+1 < cnt; ++i )
+        {
+            real * b = B + i * G;
+            real const* w = W + i * G;
+            for ( size_t k = 0; k < G; ++k )
+            {
+                real f = w[k] * ( b[k+G] - b[k] );
+                b[k] += f - prev[k];
+                prev[k] = f;
+            }
+        }
+        real * b = B + ( cnt - 1 ) * G;
+        for ( size_t k = 0; k < G; ++k )
+            b[k] += wrap[k] * ( u0[k] - b[k] ) - prev[k];
+    }
+    
+    // factorize ( I - h L ), with diagonal 1 + W[i-1] + W[i] and off-diagonals -W[i]
+    real gamma[G];
+    for ( size_t k = 0; k < G; ++k )
+    {
+        real d0 = 1 + wrap[k] + W[k];
+        if ( cyclic )
+        {
+            // Sherman-Morrison modification of the corners:
+            gamma[k] = -d0;
+            d0 -= gamma[k];
+        }
+        R[k] = 1 / d0;
+    }
+    for ( size_t i = 1; i < cnt; ++i )
+    {
+        real const* w = W + i * G;
+        real * r = R + ( i - 1 ) * G;
+        for ( size_t k = 0; k < G; ++k )
+        {
+            real p = w[k-G];
+            real x = 1 + p + w[k] - p * p * r[k];
+            if ( cyclic && i == cnt-1 )
+                x -= wrap[k] * wrap[k] / gamma[k];
+            r[k+G] = 1 / x;
+        }
+    }
+    
+    // forward and backward substitutions:
+    auto solve = [W, R, cnt](real * X)
+    {
+        for ( size_t i = 1; i < cnt; ++i )
+        {
+            real * x = X + i * G;
+            real const* w = W + ( i - 1 ) * G;
+            real const* r = R + ( i - 1 ) * G;
+            for ( size_t k = 0; k < G; ++k )
+                x[k] += w[k] * r[k] * x[k-G];
+        }
+        for ( size_t k = 0; k < G; ++k )
+            X[(cnt-1)*G+k] *= R[(cnt-1)*G+k];
+        for ( size_t i = cnt-1; i-- > 0; )
+        {
+            real * x = X + i * G;
+            real const* w = W + i * G;
+            real const* r = R + i * G;
+            for ( size_t k = 0; k < G; ++k )
+                x[k] = ( x[k] + w[k] * x[k+G] ) * r[k];
+        }
+    };
+    
+    solve(B);
+    
+    if ( cyclic )
+    {
+        zero_real(cnt*G, Z);
+        for ( size_t k = 0; k < G; ++k )
+        {
+            Z[k] = gamma[k];
+            Z[(cnt-1)*G+k] = -wrap[k];
+        }
+        solve(Z);
+        real fac[G];
+        for ( size_t k = 0; k < G; ++k )
+        {
+            real const& x = B[(cnt-1)*G+k];
+            real const& z = Z[(cnt-1)*G+k];
+            fac[k] = ( B[k] - wrap[k] * x / gamma[k] ) / ( 1 + Z[k] - wrap[k] * z / gamma[k] );
+        }
+        for ( size_t i = 0; i < cnt; ++i )
+        {
+            for ( size_t k = 0; k < G; ++k )
+                B[i*G+k] -= fac[k] * Z[i*G+k];
+        }
+    }
+
+    for ( size_t i = 0; i < cnt; ++i )
+    {
+        for ( size_t k = 0; k < nbl; ++k )
+            field[base[k]+i*inc] = B[i*G+k];
+    }
+}
+
+
+/**
+ Alternating Direction Implicit method: diffusion is solved sequentially
+ in each dimension, along all the lines of the grid in this dimension.
+ The lines are independent, and are distributed over the threads of `meca`.
+ */
+void Field::diffuseImplicit(real * field, real theta, Meca const& meca)
+{
+    assert_true( fiLinks );
+    const size_t nbc = mGrid.nbCells();
+    
+    size_t sup = 0;
+    for ( int d = 0; d < DIM; ++d )
+        sup = std::max(sup, (size_t)mGrid.breadth(d));
+    
+    const size_t chunk = 4 * sup * LINE_GRAIN;
+    const size_t need = chunk * meca.nbThreads();
+    if ( fiLineSize < need )
+    {
+        free_real(fiLine);
+        fiLine = new_real(need);
+        fiLineSize = need;
+    }
+
+    for ( int d = 0; d < DIM; ++d )
+    {
+        const size_t cnt = mGrid.breadth(d);
+        const size_t inc = mGrid.stride(d);
+        const size_t nbl = nbc / cnt;
+        
+        auto job = [this, field, theta, cnt, inc, nbl, chunk, d](size_t j, unsigned rank)
+        {
+            size_t base[LINE_GRAIN];
+            const size_t sup = std::min(nbl, ( j + 1 ) * LINE_GRAIN);
+            size_t n = 0;
+            for ( size_t l = j * LINE_GRAIN; l < sup; ++l )
+            {
+                // index of the first cell of line `l`:
+                base[n++] = ( l / inc ) * inc * cnt + ( l % inc );
+            }
+            diffuseLines(field, base, n, inc, cnt, d, theta, fiLine + chunk * rank);
+        };
+        meca.forAll(( nbl + LINE_GRAIN - 1 ) / LINE_GRAIN, job);
+    }
+}
+
+
 void Field::laplacian(const real* field, real * mat) const
 {
     const FieldGrid::index_t nbc = mGrid.nbCells();
@@ -357,9 +614,9 @@ void Field::setEdgesZ(real * field, real val)
 
 
 /**
- //\todo implement Crank-Nicholson for diffusion
+ The threads of `meca` are used for implicit diffusion
  */
-void Field::step(FiberSet& fibers)
+void Field::step(FiberSet& fibers, Meca const& meca)
 {
     assert_true( prop );
     
@@ -393,15 +650,23 @@ void Field::step(FiberSet& fibers)
     // diffusion:
     if ( prop->diffusion > 0 )
     {
-        assert_true( fiTMP );
-        assert_true( fiTMPSize == nbc );
-        assert_true( fiDiffusionMatrix.size() == nbc );
-
-        // dup = field:
-        blas::xcopy(nbc, field, 1, dup, 1);
-        
-        // field = field + fiDiffusionMatrix * dup:
-        fiDiffusionMatrix.vecMulAdd(dup, field);
+        if ( prop->implicit )
+        {
+            real theta = prop->diffusion * prop->time_step / ( prop->step * prop->step );
+            diffuseImplicit(field, theta, meca);
+        }
+        else
+        {
+            assert_true( fiTMP );
+            assert_true( fiTMPSize == nbc );
+            assert_true( fiDiffusionMatrix.size() == nbc );
+            
+            // dup = field:
+            blas::xcopy(nbc, field, 1, dup, 1);
+            
+            // field = field + fiDiffusionMatrix * dup:
+            fiDiffusionMatrix.vecMulAdd(dup, field);
+        }
     }
 
     if ( prop->boundary_condition & 1 )
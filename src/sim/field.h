@@ -17,6 +17,7 @@
 #include "field_values.h"
 
 class FiberSet;
+class Meca;
 
 #ifdef DISPLAY
 #  include "gle.h"
@@ -70,6 +71,15 @@ private:
     /// matrix for diffusion
     MatrixSparseSymmetric1 fiDiffusionMatrix;
     
+    /// for implicit diffusion: bit `d` is set if cell is linked to the next one in direction `d`
+    unsigned char * fiLinks;
+    
+    /// work space for implicit diffusion, for all threads
+    real*    fiLine;
+    
+    /// allocated size of fiLine
+    size_t   fiLineSize;
+    
     /// initialize to cover the given Space with squares of size 'step'
     void setGrid(Vector inf, Vector sup, real step, bool tight)
     {
@@ -124,12 +134,17 @@ public:
         prop      = p;
         fiTMP     = nullptr;
         fiTMPSize = 0;
+        fiLinks   = nullptr;
+        fiLine    = nullptr;
+        fiLineSize = 0;
     }
     
     /// destructor
     ~Field()
     {
         free_real(fiTMP);
+        free_real(fiLine);
+        delete[] fiLinks;
     }
     
     /// initialize with squares of size 'step'
@@ -210,8 +225,8 @@ public:
     /// initialize Field
     void prepare();
 
-    /// simulation step
-    void step(FiberSet&);
+    /// simulation step, using the threads of Meca
+    void step(FiberSet&, Meca const&);
     
     /// calculate second derivative of field
     void laplacian(const real*, real*) const;
@@ -234,6 +249,15 @@ public:
     /// initialize diffusion matrix (only for FieldScalar)
     void prepareDiffusion(real, unsigned char *);
     
+    /// initialize links between cells, for implicit diffusion
+    void prepareLinks(unsigned char const*);
+    
+    /// implicit diffusion along several lines of the grid
+    void diffuseLines(real*, size_t const* base, size_t nbl, size_t inc, size_t cnt, int d, real theta, real* tmp) const;
+
+    /// implicit diffusion, using alternating directions
+    void diffuseImplicit(real*, real theta, Meca const&);
+    
     //------------------------------- object -----------------------------------
 #pragma mark -
     
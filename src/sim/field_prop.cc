@@ -16,6 +16,7 @@ void FieldProp::clear()
     periodic              = 0;
     diffusion             = 0;
     full_diffusion        = 0;
+    implicit              = 0;
     boundary_condition    = 0;
     boundary_value        = 0;
     decay_rate            = 0;
@@ -44,6 +45,7 @@ void FieldProp::read(Glossary& glos)
     glos.set(confine_space,      "space");
     glos.set(diffusion,          "diffusion");
     glos.set(full_diffusion,     "full_diffusion");
+    glos.set(implicit,           "implicit", {{"off", 0}, {"euler", 1}, {"crank_nicolson", 2}});
     glos.set(boundary_condition, "boundary_condition", keys);
     glos.set(boundary_value,     "boundary_value");
     glos.set(boundary_condition, "boundary", keys);
@@ -85,7 +87,9 @@ void FieldProp::complete(Simul const& sim)
     if ( diffusion < 0 )
         throw InvalidParameter("field:diffusion must be >= 0");
     
-    real theta = 2 * DIM * time_step * (diffusion+full_diffusion) / ( step * step );
+    // implicit diffusion is unconditionally stable:
+    real diff = ( implicit ? 0 : diffusion ) + full_diffusion;
+    real theta = 2 * DIM * time_step * diff / ( step * step );
     //std::clog << "The CFL condition for `" << name() << "' is " << theta << std::endl;
     
     if ( sim.ready()  &&  theta > 0.5 )
@@ -113,6 +117,7 @@ void FieldProp::write_values(std::ostream& os) const
     write_value(os, "periodic",       periodic);
     write_value(os, "diffusion",      diffusion);
     write_value(os, "full_diffusion", full_diffusion);
+    write_value(os, "implicit",       implicit);
     write_value(os, "boundary",       boundary_condition, boundary_value);
     write_value(os, "decay_rate",     decay_rate);
     write_value(os, "transport",      transport_strength, transport_length);
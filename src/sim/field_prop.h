@@ -40,6 +40,24 @@ public:
     /// diffusion constant
     real          full_diffusion;
     
+    /// method used to integrate `diffusion` in time
+    /**
+     can be:
+     - 0 : explicit (default), which requires `diffusion * time_step / step^2 < 1/4DIM`
+     - 1 : implicit (backward Euler)
+     - 2 : Crank-Nicolson
+     .
+     Methods 1 and 2 are unconditionally stable, and solve the diffusion one
+     dimension at a time, along the lines of the grid (Alternating Direction Implicit).
+     Each line is a tridiagonal system, and the lines are distributed over the
+     threads specified by `simul:threads`.
+     Method 1 is first order in time but never creates negative values.
+     Method 2 is second order in time, but may oscillate if
+     `diffusion * time_step / step^2` is much larger than 1.
+     `full_diffusion` is always explicit.
+     */
+    int           implicit;
+    
     /// type of boundary condition
     /*
      can be:
@@ -45,7 +45,7 @@ void FieldSet::step()
         if ( f->hasField() )
         {
             LOG_ONCE("!!!! Field is active\n");
-            f->step(simul.fibers);
+            f->step(simul.fibers, simul.sMeca);
         }
     }
 }
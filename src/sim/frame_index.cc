@@ -0,0 +1,108 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "filewrapper.h"
+#include "frame_index.h"
+#include "messages.h"
+
+
+std::string FrameIndex::filename(std::string const& traj)
+{
+    size_t s = traj.size();
+    if ( s > 4 && 0 == traj.compare(s-4, 4, ".cmo") )
+        return traj.substr(0, s-4) + ".idx";
+    return traj + ".idx";
+}
+
+
+void FrameIndex::print(FILE* f, Entry const& e)
+{
+    fprintf(f, "%12lu %20lli %20.9g %12lli\n", e.frame, e.offset, e.time, e.size);
+}
+
+
+bool FrameIndex::scan(FILE* f, Entry& e)
+{
+    unsigned long frm = 0;
+    if ( 4 != fscanf(f, "%lu %lli %lf %lli", &frm, &e.offset, &e.time, &e.size) )
+        return false;
+    e.frame = frm;
+    return true;
+}
+
+
+/**
+ The entry is added only if the index matches the trajectory file, i.e. if
+ the previous frame ended at `start`. A new index is started if `start == 0`.
+ An index that does not match is removed.
+ */
+void FrameIndex::record(std::string const& traj, long long start, long long end, double time)
+{
+    std::string name = filename(traj);
+    Entry e = { 0, start, time, end - start };
+    FILE * f = nullptr;
+
+    if ( start > 0 )
+    {
+        f = fopen(name.c_str(), "r+");
+        if ( !f )
+            return;
+        Entry x;
+        if ( fseeko(f, -LINE, SEEK_END) || !scan(f, x) || x.offset + x.size != start )
+        {
+            fclose(f);
+            remove(name.c_str());
+            Cytosim::warn << "frame index `" << name << "' did not match trajectory and was removed\n";
+            return;
+        }
+        e.frame = x.frame + 1;
+        fseeko(f, 0, SEEK_END);
+    }
+    else
+    {
+        f = fopen(name.c_str(), "w");
+        if ( !f )
+            return;
+    }
+    print(f, e);
+    fclose(f);
+}
+
+
+int FrameIndex::read(std::string const& traj)
+{
+    entries_.clear();
+    FILE * f = fopen(filename(traj).c_str(), "r");
+    if ( !f )
+        return 1;
+
+    Entry e;
+    while ( scan(f, e) )
+    {
+        if ( e.frame != entries_.size() || e.size <= 0 )
+            break;
+        if ( entries_.size() && entries_.back().offset + entries_.back().size != e.offset )
+            break;
+        entries_.push_back(e);
+    }
+    bool bad = !feof(f);
+    fclose(f);
+
+    // the frames must be within the trajectory file:
+    FILE * t = fopen(traj.c_str(), "r");
+    if ( t )
+    {
+        fseeko(t, 0, SEEK_END);
+        long long len = ftello(t);
+        fclose(t);
+        if ( entries_.size() && entries_.back().offset + entries_.back().size > len )
+            bad = true;
+    }
+
+    if ( bad )
+    {
+        entries_.clear();
+        return 2;
+    }
+    return 0;
+}
+
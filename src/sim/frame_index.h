@@ -0,0 +1,82 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef FRAME_INDEX_H
+#define FRAME_INDEX_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+/// List of the frames contained in a trajectory file
+/**
+ The index is stored in a text file alongside the trajectory, with the same
+ name but extension `.idx` (e.g. `objects.idx` for `objects.cmo`).
+ It is appended by Simul::writeObjects() each time a frame is written,
+ and can be rebuilt for an existing trajectory with `frametool reindex`.
+
+ Each line describes one frame, with fixed width, such that the last entry
+ can be found directly from the size of the file:
+
+     FRAME OFFSET TIME SIZE
+
+ OFFSET is the position in bytes where the frame starts in the trajectory,
+ and SIZE is the number of bytes until the start of the next frame.
+
+ The entries are accepted by read() only if they are consecutive and contiguous
+ and do not extend beyond the end of the trajectory file. FrameReader also checks
+ that a frame starts at the indicated position before using it.
+ */
+class FrameIndex
+{
+public:
+
+    /// description of one frame
+    struct Entry
+    {
+        size_t    frame;
+        long long offset;
+        double    time;
+        long long size;
+    };
+
+    /// number of characters in each line of the file
+    static constexpr int LINE = 68;
+
+private:
+
+    /// list of frames
+    std::vector<Entry> entries_;
+
+public:
+
+    /// constructor
+    FrameIndex() {}
+
+    /// name of the index associated with trajectory file `traj`
+    static std::string filename(std::string const& traj);
+
+    /// write one entry in file
+    static void print(FILE*, Entry const&);
+
+    /// read one entry from file, returning true if successful
+    static bool scan(FILE*, Entry&);
+
+    /// add entry for a frame written at [start, end) in trajectory `traj`
+    static void record(std::string const& traj, long long start, long long end, double time);
+
+    /// load the index of trajectory `traj`, returning 0 if successful
+    int    read(std::string const& traj);
+
+    /// forget all entries
+    void   clear() { entries_.clear(); }
+
+    /// number of frames
+    size_t size() const { return entries_.size(); }
+
+    /// description of frame `i`
+    Entry const& operator[](size_t i) const { return entries_[i]; }
+};
+
+#endif
+
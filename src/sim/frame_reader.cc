@@ -4,6 +4,8 @@
 #include "exceptions.h"
 #include "iowrapper.h"
 #include "simul.h"
+#include <cstring>
+#include <cctype>
 
 
 // Use the second definition to get some verbose reports:
@@ -19,6 +21,25 @@ FrameReader::FrameReader() : inputter(DIM)
 }
 
 
+/**
+ Calls Simul::reloadObjects(), returning true at the end of the file.
+ If an exception is thrown, the Simul does not correspond to any frame anymore,
+ and this is recorded before the exception is passed on.
+ */
+bool FrameReader::reloadObjects(Simul& sim)
+{
+    try
+    {
+        return sim.reloadObjects(inputter);
+    }
+    catch( Exception & )
+    {
+        lastLoaded = ~0;
+        throw;
+    }
+}
+
+
 void FrameReader::clear()
 {
     inputter.rewind();
@@ -54,6 +75,7 @@ void FrameReader::openFile(std::string const& file)
  
     inputter.vectorSize(DIM);
     clearPositions();
+    frameTable.read(file);
     //std::clog << "FrameReader: has openned " << obj_file << std::endl;
 }
 
@@ -170,6 +192,77 @@ size_t FrameReader::seekPos(size_t frm)
 }
 
 
+/**
+ This moves to the position of frame `frm` given by the index, after checking
+ that a frame starts there. The index is discarded if this is not the case.
+ */
+bool FrameReader::seekTable(size_t frm)
+{
+    if ( frm >= frameTable.size() )
+        return false;
+    
+    FILE * f = inputter.file();
+    const long long off = frameTable[frm].offset;
+    inputter.clear();
+    
+    char tag[10] = { 0 };
+    if ( 0 == fseeko(f, off, SEEK_SET) )
+    {
+        int c = getc_unlocked(f);
+        while ( isspace(c) )
+            c = getc_unlocked(f);
+        tag[0] = (char)c;
+        if ( 8 != fread(tag+1, 1, 8, f) )
+            tag[0] = 0;
+    }
+    
+    if ( strncmp(tag, "#Cytosim ", 9) || fseeko(f, off, SEEK_SET) )
+    {
+        std::cerr << "Warning: frame index does not match trajectory and will be ignored\n";
+        frameTable.clear();
+        inputter.rewind();
+        return false;
+    }
+    
+    VLOG("FrameReader: using index for frame " << frm << '\n');
+    fpos_t pos;
+    if ( 0 == inputter.get_pos(pos) )
+        savePos(frm, pos, 3);
+    return true;
+}
+
+
+/**
+ This reads the header of the frame starting at the current position,
+ returning the distance indicated on the line `#compressed`, or 0 if the frame
+ is not compressed. The position in the file is not changed.
+ */
+size_t FrameReader::keyDistance()
+{
+    fpos_t pos;
+    if ( inputter.get_pos(pos) )
+        return 0;
+    
+    size_t res = 0;
+    std::string line;
+    do {
+        line = inputter.get_line();
+    } while ( line.empty() && !inputter.eof() );
+    
+    if ( 0 == line.compare(0, 9, "#Cytosim ") )
+    {
+        do
+            line = inputter.get_line();
+        while ( 0 == line.compare(0, 6, "#time ") );
+        if ( 0 == line.compare(0, 12, "#compressed ") )
+            res = strtoul(line.c_str()+12, nullptr, 10);
+    }
+    inputter.clear();
+    inputter.set_pos(pos);
+    return res;
+}
+
+
 size_t FrameReader::lastKnownFrame() const
 {
     if ( framePos.empty() )
@@ -195,6 +288,9 @@ int FrameReader::seekFrame(size_t frm)
 {
     VLOG("FrameReader: seekFrame("<< frm <<")\n");
     
+    if ( seekTable(frm) )
+        return SUCCESS;
+
     size_t inx = seekPos(frm);
     
     if ( inx == frm )
@@ -262,6 +358,31 @@ int FrameReader::loadFrame(Simul& sim, size_t frm, const bool reload)
     if ( SUCCESS != seekFrame(frm) )
         return NOT_FOUND;
     
+    // a compressed frame may require the frames preceding it:
+    size_t dis = keyDistance();
+    if ( 0 < dis && dis <= frm )
+    {
+        const size_t key = frm - dis;
+        int res = SUCCESS;
+        if ( key <= lastLoaded && lastLoaded < frm )
+        {
+            // continue from the last frame loaded:
+            frameIndex = lastLoaded;
+            res = seekFrame(lastLoaded+1);
+        }
+        else
+        {
+            // the position must be set, as loadFrame() may call loadNextFrame():
+            res = seekFrame(key);
+            if ( res == SUCCESS )
+                res = loadFrame(sim, key, true);
+        }
+        VLOG("FrameReader: loading frames " << frameIndex << " to " << frm << '\n');
+        while ( res == SUCCESS && frameIndex < frm )
+            res = loadNextFrame(sim);
+        return res;
+    }
+    
     // store the position in the file:
     fpos_t pos;
     bool has_pos = !inputter.get_pos(pos);
@@ -270,7 +391,7 @@ int FrameReader::loadFrame(Simul& sim, size_t frm, const bool reload)
     //VLOG("FrameReader: reading frame " << frm << '\n');
     
     // ask cytosim to read the file:
-    if ( !sim.reloadObjects(inputter) )
+    if ( !reloadObjects(sim) )
     {
         VLOG("FrameReader: loadFrame("<< frm <<") successful\n");
         frameIndex = frm;
@@ -301,7 +422,7 @@ int FrameReader::loadNextFrame(Simul& sim)
     fpos_t pos;
     bool has_pos = !inputter.get_pos(pos);
 
-    if ( !sim.reloadObjects(inputter) )
+    if ( !reloadObjects(sim) )
     {
         if ( lastLoaded == frameIndex )
             ++frameIndex;
@@ -336,14 +457,25 @@ int FrameReader::loadLastFrame(Simul& sim, size_t cnt)
     
     /// seek last known position:
     size_t frm = lastKnownFrame();
-    if ( frm > 1 )
+    if ( frameTable.size() > frm+1 && seekTable(frameTable.size()-1) )
+        frm = frameTable.size()-1;
+    else if ( frm > 1 )
         inputter.set_pos(framePos[frm].position);
     else
         inputter.rewind();
     
-    /// go from here to last frame:
     int res = NOT_FOUND;
-    while ( !sim.reloadObjects(inputter) )
+    // a compressed frame may require the frames preceding it:
+    if ( keyDistance() > 0 )
+    {
+        if ( SUCCESS != loadFrame(sim, frm, true) )
+            return NOT_FOUND;
+        ++frm;
+        res = SUCCESS;
+    }
+
+    /// go from here to last frame:
+    while ( !reloadObjects(sim) )
     {
         frameIndex = frm++;
         lastLoaded = frameIndex;
@@ -354,15 +486,8 @@ int FrameReader::loadLastFrame(Simul& sim, size_t cnt)
     {
         frm = frm - 1 - cnt;
         // go back up by 'cnt' frames:
-        if ( SUCCESS != seekFrame(frm) )
-            return NOT_FOUND;
-        
-        if ( !sim.reloadObjects(inputter) )
+        if ( SUCCESS != loadFrame(sim, frm, true) )
             return NOT_FOUND;
-
-        frameIndex = frm;
-        lastLoaded = frameIndex;
-        VLOG("FrameReader: loadFrame("<< frm <<") successful\n");
     }
     
     return res;
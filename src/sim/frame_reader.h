@@ -1,6 +1,7 @@
 // Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
 
 #include "iowrapper.h"
+#include "frame_index.h"
 #include <vector>
 
 class Simul;
@@ -14,12 +15,19 @@ class Simul;
  future access to these and other frames in the same file. For example, if the 
  position of frame 50 is known and frame 60 is requested, it will start searching
  the file from the end of frame 50.
+ If the trajectory has an index (see FrameIndex), the frames listed in the index
+ are accessed directly, without scanning the file.
 
  FrameReader makes minimal assumptions on what constitutes a 'frame':
  - seekFrame() looks for a string that identifies the beggining of a frame (Cytosim).
  - loadFrame() calls Simul::reloadObjects() to read the content of the frame.
  .
  
+ In a compressed trajectory (see `simul:compress`), a frame may be encoded relative
+ to the preceding frames. To load such a frame, FrameReader loads the last keyframe
+ preceding it and all the frames in between, unless the preceding frame was the last
+ one loaded.
+ 
  Frames are recorded starting at index 0.
 */
 class FrameReader
@@ -44,6 +52,9 @@ private:
     /// starting position for each frame
     PosList  framePos;
     
+    /// index of the trajectory file, if available
+    FrameIndex frameTable;
+    
     /// index of frame stored currently
     size_t   frameIndex;
     
@@ -56,6 +67,15 @@ private:
     /// go to a position where a frame close to `frm` is known to start
     size_t   seekPos(size_t frm);
     
+    /// go to the start of frame `frm` using `frameTable`, returning true if successful
+    bool     seekTable(size_t frm);
+    
+    /// number of frames since the last keyframe, for a compressed frame starting at the current position
+    size_t   keyDistance();
+    
+    /// read objects into the Simul, returning true at end of file
+    bool     reloadObjects(Simul&);
+    
     /// check file validity
     void     checkFile();
     
@@ -0,0 +1,153 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "frame_writer.h"
+#include "frame_index.h"
+#include "exceptions.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+
+FrameWriter::FrameWriter()
+{
+    max_ = 1;
+    pending_ = 0;
+    halt_ = false;
+    alive_ = false;
+    failed_ = false;
+    pthread_mutex_init(&mutex_, nullptr);
+    pthread_cond_init(&cond_, nullptr);
+}
+
+
+FrameWriter::~FrameWriter()
+{
+    stop();
+    pthread_cond_destroy(&cond_);
+    pthread_mutex_destroy(&mutex_);
+}
+
+
+void* FrameWriter::launcher(void* arg)
+{
+    static_cast<FrameWriter*>(arg)->loop();
+    return nullptr;
+}
+
+
+void FrameWriter::start(size_t max)
+{
+    if ( alive_ )
+        return;
+    max_ = ( max > 0 ? max : 1 );
+    halt_ = false;
+    if ( pthread_create(&thread_, nullptr, launcher, this) )
+        throw InvalidIO("failed to create the thread writing frames");
+    alive_ = true;
+}
+
+
+void FrameWriter::stop()
+{
+    if ( alive_ )
+    {
+        pthread_mutex_lock(&mutex_);
+        halt_ = true;
+        pthread_cond_broadcast(&cond_);
+        pthread_mutex_unlock(&mutex_);
+        pthread_join(thread_, nullptr);
+        alive_ = false;
+    }
+}
+
+
+/**
+ This blocks while the queue is full
+ */
+void FrameWriter::push(std::string const& file, bool append, char* data, size_t size, double time)
+{
+    pthread_mutex_lock(&mutex_);
+    while ( queue_.size() >= max_ )
+        pthread_cond_wait(&cond_, &mutex_);
+    queue_.push_back(Frame{file, append, data, size, time});
+    ++pending_;
+    pthread_cond_broadcast(&cond_);
+    pthread_mutex_unlock(&mutex_);
+}
+
+
+void FrameWriter::flush()
+{
+    pthread_mutex_lock(&mutex_);
+    while ( pending_ > 0 )
+        pthread_cond_wait(&cond_, &mutex_);
+    pthread_mutex_unlock(&mutex_);
+}
+
+
+bool FrameWriter::failed()
+{
+    pthread_mutex_lock(&mutex_);
+    bool res = failed_;
+    failed_ = false;
+    pthread_mutex_unlock(&mutex_);
+    return res;
+}
+
+
+/**
+ The queue is emptied before the thread terminates
+ */
+void FrameWriter::loop()
+{
+    pthread_mutex_lock(&mutex_);
+    while ( 1 )
+    {
+        while ( queue_.empty() && !halt_ )
+            pthread_cond_wait(&cond_, &mutex_);
+        if ( queue_.empty() )
+            break;
+        Frame frm = queue_.front();
+        queue_.pop_front();
+        // the queue has space:
+        pthread_cond_broadcast(&cond_);
+        pthread_mutex_unlock(&mutex_);
+
+        bool ok = write(frm);
+        free(frm.data);
+
+        pthread_mutex_lock(&mutex_);
+        if ( !ok )
+            failed_ = true;
+        --pending_;
+        pthread_cond_broadcast(&cond_);
+    }
+    pthread_mutex_unlock(&mutex_);
+}
+
+
+bool FrameWriter::write(Frame const& frm)
+{
+    FILE * f = fopen(frm.file.c_str(), frm.append ? "ab" : "wb");
+    if ( !f )
+    {
+        std::cerr << "Error writing trajectory file: could not open `" << frm.file << "'\n";
+        return false;
+    }
+    // lock the file as done by Simul::writeObjects(Outputter&):
+    flockfile(f);
+    fseeko(f, 0, SEEK_END);
+    long long start = ftello(f);
+    size_t n = fwrite(frm.data, 1, frm.size, f);
+    long long end = ftello(f);
+    funlockfile(f);
+    if ( fclose(f) || n != frm.size )
+    {
+        std::cerr << "Error writing trajectory file `" << frm.file << "'\n";
+        return false;
+    }
+    if ( 0 <= start && start < end )
+        FrameIndex::record(frm.file, start, end, frm.time);
+    return true;
+}
+
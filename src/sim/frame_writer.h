@@ -0,0 +1,108 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <pthread.h>
+#include <cstddef>
+#include <string>
+#include <deque>
+
+
+/// A background thread that writes serialized frames to trajectory files
+/**
+ This is used by Simul::writeObjects() if `simul:write_queue > 0`.
+ The frames are serialized into memory by the calling thread, and the
+ buffers are passed to push(). The frames are written in the order in which
+ they were pushed, each with a call to fwrite(), followed by an update of
+ the index (see FrameIndex).
+
+ At most `max` frames can be waiting to be written: push() blocks if the
+ queue is full, such that memory use remains bounded if the simulation
+ produces frames faster than they can be written.
+
+ Errors are printed, and can be detected by calling failed(). This is needed
+ for compressed frames, which refer to the preceding frame in the file.
+ */
+class FrameWriter
+{
+private:
+
+    /// a frame waiting to be written
+    struct Frame
+    {
+        std::string file;
+        bool        append;
+        char *      data;
+        size_t      size;
+        double      time;
+    };
+
+    /// frames waiting to be written
+    std::deque<Frame> queue_;
+
+    /// maximum number of frames in the queue
+    size_t      max_;
+
+    /// number of frames pushed and not yet written, including the one in progress
+    size_t      pending_;
+
+    /// flag to request termination of the thread
+    bool        halt_;
+
+    /// flag indicating that the thread was created
+    bool        alive_;
+
+    /// flag indicating that a frame could not be written
+    bool        failed_;
+
+    /// the thread
+    pthread_t   thread_;
+
+    /// mutex protecting all the above
+    pthread_mutex_t mutex_;
+
+    /// condition signaled when the state of the queue has changed
+    pthread_cond_t  cond_;
+
+    /// write one frame to file, returning true if successful
+    static bool write(Frame const&);
+
+    /// main loop executed by the thread
+    void        loop();
+
+    /// entry point of the thread
+    static void* launcher(void*);
+
+    /// Disabled copy constructor
+    FrameWriter(FrameWriter const&);
+
+    /// Disabled copy assignment
+    FrameWriter& operator=(FrameWriter const&);
+
+public:
+
+    /// constructor
+    FrameWriter();
+
+    /// write all remaining frames and terminate the thread
+    ~FrameWriter();
+
+    /// create thread, allowing `max` frames to be queued
+    void        start(size_t max);
+
+    /// write all remaining frames and terminate the thread
+    void        stop();
+
+    /// queue `size` bytes from `data` for file `file`; the buffer is released with free()
+    void        push(std::string const& file, bool append, char* data, size_t size, double time);
+
+    /// wait until all frames have been written
+    void        flush();
+
+    /// true if a frame could not be written since the last call
+    bool        failed();
+};
+
+#endif
+
@@ -13,7 +13,7 @@
 //------------------------------------------------------------------------------
 
 Hand::Hand(HandProp const* p, HandMonitor* m)
- : haNext(nullptr), haPrev(nullptr), haMonitor(m), prop(p)
+ : haNext(nullptr), haPrev(nullptr), haEvent(0), haMonitor(m), prop(p)
 {
     // initialize in unattached state:
     nextDetach = 0;
@@ -24,6 +24,7 @@ Hand::~Hand()
 {
     // the Hands should be detached in ~Couple and ~Single
     assert_true(!fbFiber);
+    assert_true(!haEvent);
     prop = nullptr;
 }
 
@@ -207,8 +208,9 @@ void Hand::locate(Fiber* f, real a)
     fbFiber = f;
     f->addHand(this);
     reinterpolate();
-    haMonitor->afterAttachment(this);
+    // set before the Monitor is called, as CoupleSet may schedule detachment:
     nextDetach = RNG.exponential();
+    haMonitor->afterAttachment(this);
 }
 
 
@@ -7,6 +7,7 @@
 #include "hand_prop.h"
 
 class HandMonitor;
+class HandQueue;
 class FiberGrid;
 class FiberProp;
 class Simul;
@@ -39,6 +40,7 @@ class Simul;
  */
 class Hand : public FiberSite
 {
+    friend class HandQueue;
 
 private:
     
@@ -50,6 +52,9 @@ private:
     
     /// Pointer used to build the list of Hands bound to a Fiber
     Hand *         haPrev;
+    
+    /// position in HandQueue, or zero if the Hand is not queued
+    size_t         haEvent;
 
 protected:
 
@@ -281,6 +281,16 @@ void HandProp::complete(Simul const& sim)
 }
 
 
+/**
+ This is true for a plain Hand (activity = bind) if `unbinding_force = inf`.
+ The time of detachment can then be calculated at the time of attachment.
+ */
+bool HandProp::constantUnbinding() const
+{
+    return ( activity == "bind" ) && ( unbinding_rate == 0 || unbinding_force == INFINITY );
+}
+
+
 /**
  Compare the energy in a link when it binds at its maximum distance,
  with the Thermal energy
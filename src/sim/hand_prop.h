@@ -234,6 +234,9 @@ public:
     /// perform additional tests for the validity of parameters, given the elasticity
     virtual void checkStiffness(real stiff, real len, real mul, real kT) const;
     
+    /// true if detachment occurs with a constant rate, independently of force and motion
+    bool constantUnbinding() const;
+    
     /// Attachment rate per unit length of fiber
     real bindingSectionRate() const;
     
@@ -0,0 +1,113 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "hand_queue.h"
+#include "hand.h"
+#include "assert_macro.h"
+#include <algorithm>
+
+
+void HandQueue::set(size_t i, Event const& e)
+{
+    heap[i] = e;
+    e.hand->haEvent = i;
+}
+
+
+void HandQueue::siftUp(size_t i, Event const& e)
+{
+    while ( i > 1 && e.time < heap[i/2].time )
+    {
+        set(i, heap[i/2]);
+        i /= 2;
+    }
+    set(i, e);
+}
+
+
+void HandQueue::siftDown(size_t i, Event const& e)
+{
+    const size_t end = heap.size();
+    size_t c = 2 * i;
+    while ( c < end )
+    {
+        // select the earliest child:
+        if ( c+1 < end && heap[c+1].time < heap[c].time )
+            ++c;
+        if ( !( heap[c].time < e.time ) )
+            break;
+        set(i, heap[c]);
+        i = c;
+        c = 2 * i;
+    }
+    set(i, e);
+}
+
+
+/**
+ A Hand that cannot detach ( unbinding_rate == 0 ) is not queued
+ */
+void HandQueue::schedule(Hand * h, real now)
+{
+    assert_true( active_ );
+    assert_true( h->attached() );
+    assert_true( h->haEvent == 0 );
+
+    const real rate = h->prop->unbinding_rate;
+    if ( rate > 0 )
+    {
+        Event e = { now + h->nextDetach / rate, h };
+        heap.push_back(e);
+        siftUp(heap.size()-1, e);
+    }
+}
+
+
+void HandQueue::remove(Hand * h)
+{
+    size_t i = h->haEvent;
+    if ( i )
+    {
+        assert_true( heap[i].hand == h );
+        h->haEvent = 0;
+        Event e = heap.back();
+        heap.pop_back();
+        if ( i < heap.size() )
+        {
+            if ( i > 1 && e.time < heap[i/2].time )
+                siftUp(i, e);
+            else
+                siftDown(i, e);
+        }
+    }
+}
+
+
+/**
+ The Hands are detached in the order of their detachment times
+ @return number of Hands that were detached
+ */
+size_t HandQueue::fire(real now)
+{
+    size_t cnt = 0;
+    while ( heap.size() > 1 && heap[1].time <= now )
+    {
+        Hand * h = heap[1].hand;
+        remove(h);
+        h->detach();
+        ++cnt;
+    }
+    return cnt;
+}
+
+
+void HandQueue::release(real now)
+{
+    for ( size_t i = 1; i < heap.size(); ++i )
+    {
+        Hand * h = heap[i].hand;
+        h->nextDetach = std::max(real(0), ( heap[i].time - now ) * h->prop->unbinding_rate);
+        h->haEvent = 0;
+    }
+    heap.resize(1);
+    active_ = false;
+}
@@ -0,0 +1,79 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef HAND_QUEUE_H
+#define HAND_QUEUE_H
+
+#include "real.h"
+#include <vector>
+
+class Hand;
+
+
+/// A priority queue holding the future detachment times of Hands
+/**
+ For a Hand that detaches with a constant rate, the Gillespie normalized time
+ drawn at attachment (Hand::nextDetach) determines the time of detachment:
+
+     time = time_of_attachment + nextDetach / unbinding_rate
+
+ HandQueue keeps these times in a binary heap, such that the Hands can be
+ detached when their time has come, without visiting them at every time step.
+ Each Hand records its position in the heap (Hand::haEvent), such that it can be
+ removed in O(log N) if it detaches for another reason.
+
+ The queue is 'active' between schedule() and release(): release() converts
+ the times back into Hand::nextDetach, and empties the queue.
+ */
+class HandQueue
+{
+    /// an entry of the queue
+    struct Event
+    {
+        real    time;
+        Hand  * hand;
+    };
+
+    /// binary heap, ordered by increasing time (the first element is unused)
+    std::vector<Event> heap;
+
+    /// true if Hands are currently scheduled
+    bool  active_;
+
+    /// store `e` at position `i` and update the Hand
+    void  set(size_t i, Event const& e);
+
+    /// move element up until order is restored
+    void  siftUp(size_t i, Event const& e);
+
+    /// move element down until order is restored
+    void  siftDown(size_t i, Event const& e);
+
+public:
+
+    /// constructor
+    HandQueue() : active_(false) { heap.resize(1); }
+
+    /// number of Hands in the queue
+    size_t size()   const { return heap.size() - 1; }
+
+    /// true if schedule() may be called
+    bool   active() const { return active_; }
+
+    /// allow Hands to be scheduled
+    void   activate() { active_ = true; }
+
+    /// add Hand, which will detach after normalized time Hand::nextDetach
+    void   schedule(Hand *, real now);
+
+    /// remove Hand from the queue, if it is queued
+    void   remove(Hand *);
+
+    /// detach all Hands for which time <= now
+    size_t fire(real now);
+
+    /// set Hand::nextDetach for all queued Hands, and empty the queue
+    void   release(real now);
+};
+
+#endif
+
@@ -927,6 +927,8 @@ void Interface::execute_import(std::string const& file, std::string const& what,
             throw InvalidIO("expected class specifier (eg. `import all FILE' or `import fiber FILE')");
     }
 
+    // the file may be written in the background:
+    simul.flushObjects();
     Inputter in(DIM, file.c_str(), true);
 
     if ( ! in.good() )
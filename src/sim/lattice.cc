@@ -59,6 +59,5 @@ void Lattice<real>::write_data(Outputter& out, lati_t inf, lati_t sup) const
     out.writeUInt8(0);
     out.writeUInt8(12);
     
-    for ( lati_t s = inf; s < sup; ++s )
-        out.writeFloat(laSite[s]);
+    out.writeFloats(laSite+inf, sup-inf);
 }
@@ -9,7 +9,6 @@
  * ------------------------------------------------------------------------------
  * @todo See if Lagrangian dynamics could work better than constrainted dynamics
  * @todo Implement the PARDISO sparse matrix format
- * @todo Check if IDR(s) would perform better than BCGS or GMRES
  * ------------------------------------------------------------------------------
  */
 
@@ -26,6 +25,8 @@
 #include "filepath.h"
 #include "tictoc.h"
 #include "bicgstab.h"
+#include "idrs.h"
+#include "lu_mixed.h"
 #include "gmres.h"
 
 #include "meca_inter.cc"
@@ -37,6 +38,22 @@
 #define ADD_PROJECTION_DIFF 1
 
 
+/**
+ Use Mecable::multiplyFused() in Meca::multiply(), which calculates the
+ rigidity and projection terms of each Mecable in fewer passes over memory.
+ */
+#define FUSED_MULTIPLY 1
+
+
+/**
+ Parameters of the SELL-C-sigma format used with simul:matrix_format=1:
+ rows are sorted within windows of SELL_SIGMA rows, and the multiplication is
+ distributed to the threads by sets of SELL_GRAIN groups of rows.
+ */
+#define SELL_SIGMA 32
+#define SELL_GRAIN 64U
+
+
 /**
  The forces are usually:
  
@@ -57,19 +74,6 @@
 #define DEBUG_MECA 0
 
 
-/// number of threads running in parallel
-#define NUM_THREADS 1
-
-
-#if NUM_THREADS > 1
-/*
- Parallelization uses Intel's OpenMP.
- This requires a specific flag for the compiler, so adjust the makefile.inc
- CXXFLG := -std=gnu++14 -fopenmp
- */
-#include <omp.h>
-#endif
-
 
 //------------------------------------------------------------------------------
 #pragma mark - Allocate
@@ -89,8 +93,17 @@ Meca::Meca()
     vTMP = nullptr;
     vMEM = nullptr;
     useMatrixC = false;
+    useMatrixS = false;
+    mixedPrecision = false;
+    useFloatMatrices = false;
     drawLinks = false;
     time_step = 0;
+    shards = nullptr;
+    nbShards = 0;
+    history_ = nullptr;
+    nbSolves_ = 0;
+    prepareTime_ = 0;
+    prepareStamp_ = 0;
 }
 
 
@@ -120,9 +133,6 @@ void Meca::allocate(size_t alc)
         allocate_vector(alc, vRHS, 1);
         allocate_vector(alc, vFOR, 1);
         allocate_vector(alc, vTMP, 0);
-#if NUM_THREADS > 1
-        allocate_vector(alc, vMEM, 0);
-#endif
     }
 }
 
@@ -158,136 +168,149 @@ unsigned Meca::largestMecable() const
 }
 
 //------------------------------------------------------------------------------
-#pragma mark - Multiply
-
-
-// shortcut
-
-#if ( DIM == 1 )
-#   define VECMULADDISO vecMulAdd
-#elif ( DIM == 2 )
-#   define VECMULADDISO vecMulAddIso2D
-#elif ( DIM == 3 )
-#   define VECMULADDISO vecMulAddIso3D
-#endif
+#pragma mark - Threads
 
 
 /**
- calculate the forces into `F`, given the Mecable coordinates `X`:
- 
-     F <- B + mB * X + mC * X
+ Set the number of threads, and distribute the Mecables in contiguous ranges,
+ such that the total number of points is approximately the same in each range.
+ The ranges are only the starting point of the work, since threads that complete
+ their own range will steal Mecables from the others.
+ */
+void Meca::setThreads(unsigned nbt)
+{
+    if ( nbt < 1 )
+        nbt = ThreadPool::nbProcessors();
+    
+    pool.start(nbt);
+    nbt = pool.size();
+    
+    split.resize(nbt+1);
+    split[0] = 0;
+    
+    size_t sum = 0, cnt = 0;
+    unsigned t = 1;
+    for ( Mecable const* mec : objs )
+    {
+        sum += mec->nbPoints();
+        ++cnt;
+        // close ranges whose share of points has been reached:
+        while ( t < nbt && sum * nbt >= t * (size_t)nbPts )
+            split[t++] = cnt;
+    }
+    while ( t <= nbt )
+        split[t++] = cnt;
+}
 
- If B == 0, this term is ommited. With B = vBAS and X = vPTS, the procedure
- calculates the forces in the system in `F`:
- 
-     F <- vBAS + mB * vPTS + mC * vPTS
 
+/**
+ Call `func(mec, rank)` for every Mecable, where `rank` identifies the thread.
+ The calls are distributed over the threads of the pool, and the function
+ should only access data that is specific to the Mecable.
  */
-#if NUM_THREADS > 1
-void Meca::calculateForces(const real* X, real const* B, real* F) const
+template < typename FUNC >
+void Meca::forAllMecables(FUNC const& func) const
 {
-    assert_true( empty() || ( X != F && X != B && F != B ));
+    if ( pool.size() > 1 )
+    {
+        Mecable *const* mecs = objs.begin();
+        auto job = [mecs, &func](size_t i, unsigned rank) { func(mecs[i], rank); };
+        pool.run(objs.size(), split.begin(), job);
+    }
+    else
+    {
+        for ( Mecable * mec : objs )
+            func(mec, 0);
+    }
+}
 
-    /*
-    We partition the matrix into equal parts, assuming it is of constant density,
-    symmetric and stored in its lower triangle, such that columns of low index
-    have more elements: n_elements(inx) ~ ( size - inx )
-    Hence to split in two we use these ratios:
-        s = 1.0 - sqrt(1/2);
-    and to split in 3 equal parts:
-        s1 = 1.0 - sqrt(2/3);
-        s2 = 1.0 - sqrt(1/3);
-    or to split in 4 equal parts:
-        s1 = 1.0 - sqrt(3/4);
-        s2 = 1.0 - sqrt(2/4);
-        s3 = 1.0 - sqrt(1/4);
-     */
-    index_t dim = dimension();
 
-    if ( useMatrixC )
+/**
+ Each thread of rank > 0 gets a secondary system, in which it can record
+ interactions, concurrently with the other threads (see Simul::setAllInteractions).
+ The secondary systems only hold mB, mC and vBAS, and share vPTS with this Meca.
+ */
+void Meca::prepareShards()
+{
+    unsigned nbs = pool.size() - 1;
+    if ( nbs != nbShards )
     {
-        index_t spl1 = index_t( dim * 0.184 );
-        index_t spl2 = index_t( dim * 0.423 );
-#if ( 0 )
-        std::clog << " matrixC split [ 0 " << spl1 << " " << spl2 << " " << dim <<" ] :  ";
-        std::clog << mC.nbElements(0, spl1) << " " << mC.nbElements(spl1, spl2) << " " << mC.nbElements(spl2, siz) << "\n";
-#endif
-        #pragma omp parallel sections num_threads(4)
-        {
-            #pragma omp section
-            {
-                // F <- B + mB * X
-                if ( B )
-                    copy_real(dim, B, F);      //blas::xcopy(dimension(), B, 1, F, 1);
-                else
-                    zero_real(dim, F);
-                
-                mB.VECMULADDISO(X, F);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vRND);
-                mC.vecMulAdd(X, vRND, 0, spl1);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vTMP);
-                mC.vecMulAdd(X, vTMP, spl1, spl2);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vMEM);
-                mC.vecMulAdd(X, vMEM, spl2, dim);
-            }
-        }
+        releaseShards();
+        if ( nbs > 0 )
+            shards = new Meca[nbs];
+        nbShards = nbs;
     }
-    else
+    
+    auto job = [this](size_t i, unsigned)
     {
-        index_t nbp = nbPts;
-        index_t spl1 = index_t( nbp * 0.134 );
-        index_t spl2 = index_t( nbp * 0.293 );
-        index_t spl3 = index_t( nbp * 0.5 );
-#if ( 0 )
-        std::clog << " matrixB split [ 0 " << spl1 << " " << spl2 << " " << spl3 << " " << nbp <<" ] :  ";
-        std::clog << mB.nbElements(0, spl1) << " " << mB.nbElements(spl1, spl2) << " ";
-        std::clog << mB.nbElements(spl2, spl3) << " " << mB.nbElements(spl3, siz) << "\n";
-#endif
-        #pragma omp parallel sections num_threads(4)
+        Meca & sh = shards[i];
+        if ( sh.allocated_ < allocated_ )
         {
-            #pragma omp section
-            {
-                // F <- B + mB * X
-                if ( B )
-                    copy_real(dim, B, F);
-                else
-                    zero_real(dim, F);
-                mB.VECMULADDISO(X, F, 0, spl1);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vRND);
-                mB.VECMULADDISO(X, vRND, spl1, spl2);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vTMP);
-                mB.VECMULADDISO(X, vTMP, spl2, spl3);
-            }
-            #pragma omp section
-            {
-                zero_real(dim, vMEM);
-                mB.VECMULADDISO(X, vMEM, spl3, nbp);
-            }
+            sh.allocated_ = allocated_;
+            allocate_vector(DIM*allocated_+4, sh.vBAS, 0);
         }
-    }
+        sh.nbPts = nbPts;
+        sh.vPTS = vPTS;
+        sh.mB.resize(nbPts);
+        sh.mB.reset();
+        sh.mC.resize(DIM*nbPts);
+        sh.mC.reset();
+        zero_real(DIM*nbPts, sh.vBAS);
+    };
+    pool.run(nbShards, nullptr, job);
+}
 
-    // finally sum up all contributions into F
-    #pragma vector aligned
-    for ( index_t i = 0; i < dim; ++i )
-        F[i] = ( F[i] + vRND[i] ) + ( vTMP[i] + vMEM[i] );
+
+void Meca::releaseShards()
+{
+    for ( unsigned i = 0; i < nbShards; ++i )
+        shards[i].vPTS = nullptr;  // not owned
+    delete[] shards;
+    shards = nullptr;
+    nbShards = 0;
 }
 
-#else
+
+/**
+ Add the contributions of all secondary systems to mB, mC and vBAS.
+ The columns of the matrices are distributed in chunks over the threads,
+ such that the merge is done in parallel without any conflict.
+ */
+void Meca::mergeShards()
+{
+    if ( nbShards == 0 )
+        return;
+    
+    const index_t chunk = 256;
+    auto job = [this, chunk](size_t i, unsigned)
+    {
+        index_t s = chunk * i;
+        index_t e = std::min(s + chunk, nbPts);
+        for ( unsigned k = 0; k < nbShards; ++k )
+        {
+            Meca const& sh = shards[k];
+            mB.addColumns(sh.mB, s, e);
+            mC.addColumns(sh.mC, DIM*s, DIM*e);
+            blas::xaxpy(DIM*(e-s), 1.0, sh.vBAS+DIM*s, 1, vBAS+DIM*s, 1);
+        }
+    };
+    pool.run(( nbPts + chunk - 1 ) / chunk, nullptr, job);
+}
+
+//------------------------------------------------------------------------------
+#pragma mark - Multiply
+
+
+// shortcut
+
+#if ( DIM == 1 )
+#   define VECMULADDISO vecMulAdd
+#elif ( DIM == 2 )
+#   define VECMULADDISO vecMulAddIso2D
+#elif ( DIM == 3 )
+#   define VECMULADDISO vecMulAddIso3D
+#endif
+
 
 /**
  calculate the forces into `F`, given the Mecable coordinates `X`:
@@ -311,43 +334,79 @@ void Meca::calculateForces(const real* X, real const* B, real* F) const
         zero_real(dimension(), F);
     
     // F <- F + mB * X
+    if ( useMatrixS )
+        multiplyMatrixS(X, F);
+    else
+    {
 #if ( DIM == 1 )
-    mB.vecMulAdd(X, F);
+        mB.vecMulAdd(X, F);
 #elif ( DIM == 2 )
-    mB.vecMulAddIso2D(X, F);
+        mB.vecMulAddIso2D(X, F);
 #elif ( DIM == 3 )
-    mB.vecMulAddIso3D(X, F);
+        mB.vecMulAddIso3D(X, F);
 #endif
+    }
 
     if ( useMatrixC )
     {
         // F <- F + mC * X
-        mC.vecMulAdd(X, F);
+        if ( useFloatMatrices )
+            mC.vecMulAddSingle(X, F);
+        else
+            mC.vecMulAdd(X, F);
     }
 }
-#endif
 
 
-void Meca::addAllRigidity(const real* X, real* Y) const
+/**
+ Calculate Y <- Y + mB * X using the SELL-C-sigma copy of mB,
+ with the values in single precision if `useFloatMatrices` is set.
+ Since the rows are independent, groups of rows are distributed to the threads
+ */
+void Meca::multiplyMatrixS(const real* X, real* Y) const
 {
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
+    const index_t cnt = mBS.nbChunks();
+    const bool single = useFloatMatrices;
+    MatrixSparseSELL const& mat = mBS;
+    auto job = [&mat, X, Y, cnt, single](size_t i, unsigned)
     {
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
-        {
-            const index_t inx = DIM * (*mci)->matIndex();
-            (*mci)->addRigidity(X+inx, Y+inx);
-            mci += NUM_THREADS;
-        }
+        index_t s = SELL_GRAIN * i;
+        index_t e = std::min(s + SELL_GRAIN, cnt);
+#if ( DIM == 1 )
+        if ( single )
+            mat.vecMulAddSingle(X, Y, s, e);
+        else
+            mat.vecMulAdd(X, Y, s, e);
+#elif ( DIM == 2 )
+        if ( single )
+            mat.vecMulAddIso2DSingle(X, Y, s, e);
+        else
+            mat.vecMulAddIso2D(X, Y, s, e);
+#elif ( DIM == 3 )
+        if ( single )
+            mat.vecMulAddIso3DSingle(X, Y, s, e);
+        else
+            mat.vecMulAddIso3D(X, Y, s, e);
+#endif
+    };
+    
+    if ( pool.size() > 1 && cnt > SELL_GRAIN )
+        pool.run(( cnt + SELL_GRAIN - 1 ) / SELL_GRAIN, nullptr, job);
+    else
+    {
+        for ( index_t i = 0; SELL_GRAIN * i < cnt; ++i )
+            job(i, 0);
     }
-#else
-    for ( Mecable * mec : objs )
+}
+
+
+void Meca::addAllRigidity(const real* X, real* Y) const
+{
+    forAllMecables([X, Y](Mecable const* mec, unsigned)
     {
         const index_t inx = DIM * mec->matIndex();
         mec->addRigidity(X+inx, Y+inx);
-    }
-#endif
+    });
 }
 
 
@@ -359,6 +418,11 @@ void Meca::addAllRigidity(const real* X, real* Y) const
  */
 inline void multiply1(Mecable const* mec, real alpha, const real* xxx, real* yyy)
 {
+#if FUSED_MULTIPLY
+    if ( mec->multiplyFused(alpha, xxx, yyy) )
+        return;
+#endif
+
 #if ( DIM > 1 )
     mec->addRigidity(xxx, yyy);
 #endif
@@ -386,24 +450,12 @@ void Meca::multiply(const real* X, real* Y) const
     // Y <- ( mB + mC ) * X
     calculateForces(X, nullptr, Y);
     
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
-    {
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
-        {
-            const index_t inx = DIM * (*mci)->matIndex();
-            multiply1(*mci, -time_step, X+inx, Y+inx);
-            mci += NUM_THREADS;
-        }
-    }
-#else
-    for ( Mecable * mec : objs )
+    const real alpha = -time_step;
+    forAllMecables([X, Y, alpha](Mecable const* mec, unsigned)
     {
         const index_t inx = DIM * mec->matIndex();
-        multiply1(mec, -time_step, X+inx, Y+inx);
-    }
-#endif
+        multiply1(mec, alpha, X+inx, Y+inx);
+    });
 }
 
 //------------------------------------------------------------------------------
@@ -454,14 +506,13 @@ static void expand_matrix(unsigned siz, real * mat)
 
 
 /**
- Get the total diagonal block corresponding to an Object, which is:
+ Get the diagonal block of the stiffness matrix corresponding to an Object:
  
-     I - time_step * P ( mB + mC + P' )
+     Rigidity + mB + mC
  
- The result is constructed by using functions from mB and mC
- This block is square but not symmetric!
+ This block is square and symmetric
  */
-void Meca::getBlock(real* res, const Mecable * mec) const
+void Meca::getStiffnessBlock(real* res, const Mecable * mec) const
 {
     const unsigned ps = mec->nbPoints();
     const unsigned bs = DIM * ps;
@@ -481,6 +532,43 @@ void Meca::getBlock(real* res, const Mecable * mec) const
     
     if ( useMatrixC )
         mC.addDiagonalBlock(res, bs, DIM*mec->matIndex(), bs);
+}
+
+
+/**
+ Get the diagonal block of the stiffness matrix corresponding to an Object,
+ in LAPACK symmetric lower band storage, with `kd` subdiagonals.
+ Terms further away from the diagonal are ignored, and the cost is thus
+ linear in the number of points of the Object.
+ */
+void Meca::getStiffnessBand(real* res, unsigned kd, const Mecable * mec) const
+{
+    const unsigned ps = mec->nbPoints();
+    
+#if ( DIM > 1 )
+    mec->addRigidityBand(res);
+#endif
+    
+    mB.addDiagonalBand(res, kd, mec->matIndex(), ps, DIM);
+    
+    if ( useMatrixC )
+        mC.addDiagonalBand(res, kd, DIM*mec->matIndex(), DIM*ps);
+}
+
+
+/**
+ Get the total diagonal block corresponding to an Object, which is:
+ 
+     I - time_step * P ( mB + mC + P' )
+ 
+ The result is constructed by using functions from mB and mC
+ This block is square but not symmetric!
+ */
+void Meca::getBlock(real* res, const Mecable * mec) const
+{
+    const unsigned bs = DIM * mec->nbPoints();
+    
+    getStiffnessBlock(res, mec);
     
 #if ( 0 )
     std::clog<<"mB+mC block:\n";
@@ -649,6 +737,7 @@ void Meca::computePreconditionner(Mecable* mec)
 {
     unsigned bs = DIM * mec->nbPoints();
 
+    mec->useBlock(0);
     mec->allocateBlock();
     real* blk = mec->block();
  
@@ -663,72 +752,111 @@ void Meca::computePreconditionner(Mecable* mec)
     
     if ( info == 0 )
     {
-        mec->useBlock(1);
+        if ( mixedPrecision )
+        {
+            mec->convertBlock();
+            mec->useBlock(3);
+        }
+        else
+            mec->useBlock(1);
+        mec->stampBlock();
         //testBlock(mec, blk);
         //std::clog << "Meca::computePreconditionner(" << mec->reference() << ")\n";
     }
     else
     {
-        assert_true(mec->useBlock() == 0);
         std::clog << "Meca::computePreconditionner failed (lapack::xgetf2, info " << info << ")\n";
     }
 }
 
 
+/**
+ Compute the preconditionner block corresponding to 'mec' in band storage.
+ The band of the stiffness block is set in memory provided by the Mecable,
+ which then builds and factorizes a band matrix, such that the cost of
+ building the block, of its factorization and of its application are all
+ linear in the number of points.
+ A dense block is used if the Mecable does not support this (method=3).
+ */
+void Meca::computeBandedPreconditionner(Mecable* mec)
+{
+    if ( mec->bandWidth() == 0 )
+    {
+        computePreconditionner(mec);
+        return;
+    }
+    
+    mec->useBlock(0);
+    
+    // extract the band of the diagonal block of the stiffness matrix:
+    getStiffnessBand(mec->stiffnessBand(), mec->bandDiagonals(), mec);
+    
+    int info = mec->factorBandBlock(-time_step * mec->leftoverMobility());
+    
+    if ( info == 0 )
+        mec->useBlock(2);
+    else
+    {
+        std::clog << "Meca::computeBandedPreconditionner failed (lapack::xgbtrf, info " << info << ")\n";
+        computePreconditionner(mec);
+    }
+}
+
+
 /// Compute all the blocks of the preconditionner
 /**
  This is method 1, that should perform well and can be multithreaded
  */
 void Meca::computePreconditionner()
 {
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
+    forAllMecables([this](Mecable* mec, unsigned) { computePreconditionner(mec); });
+}
+
+
+/// Compute all the blocks of the preconditionner, using band storage where possible (method=3)
+void Meca::computeBandedPreconditionner()
+{
+    forAllMecables([this](Mecable* mec, unsigned) { computeBandedPreconditionner(mec); });
+}
+
+
+/**
+ This is method 2, which recalculates only the blocks that are out-of-date,
+ as determined by Mecable::staleBlock(), and returns the number of blocks updated.
+ Since the blocks are kept from one time step to the next, prepare() does not
+ reset them in this mode.
+ */
+size_t Meca::updatePreconditionner(real threshold)
+{
+    std::atomic<size_t> cnt(0);
+    forAllMecables([this, threshold, &cnt](Mecable* mec, unsigned)
     {
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
+        if ( mec->staleBlock(threshold) )
         {
-            computePreconditionner(*mci);
-            mci += NUM_THREADS;
+            computePreconditionner(mec);
+            cnt.fetch_add(1, std::memory_order_relaxed);
         }
-        //printf("thread %i complete %i\n", omp_get_thread_num(), TicToc::microseconds());
-    }
-#else
-    for ( Mecable * mec : objs )
-        computePreconditionner(mec);
-#endif
+    });
+    return cnt;
 }
 
 
 void Meca::precondition(const real* X, real* Y) const
-{    
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
-    {
-        int info;
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
-        {
-            Mecable const* mec = *mci;
-            const int bs = DIM * mec->nbPoints();
-            real const* xxx = X + DIM * mec->matIndex();
-            real * yyy = Y + DIM * mec->matIndex();
-            blas::xcopy(bs, xxx, 1, yyy, 1);
-            if ( mec->useBlock() )
-                lapack::xgetrs('N', bs, 1, mec->block(), bs, mec->pivot(), yyy, bs, &info);
-            mci += NUM_THREADS;
-        }
-    }
-#else
-    blas::xcopy(dimension(), X, 1, Y, 1);
-    for ( Mecable const* mec : objs )
+{
+    forAllMecables([X, Y](Mecable const* mec, unsigned)
     {
         const int bs  = DIM * mec->nbPoints();
         const int inx = DIM * mec->matIndex();
+        if ( X != Y )
+            blas::xcopy(bs, X+inx, 1, Y+inx, 1);
         int info = 0;
-        if ( mec->useBlock() )
+        if ( mec->useBlock() == 1 )
             lapack::xgetrs('N', bs, 1, mec->block(), bs, mec->pivot(), Y+inx, bs, &info);
-    }
-#endif
+        else if ( mec->useBlock() == 2 )
+            mec->solveBandBlock(Y+inx);
+        else if ( mec->useBlock() == 3 )
+            LUMixed::solve(bs, mec->blockF(), mec->pivot(), Y+inx);
+    });
 }
 
 
@@ -748,12 +876,25 @@ int smaller_mecable(const void * ap, const void * bp)
 }
 
 
+/// function to sort Mecables by identity
+int lower_identity(const void * ap, const void * bp)
+{
+    Mecable const** a = (Mecable const**)(ap);
+    Mecable const** b = (Mecable const**)(bp);
+    
+    if ( (*a)->identity() < (*b)->identity() ) return -1;
+    if ( (*a)->identity() > (*b)->identity() ) return  1;
+    return 0;
+}
+
+
 /**
  Allocate and reset matrices and vectors necessary for Meca::solve(),
  copy coordinates of Mecables into vPTS[]
  */
 void Meca::prepare(Simul const* sim)
 {
+    const double tic = TicToc::milliseconds();
     ready_ = 0;
     objs.clear();
     
@@ -767,32 +908,80 @@ void Meca::prepare(Simul const* sim)
         addMecable(b);
 
 
-#if NUM_THREADS > 1
-    /*
-     Sorting Mecables can improve multithreaded performance by distributing
-     the work more equally between threads. Note that his operation is not free
-     and for large systems random partitionning may not be so bad. Moreover for
-     homogeneous systems (if all filaments have the same length) this is useless.
-    */
-    objs.sort(smaller_mecable);
+    if ( sim->prop->warm_start )
+    {
+        /*
+         The order must be stable to reuse the previous solution,
+         since the lists of objects are shuffled at every time step
+         */
+        objs.sort(lower_identity);
+    }
+    else if ( sim->prop->threads != 1 )
+    {
+        /*
+         Sorting Mecables can improve multithreaded performance by distributing
+         the work more equally between threads. Note that his operation is not free
+         and for large systems random partitionning may not be so bad. Moreover for
+         homogeneous systems (if all filaments have the same length) this is useless.
+        */
+        objs.sort(smaller_mecable);
+    }
     
-    /*
+    index_t cnt = 0;
     for ( Mecable const* mec : objs )
-        std::clog << mec->reference() << " " << mec->nbPoints() << "\n";
+        cnt += mec->nbPoints();
+
+    /*
+     The previous solution is carried over to the new positions of the Mecables,
+     unless the vectors need to be reallocated, in which case vSOL is zero.
+     Mecables that are new, or that have gained or lost points, start from zero.
      */
-#endif
-    
+    const bool warm = sim->prop->warm_start && cnt <= allocated_;
+
     /*
      Attributes the position in the vector/matrix to each Mecable
      */
-    index_t cnt = 0;
+    index_t inx = 0;
     for ( Mecable * mec : objs )
     {
-        mec->matIndex(cnt);
-        cnt += mec->nbPoints();
+        const index_t nbp = mec->nbPoints();
+        if ( warm )
+        {
+            const index_t old = mec->matIndex();
+            if ( old < warmCount.size() && warmMecable[old] == mec && warmCount[old] == nbp )
+                copy_real(DIM*nbp, vSOL+DIM*old, vTMP+DIM*inx);
+            else
+                zero_real(DIM*nbp, vTMP+DIM*inx);
+        }
+        mec->matIndex(inx);
+        inx += nbp;
+    }
+    if ( warm )
+        std::swap(vSOL, vTMP);
+    
+    if ( sim->prop->warm_start )
+    {
+        // record the layout, to validate the solution carried over at the next step
+        warmMecable.resize(cnt);
+        warmMecable.zero(nullptr);
+        warmCount.resize(cnt);
+        for ( Mecable const* mec : objs )
+        {
+            if ( mec->nbPoints() > 0 )
+            {
+                warmMecable[mec->matIndex()] = mec;
+                warmCount[mec->matIndex()] = mec->nbPoints();
+            }
+        }
     }
+    
     nbPts = cnt;
     allocate(cnt);
+    setThreads(sim->prop->threads);
+    // in mixed precision, mB is multiplied in the SELL format:
+    mixedPrecision = ( sim->prop->mixed_precision == 1 );
+    useMatrixS = ( sim->prop->matrix_format == 1 ) || mixedPrecision;
+    useFloatMatrices = false;
     
     //allocate the sparse matrices:
     mB.resize(cnt);
@@ -803,28 +992,20 @@ void Meca::prepare(Simul const* sim)
     
     // reset base:
     zero_real(DIM*cnt, vBAS);
+    prepareShards();
     
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
+    real * pts = vPTS;
+    const bool keep = ( sim->prop->precondition == 2 );
+    forAllMecables([pts, keep](Mecable* mec, unsigned)
     {
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
-        {
-            Mecable * mec = *mci;
-            mec->putPoints(vPTS+DIM*mec->matIndex());
-            mec->prepareMecable();
-            mec->useBlock(0);
-            mci += NUM_THREADS;
-        }
-    }
-#else
-    for ( Mecable * mec : objs )
-    {
-        mec->putPoints(vPTS+DIM*mec->matIndex());
+        mec->putPoints(pts+DIM*mec->matIndex());
         mec->prepareMecable();
-        mec->useBlock(0);
-    }
-#endif
+        if ( !keep )
+            mec->useBlock(0);
+    });
+    
+    prepareStamp_ = TicToc::milliseconds();
+    prepareTime_ = prepareStamp_ - tic;
 }
 
 
@@ -834,12 +1015,15 @@ void Meca::prepare(Simul const* sim)
  */
 void Meca::prepareMatrices()
 {
-    mB.prepareForMultiply(DIM);
+    if ( useMatrixS )
+        mBS.build(mB, SELL_SIGMA, mixedPrecision);
+    else
+        mB.prepareForMultiply(DIM);
     
     if ( mC.nonZero() )
     {
         useMatrixC = true;
-        mC.prepareForMultiply(1);
+        mC.prepareForMultiply(1, mixedPrecision);
     }
     else
         useMatrixC = false;
@@ -903,6 +1087,81 @@ real brownian1(Mecable* mec, real const* rnd, real alpha, real* fff, real beta,
 }
 
 
+/**
+ Call the iterative solver specified by `method` (see SimulProp::solver)
+ to solve `MAT * vSOL = vRHS`, starting from the current value of vSOL.
+ The preconditionner is used if `pc` is true, and should have been computed.
+ */
+void Meca::iterate(unsigned method, unsigned dim, bool pc, LinearSolvers::Monitor& monitor)
+{
+    switch ( method )
+    {
+        case SOLVER_IDRS:
+            if ( pc )
+                LinearSolvers::IDRSP(*this, vRHS, vSOL, dim, monitor, allocator);
+            else
+                LinearSolvers::IDRS(*this, vRHS, vSOL, dim, monitor, allocator);
+            break;
+        case SOLVER_PBCGS:
+            if ( pc )
+                LinearSolvers::PBCGSP(*this, vRHS, vSOL, monitor, allocator);
+            else
+                LinearSolvers::PBCGS(*this, vRHS, vSOL, monitor, allocator);
+            break;
+        default:
+            if ( pc )
+                LinearSolvers::BCGSP(*this, vRHS, vSOL, monitor, allocator);
+            else
+                LinearSolvers::BCGS(*this, vRHS, vSOL, monitor, allocator);
+    }
+}
+
+
+/**
+ Iterative refinement of the solution in `vSOL`, obtained with mB and mC in
+ single precision: the residual is calculated in double precision, and a
+ correction is obtained by solving again in single precision, for this residual.
+ Returns the number of corrections.
+ */
+unsigned Meca::refine(unsigned method, unsigned dim, bool pc, real abstol)
+{
+    const index_t N = dimension();
+    real * rhs = new_real(N);
+    real * cor = new_real(N);
+    unsigned cnt = 0;
+    
+    // the number of corrections is limited, as each should reduce the error a lot
+    while ( cnt < 4 )
+    {
+        // rhs <- vRHS - MAT * vSOL, in double precision:
+        useFloatMatrices = false;
+        multiply(vSOL, rhs);
+        for ( index_t i = 0; i < N; ++i )
+            rhs[i] = vRHS[i] - rhs[i];
+        if ( blas::nrm8(N, rhs) < abstol )
+            break;
+        ++cnt;
+        
+        // solve MAT * cor = rhs, in single precision:
+        useFloatMatrices = true;
+        LinearSolvers::Monitor monitor(2*N, abstol);
+        zero_real(N, cor);
+        std::swap(rhs, vRHS);
+        std::swap(cor, vSOL);
+        iterate(method, dim, pc, monitor);
+        std::swap(rhs, vRHS);
+        std::swap(cor, vSOL);
+        blas::add(N, cor, vSOL);
+        if ( !monitor.converged() )
+            break;
+    }
+    useFloatMatrices = false;
+    free_real(cor);
+    free_real(rhs);
+    return cnt;
+}
+
+
 /**
  This solves the equation:
  
@@ -954,8 +1213,24 @@ void Meca::solve(SimulProp const* prop, const int precond)
     assert_true(ready_==0);
     // get global time step
     time_step = prop->time_step;
+    
+    // record statistics in the circular buffer, allocated here as secondary systems do not need it:
+    if ( !history_ )
+        history_ = new MecaStatistics[MECA_HISTORY];
+    MecaStatistics & stat = history_[nbSolves_++ % MECA_HISTORY];
+    double tic = TicToc::milliseconds();
+    stat.time = prop->time;
+    stat.size = dimension();
+    stat.precond = precond;
+    stat.fallback = 0;
+    stat.prepare = prepareTime_;
+    stat.assembly = tic - prepareStamp_;
+    stat.precondition = 0;
 
     prepareMatrices();
+    // the elements of mB are counted in both formats, since mBS contains padding:
+    stat.nnzB = mB.nbElements();
+    stat.nnzC = useMatrixC ? mC.nbElements() : 0;
     
     // calculate external forces in vFOR:
     calculateForces(vPTS, vBAS, vFOR);
@@ -989,30 +1264,21 @@ void Meca::solve(SimulProp const* prop, const int precond)
       vFOR <- vFOR + Noise
       vRHS <- P * vFOR:
      */
-#if NUM_THREADS > 1
-    #pragma omp parallel num_threads(NUM_THREADS)
     {
-        real local = INFINITY;
-        Mecable ** mci = objs.begin() + omp_get_thread_num();
-        while ( mci < objs.end() )
+        // each thread records its own minimum:
+        real * level = new_real(pool.size());
+        for ( unsigned t = 0; t < pool.size(); ++t )
+            level[t] = INFINITY;
+        forAllMecables([this, alpha, level](Mecable* mec, unsigned rank)
         {
-            const index_t inx = DIM * (*mci)->matIndex();
-            real n = brownian1(*mci, vRND+inx, alpha, vFOR+inx, time_step, vRHS+inx);
-            local = std::min(local, n);
-            mci += NUM_THREADS;
-        }
-        //printf("thread %i min: %f\n", omp_get_thread_num(), local);
-    #pragma omp critical
-        noiseLevel = std::min(noiseLevel, local);
-    }
-#else
-    for ( Mecable * mec : objs )
-    {
-        const index_t inx = DIM * mec->matIndex();
-        real n = brownian1(mec, vRND+inx, alpha, vFOR+inx, time_step, vRHS+inx);
-        noiseLevel = std::min(noiseLevel, n);
+            const index_t inx = DIM * mec->matIndex();
+            real n = brownian1(mec, vRND+inx, alpha, vFOR+inx, time_step, vRHS+inx);
+            level[rank] = std::min(level[rank], n);
+        });
+        for ( unsigned t = 0; t < pool.size(); ++t )
+            noiseLevel = std::min(noiseLevel, level[t]);
+        free_real(level);
     }
-#endif
 
     // scale minimum noise level to serve as a measure of required precision
     noiseLevel *= time_step;
@@ -1056,9 +1322,28 @@ void Meca::solve(SimulProp const* prop, const int precond)
      somehow continuous. However, the system is without inertia. In addition,
      objects are considered in a random order to build the linear system, such
      that the blocks from two consecutive iterations do not match.
-     From this, using zero for the initial guess seems safer:
+     From this, using zero for the initial guess seems safer, but if
+     `warm_start` is set, prepare() has ordered the Mecables by identity,
+     and copied the previous solution into vSOL.
      */
-    zero_real(dimension(), vSOL);
+    if ( !prop->warm_start )
+        zero_real(dimension(), vSOL);
+    else
+    {
+        /*
+         The previous displacement is scaled by the factor that minimizes the
+         residual | vRHS - M * scale * vSOL |, such that the initial residual is
+         never larger than with a zero guess. This handles relaxing objects,
+         for which consecutive displacements decrease in amplitude.
+         */
+        multiply(vSOL, vTMP);
+        real num = blas::dot(dimension(), vRHS, vTMP);
+        real den = blas::dot(dimension(), vTMP, vTMP);
+        if ( den > 0 )
+            blas::xscal(dimension(), num/den, vSOL, 1);
+        else
+            zero_real(dimension(), vSOL);
+    }
 
     /*
      We now solve the system MAT * vSOL = vRHS  by an iterative method:
@@ -1086,13 +1371,37 @@ void Meca::solve(SimulProp const* prop, const int precond)
 
     //------- call the iterative solver:
 
-    if ( precond )
-    {
+    size_t refresh = 0;
+    tic = TicToc::milliseconds();
+    if ( precond == 2 )
+        refresh = updatePreconditionner(prop->precondition_drift);
+    else if ( precond == 3 )
+        computeBandedPreconditionner();
+    else if ( precond )
         computePreconditionner();
-        LinearSolvers::BCGSP(*this, vRHS, vSOL, monitor, allocator);
+    double toc = TicToc::milliseconds();
+    stat.precondition = toc - tic;
+    
+    // in mixed precision, the iterations use mB and mC in single precision:
+    useFloatMatrices = mixedPrecision;
+    iterate(prop->solver, prop->solver_dim, precond, monitor);
+    tic = TicToc::milliseconds();
+    stat.krylov = tic - toc;
+
+    if ( prop->warm_start > 1 && monitor.converged() )
+    {
+        // solve again from zero, to measure the benefit of the initial guess:
+        real * cold = new_real(dimension());
+        zero_real(dimension(), cold);
+        LinearSolvers::Monitor ref(2*dimension(), abstol);
+        std::swap(cold, vSOL);
+        iterate(prop->solver, prop->solver_dim, precond, ref);
+        std::swap(cold, vSOL);
+        free_real(cold);
+        Cytosim::out("Meca warm start: count %4u cold %4u saved %4i\n",
+                     monitor.count(), ref.count(), (int)ref.count()-(int)monitor.count());
+        tic = TicToc::milliseconds();
     }
-    else
-        LinearSolvers::BCGS(*this, vRHS, vSOL, monitor, allocator);
 
 #if ( 0 )
     fprintf(stderr, "System size %6i precondition %i", dimension(), precond);
@@ -1125,11 +1434,24 @@ void Meca::solve(SimulProp const* prop, const int precond)
 #endif
     
     //------- in case the solver did not converge, we try other methods:
+
+    if ( !monitor.converged() && precond == 2 && refresh < objs.size() )
+    {
+        ++stat.fallback;
+        // some blocks of the preconditionner may be out-of-date:
+        Cytosim::out("Solver failed with old preconditionner: count %4u residual %.2e\n",
+                     monitor.count(), monitor.residual());
+        computePreconditionner();
+        monitor.reset();
+        zero_real(dimension(), vSOL);
+        iterate(prop->solver, prop->solver_dim, true, monitor);
+    }
     
     if ( !monitor.converged() )
     {
         Cytosim::out("Solver failed: precond %i flag %i count %4u residual %.2e\n",
             precond, monitor.flag(), monitor.count(), monitor.residual());
+        ++stat.fallback;
         
         // try with different initial seed: vRHS
         monitor.reset();
@@ -1139,14 +1461,23 @@ void Meca::solve(SimulProp const* prop, const int precond)
         
         if ( !monitor.converged() )
         {
+            ++stat.fallback;
             monitor.reset();
             zero_real(dimension(), vSOL);
             
             if ( precond )
             {
-                // try with the other method:
-                LinearSolvers::BCGSP(*this, vRHS, vSOL, monitor, allocator);
-                Cytosim::out("    BCGSP: count %4u residual %.2e\n", monitor.count(), monitor.residual());
+                // try with another method:
+                if ( prop->solver == SOLVER_IDRS )
+                {
+                    iterate(SOLVER_BCGS, 0, true, monitor);
+                    Cytosim::out("    BCGSP: count %4u residual %.2e\n", monitor.count(), monitor.residual());
+                }
+                else
+                {
+                    iterate(SOLVER_IDRS, IDRS_MAX, true, monitor);
+                    Cytosim::out("    IDRSP: count %4u residual %.2e\n", monitor.count(), monitor.residual());
+                }
             }
             else
             {
@@ -1156,15 +1487,17 @@ void Meca::solve(SimulProp const* prop, const int precond)
                 Cytosim::out("    GMRES: count %4u residual %.2e\n", monitor.count(), monitor.residual());
                 if ( !monitor.converged() )
                 {
+                    ++stat.fallback;
                     // try with other method:
                     monitor.reset();
                     zero_real(dimension(), vSOL);
-                    LinearSolvers::BCGSP(*this, vRHS, vSOL, monitor, allocator);
+                    iterate(prop->solver, prop->solver_dim, true, monitor);
                 }
             }
             
             if ( !monitor.converged() )
             {
+                ++stat.fallback;
                 // try with different GMRES parameters:
                 monitor.reset();
                 zero_real(dimension(), vSOL);
@@ -1174,11 +1507,21 @@ void Meca::solve(SimulProp const* prop, const int precond)
             
             if ( !monitor.converged() )
             {
+                useFloatMatrices = false;
+                stat.count = monitor.count();
+                stat.residual = monitor.residual();
+                stat.krylov += TicToc::milliseconds() - tic;
                 // if the solver did not converge, its result cannot be used!
                 throw Exception("no convergence after ",monitor.count()," iterations, residual ",monitor.residual());
             }
         }
     }
+    unsigned corrections = 0;
+    if ( useFloatMatrices )
+        corrections = refine(prop->solver, prop->solver_dim, precond, abstol);
+    stat.krylov += TicToc::milliseconds() - tic;
+    stat.count = monitor.count();
+    stat.residual = monitor.residual();
     
 #ifndef NDEBUG
     
@@ -1205,12 +1548,12 @@ void Meca::solve(SimulProp const* prop, const int precond)
     calculateForces(vPTS, vBAS, vFOR);
     
     // add Brownian terms:
-    for ( Mecable * mec : objs )
+    forAllMecables([this, alpha](Mecable const* mec, unsigned)
     {
         const size_t inx = DIM * mec->matIndex();
         mec->addBrownianForces(vRND+inx, alpha, vFOR+inx);
         //fprintf(stderr, "\n  "); VecPrint::print(stderr, DIM*mec->nbPoints(), vFOR+inx, 2, DIM);
-    }
+    });
 
     ready_ = 1;
     
@@ -1220,9 +1563,12 @@ void Meca::solve(SimulProp const* prop, const int precond)
         std::stringstream oss;
         oss << "Meca " << DIM << "*" << nbPts;
         oss << " brick " << largestMecable();
-        oss << " " << mB.what();
+        oss << " " << ( useMatrixS ? mBS.what() : mB.what() );
         if ( useMatrixC ) oss << " " << mC.what();
         oss << " precond " << precond;
+        if ( precond == 2 ) oss << " refresh " << refresh << "/" << objs.size();
+        if ( prop->warm_start ) oss << " warm";
+        if ( mixedPrecision ) oss << " refine " << corrections;
         oss << " count " << monitor.count();
         //oss << " flag " << monitor.flag();
         oss << " residual " << monitor.residual() << "\n";
@@ -1238,26 +1584,12 @@ void Meca::apply()
 {
     if ( ready_ )
     {
-#if NUM_THREADS > 1
-#pragma omp parallel num_threads(NUM_THREADS)
-        {
-            Mecable ** mci = objs.begin() + omp_get_thread_num();
-            while ( mci < objs.end() )
-            {
-                Mecable * mec = *mci;
-                mec->getForces(vFOR+DIM*mec->matIndex());
-                mec->getPoints(vPTS+DIM*mec->matIndex());
-                mci += NUM_THREADS;
-            }
-        }
-#else
-        for ( Mecable * mec : objs )
+        forAllMecables([this](Mecable* mec, unsigned)
         {
             size_t off = DIM * mec->matIndex();
             mec->getPoints(vPTS+off);
             mec->getForces(vFOR+off);
-        }
-#endif
+        });
     }
     else
     {
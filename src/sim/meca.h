@@ -9,8 +9,11 @@
 #include "matrix.h"
 //#include "matsparse.h"
 #include "matsparsesym1.h"
+#include "matsparsesell.h"
 #include "matsparsesymblk.h"
 #include "allocator.h"
+#include "monitor.h"
+#include "thread_pool.h"
 
 
 class Mecable;
@@ -41,6 +44,40 @@ typedef Matrix33 MatrixBlock;
 #define DRAW_MECA_LINKS 0
 
 
+/// number of calls to Meca::solve() for which statistics are kept
+#define MECA_HISTORY 256
+
+
+/// Statistics recorded for one call to Meca::solve()
+struct MecaStatistics
+{
+    /// simulated time at which the system was solved
+    double   time;
+    /// number of degrees of freedom
+    size_t   size;
+    /// number of elements in the isotropic matrix mB
+    size_t   nnzB;
+    /// number of elements in the non-isotropic matrix mC
+    size_t   nnzC;
+    /// preconditionning method
+    int      precond;
+    /// number of matrix-vector multiplications in the last solver called
+    unsigned count;
+    /// final residual
+    real     residual;
+    /// number of alternative methods that were tried after a failure
+    unsigned fallback;
+    /// wall time (milliseconds) spent in Meca::prepare()
+    double   prepare;
+    /// wall time (milliseconds) between prepare() and solve(), setting the interactions
+    double   assembly;
+    /// wall time (milliseconds) spent computing the preconditionner
+    double   precondition;
+    /// wall time (milliseconds) spent in the iterative solvers
+    double   krylov;
+};
+
+
 /// A class to calculate the motion of objects in Cytosim
 /**
 Meca solves the motion of objects defined by points (i.e. Mecable),
@@ -130,6 +167,12 @@ private:
     
     /// size of the currently allocated memory
     size_t          allocated_;
+    
+    /// Mecable that was located at each index in the previous call to prepare()
+    Array<Mecable const*> warmMecable;
+    
+    /// number of points of the Mecable that was located at each index in warmMecable
+    Array<index_t>  warmCount;
 
     //--------------------------------------------------------------------------
     // Vectors of size DIM * nbPoints()
@@ -156,6 +199,42 @@ private:
     
     /// true if the matrix mC is non-zero
     bool   useMatrixC;
+    
+    /// true if mB should be multiplied using the copy in mBS
+    bool   useMatrixS;
+    
+    /// copy of mB in SELL-C-sigma format, used for multiplication if useMatrixS
+    MatrixSparseSELL mBS;
+    
+    /// true if mB, mC and the blocks of the preconditionner are also stored in single precision
+    bool   mixedPrecision;
+    
+    /// true if mB and mC should be multiplied using their copies in single precision
+    bool   useFloatMatrices;
+    
+    /// threads used to process the Mecables in parallel
+    mutable ThreadPool pool;
+    
+    /// initial distribution of Mecables to the threads: [ split[i], split[i+1] [
+    Array<size_t> split;
+    
+    /// secondary systems in which threads of rank > 0 set their interactions
+    Meca *        shards;
+    
+    /// number of secondary systems allocated
+    unsigned      nbShards;
+    
+    /// circular buffer with the statistics of the last MECA_HISTORY calls to solve()
+    MecaStatistics * history_;
+    
+    /// number of calls to solve() since the creation of Meca
+    size_t        nbSolves_;
+    
+    /// wall time (milliseconds) spent in the last call to prepare()
+    double        prepareTime_;
+    
+    /// wall time (milliseconds) at the end of the last call to prepare()
+    double        prepareStamp_;
 
 public:
 
@@ -260,9 +339,18 @@ private:
     /// calculate the linear part of forces:  Y <- B + ( mB + mC ) * X
     void calculateForces(const real* X, const real* B, real* Y) const;
     
+    /// calculate Y <- Y + mB * X using mBS, distributing the work over the threads
+    void multiplyMatrixS(const real* X, real* Y) const;
+    
     /// add forces due to bending elasticity
     void addAllRigidity(const real* X, real* Y) const;
 
+    /// compute the diagonal block of the stiffness matrix corresponding to a Mecable
+    void getStiffnessBlock(real* res, const Mecable*) const;
+    
+    /// extract the band of the stiffness block, with `kd` subdiagonals
+    void getStiffnessBand(real* res, unsigned kd, const Mecable*) const;
+
     /// compute the matrix diagonal block corresponding to a Mecable
     void getBlock(real* res, const Mecable*) const;
     
@@ -280,6 +368,34 @@ private:
     
     /// compute all blocks of the preconditionner (method=1)
     void computePreconditionner();
+    
+    /// recompute the blocks of the preconditionner that are out-of-date (method=2)
+    size_t updatePreconditionner(real threshold);
+    
+    /// compute the preconditionner block of given Mecable in band storage
+    void computeBandedPreconditionner(Mecable*);
+    
+    /// compute all blocks of the preconditionner, using band storage for Fibers (method=3)
+    void computeBandedPreconditionner();
+    
+    /// solve the system with iterative method `method`, preconditionned if `pc`
+    void iterate(unsigned method, unsigned dim, bool pc, LinearSolvers::Monitor&);
+    
+    /// correct the solution obtained in mixed precision, until the residual is below `abstol`
+    unsigned refine(unsigned method, unsigned dim, bool pc, real abstol);
+    
+    /// distribute Mecables to threads, balancing the number of points
+    void setThreads(unsigned);
+    
+    /// call `func(Mecable*, rank)` for all Mecables, using the thread pool
+    template < typename FUNC >
+    void forAllMecables(FUNC const& func) const;
+    
+    /// reset the secondary systems, allocating them if necessary
+    void prepareShards();
+    
+    /// delete secondary systems
+    void releaseShards();
 
 public:
     
@@ -287,7 +403,7 @@ public:
     Meca();
     
     /// destructor
-    ~Meca() { release(); }
+    ~Meca() { releaseShards(); release(); delete[] history_; }
     
     /// Add a Mecable to the list of objects to be simulated
     void     addMecable(Mecable* p) { objs.push_back(p); }
@@ -307,12 +423,53 @@ public:
     /// Implementation of LinearOperator::size()
     size_t dimension() const { return DIM * nbPts; }
     
+    /// number of threads available to Meca
+    unsigned nbThreads() const { return pool.size(); }
+    
+    /// system in which the thread of given rank should set its interactions
+    Meca&    shard(unsigned rank) { return rank ? shards[rank-1] : *this; }
+    
+    /// call `func(i, Meca&)` for `i` in [0, cnt), distributing the calls over the threads
+    /**
+     Each thread records the interactions in its own system, given as argument to `func`,
+     and mergeShards() must be called afterwards to combine the results.
+     */
+    template < typename FUNC >
+    void     forAllInteractions(size_t cnt, FUNC const& func)
+    {
+        Meca * self = this;
+        auto job = [self, &func](size_t i, unsigned rank) { func(i, self->shard(rank)); };
+        pool.run(cnt, nullptr, job);
+    }
+    
+    /// call `func(i, rank)` for `i` in [0, cnt), distributing the calls over the threads
+    /**
+     This can be used outside of the solve, to share the threads with other tasks.
+     */
+    template < typename FUNC >
+    void     forAll(size_t cnt, FUNC& func) const
+    {
+        pool.run(cnt, nullptr, func);
+    }
+    
+    /// add the interactions recorded by the secondary systems to mB, mC and vBAS
+    void     mergeShards();
+    
     /// calculate Y <- M*X, where M is the matrix associated with the system
     void multiply(const real* X, real* Y) const;
 
     /// apply preconditionner: Y <- P*X (note that X maybe equal to Y)
     void precondition(const real* X, real* Y) const;
     
+    /// number of calls to solve() for which statistics are available
+    size_t nbStatistics() const { return std::min(nbSolves_, (size_t)MECA_HISTORY); }
+    
+    /// statistics of a recent call to solve(), from the oldest (0) to the last ( nbStatistics()-1 )
+    MecaStatistics const& statistics(size_t i) const
+    {
+        return history_[( nbSolves_ - nbStatistics() + i ) % MECA_HISTORY];
+    }
+    
     //--------------------------- FORCE ELEMENTS -------------------------------
 
     /// Add a constant force on Mecapoint
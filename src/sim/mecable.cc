@@ -6,6 +6,7 @@
 #include "iowrapper.h"
 #include "organizer.h"
 #include "space.h"
+#include "lu_mixed.h"
 
 
 //------------------------------------------------------------------------------
@@ -17,10 +18,13 @@ void Mecable::clearMecable()
     pAllocated = 0;
     nPoints    = 0;
     pBlock     = nullptr;
+    pBlockF    = nullptr;
     pPivot     = nullptr;
     pBlockAlc  = 0;
     pBlockUse  = false;
     pBlockSize = 0;
+    pBlockPos  = nullptr;
+    pBlockHands = 0;
     pPos       = nullptr;
     pForce     = nullptr;
     pIndex     = -1;  // that is an invalid value
@@ -59,11 +63,15 @@ void Mecable::allocateBlock()
     if ( pBlockSize > pBlockAlc )
     {
         free_real(pBlock);
+        free_real(pBlockPos);
+        delete[] pBlockF;
         delete[] pPivot;
+        pBlockF = nullptr;
         size_t bum = chunk_real(pBlockSize);
         //std::clog << "Mecable("<<reference()<<")::allocateBlock " << bum << "\n";
    
         pBlock = new_real(bum*bum);
+        pBlockPos = new_real(bum);
         pPivot = new int[bum];
         pBlockAlc = bum;
         
@@ -72,6 +80,51 @@ void Mecable::allocateBlock()
 }
 
 
+/**
+ The single precision copy is allocated with the same size as pBlock[]
+ */
+void Mecable::convertBlock()
+{
+    if ( !pBlockF )
+        pBlockF = new float[pBlockAlc*pBlockAlc];
+    LUMixed::convert(pBlockSize*pBlockSize, pBlock, pBlockF);
+}
+
+
+void Mecable::stampBlock()
+{
+    assert_true( pBlockSize == DIM * nPoints );
+    copy_real(pBlockSize, pPos, pBlockPos);
+    pBlockHands = nbAttachedHands();
+}
+
+
+/**
+ The block is considered out-of-date if:
+ - the number of points has changed,
+ - the number of attached Hands has changed,
+ - any point has moved by more than `threshold` since stampBlock() was called.
+ .
+ */
+bool Mecable::staleBlock(real threshold) const
+{
+    if ( !pBlockUse || pBlockSize != DIM * nPoints )
+        return true;
+    
+    if ( pBlockHands != nbAttachedHands() )
+        return true;
+    
+    const real lim = threshold * threshold;
+    for ( unsigned p = 0; p < nPoints; ++p )
+    {
+        Vector dx = Vector(pPos+DIM*p) - Vector(pBlockPos+DIM*p);
+        if ( dx.normSqr() > lim )
+            return true;
+    }
+    return false;
+}
+
+
 /**
  allocateMecable(size) ensures that the set can hold `size` points
  it returns the size if new memory was allocated
@@ -106,6 +159,10 @@ void Mecable::release()
 {
     free_real(pBlock);
     pBlock = nullptr;
+    delete[] pBlockF;
+    pBlockF = nullptr;
+    free_real(pBlockPos);
+    pBlockPos = nullptr;
     delete[] pPivot;
     pPivot = nullptr;
     
@@ -336,8 +393,7 @@ bool Mecable::allInside(Space const* spc) const
 void Mecable::write(Outputter& out) const
 {
     out.writeUInt16(nPoints);
-    for ( unsigned p = 0; p < nPoints ; ++p )
-        out.writeFloats(pPos+DIM*p, DIM, '\n');
+    writePoints(out, pPos, nPoints, '\n');
 }
 
 
@@ -350,12 +406,7 @@ void Mecable::read(Inputter& in, Simul&, ObjectTag)
         //we reset the point for a clean start:
         resetPoints();
         nPoints = nb;
-#if ( 1 )
-        for ( unsigned p = 0; p < nb ; ++p )
-            in.readFloats(pPos+DIM*p, DIM);
-#else
-        in.readFloats(pPos, nb, DIM);
-#endif
+        readPoints(in, pPos, nb);
     }
     catch( Exception & e )
     {
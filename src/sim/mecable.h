@@ -55,6 +55,9 @@ private:
     /// Matrix block used for preconditionning in Meca::solve()
     real *      pBlock;
     
+    /// Copy of pBlock[] in single precision, allocated by convertBlock()
+    float *     pBlockF;
+    
     /// Pivot indices for LAPACK
     int *       pPivot;
     
@@ -67,6 +70,12 @@ private:
     /// Flag that pBlock[] is used for preconditionning
     int         pBlockUse;
     
+    /// coordinates of the points when pBlock[] was calculated
+    real *      pBlockPos;
+    
+    /// number of attached Hands when pBlock[] was calculated
+    unsigned    pBlockHands;
+    
     /// Index that Object coordinates occupy in the matrices and vectors of Meca
     index_t     pIndex;
 
@@ -275,7 +284,7 @@ public:
     /// Allocates pBlock[] to hold a `N x N` full matrix, where N = DIM * nbPoints()
     void            allocateBlock();
     
-    /// True if preconditionner block is 'in use'
+    /// Type of preconditionner block in use: 0 = none, 1 = dense LU, 2 = band, 3 = dense LU in single precision
     int             useBlock()           const { return pBlockUse; }
     
     /// Change preconditionning flag
@@ -289,6 +298,49 @@ public:
     
     /// Returns address of memory allocated for preconditionning (pivot)
     int *           pivot()              const { return pPivot; }
+    
+    /// copy the current block in single precision, into blockF()
+    void            convertBlock();
+    
+    /// Returns the copy of the block in single precision made by convertBlock()
+    float *         blockF()             const { return pBlockF; }
+    
+    /// record the current state, to be called after the block was calculated
+    void            stampBlock();
+    
+    /// true if the object has changed significantly since stampBlock() was called
+    bool            staleBlock(real threshold) const;
+    
+    /// number of Hands attached to this object, used to detect changes in interactions
+    virtual unsigned nbAttachedHands()   const { return 0; }
+    
+    /// number of neighbors on each side of a vertex with which it interacts internally (0 = not banded)
+    virtual unsigned bandWidth()         const { return 0; }
+    
+    /// number of subdiagonals of the stiffness band, corresponding to bandWidth()
+    unsigned        bandDiagonals()      const { return DIM * ( bandWidth() + 1 ) - 1; }
+    
+    /// zeroed memory owned by the Mecable, to hold the stiffness block in band storage
+    /**
+     The element (i, j) of the symmetric stiffness block, for j <= i <= j + kd,
+     is stored at [i-j+(kd+1)*j], where kd = bandDiagonals(),
+     as in LAPACK symmetric lower band storage.
+     */
+    virtual real*   stiffnessBand() { return nullptr; }
+    
+    /// add rigidity terms to a matrix in the band storage of stiffnessBand()
+    virtual void    addRigidityBand(real*) const {}
+    
+    /// factorize the preconditionner block in band storage, given `beta = -time_step * mobility`
+    /**
+     This uses the stiffness block, which must have been set in stiffnessBand().
+     The band is approximated to bandWidth() neighbors, and the result should be
+     stored in memory owned by the Mecable. Returns 0 if successful.
+     */
+    virtual int     factorBandBlock(real) { return -1; }
+    
+    /// apply the preconditionner block computed by factorBandBlock() to a vector
+    virtual void    solveBandBlock(real*) const {}
 
     //--------------------------------------------------------------------------
     
@@ -349,6 +401,15 @@ public:
     /// true if addProjectionDiff() does something
     virtual bool    hasProjectionDiff() const { return false; }
     
+    /// calculate Y <- X + alpha * leftoverMobility() * P * ( Y + Rigidity * X + P' * X )
+    /**
+     This is the part of Meca::multiply() that is specific to the Mecable,
+     combining addRigidity(), addProjectionDiff() and projectForces().
+     This returns `false` if it is not implemented, in which case these
+     functions are called separately. This is enabled by FUSED_MULTIPLY in meca.cc
+     */
+    virtual bool    multiplyFused(real, const real*, real*) const { return false; }
+    
     //--------------------------------------------------------------------------
     //           Position-related functions derived from Movable
     //--------------------------------------------------------------------------
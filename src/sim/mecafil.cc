@@ -19,12 +19,18 @@ Mecafil::Mecafil()
     rfLag  = nullptr;
     rfLLG  = nullptr;
     rfVTP  = nullptr;
+    rfBand = nullptr;
+    rfBandPivot = nullptr;
+    rfBandAlc = 0;
+    useProjectionDiff = false;
 }
 
 
 Mecafil::~Mecafil()
 {
     destroyProjection();
+    free_real(rfBand);
+    delete[] rfBandPivot;
     free_real(rfDiff);
     rfDiff = nullptr;
     rfLag  = nullptr;
@@ -76,6 +82,11 @@ void Mecafil::release()
 {
     free_real(rfDiff);
     rfDiff = nullptr;
+    free_real(rfBand);
+    rfBand = nullptr;
+    delete[] rfBandPivot;
+    rfBandPivot = nullptr;
+    rfBandAlc = 0;
 }
 
 
@@ -152,10 +163,208 @@ void Mecafil::projectForces(const real* X, real* Y) const
 void Mecafil::computeTensions(const real*) {} //DIM == 1
 void Mecafil::makeProjectionDiff(const real*) {} //DIM == 1
 void Mecafil::addProjectionDiff(const real*, real*) const {} //DIM == 1
+bool Mecafil::multiplyFused(real, const real*, real*) const { return false; } //DIM == 1
 
 #endif
 
 
+//------------------------------------------------------------------------------
+#pragma mark - Band Preconditionner
+
+unsigned Mecafil::bandWidth() const
+{
+#if NEW_FIBER_LOOP
+    if ( rfRigidityLoop )
+        return 0;
+#endif
+    return ( DIM > 1 ) ? 2 : 0;
+}
+
+
+/// sizes of the augmented system, where the unknowns are interleaved
+struct BandSize
+{
+    int N, KL, LDAB, KD;
+    
+    BandSize(unsigned nbp, unsigned width)
+    {
+        N = ( DIM + 1 ) * nbp - 1;
+        KL = ( DIM + 1 ) * ( width + 1 ) - 1;
+        LDAB = 3 * KL + 1;
+        KD = DIM * ( width + 1 ) - 1;
+    }
+};
+
+
+/**
+ The stiffness band is stored after the LU factors and the work vector in rfBand[],
+ using ( KD + 1 ) * N values, which is sufficient since DIM * nPoints <= N
+ */
+real* Mecafil::stiffnessBand()
+{
+    const BandSize S(nPoints, bandWidth());
+    
+    if ( rfBandAlc < (size_t)S.N )
+    {
+        free_real(rfBand);
+        delete[] rfBandPivot;
+        rfBandAlc = chunk_real(S.N);
+        rfBand = new_real(( S.LDAB + 1 + S.KD + 1 ) * rfBandAlc);
+        rfBandPivot = new int[rfBandAlc];
+    }
+    real * res = rfBand + ( S.LDAB + 1 ) * rfBandAlc;
+    zero_real(( S.KD + 1 ) * DIM * nPoints, res);
+    return res;
+}
+
+
+/**
+ Bending elasticity adds `-R * c[a] * c[b]` between points `p+a` and `p+b`
+ for every triplet of consecutive points {p, p+1, p+2}, with c = { 1, -2, 1 }
+ */
+void Mecafil::addRigidityBand(real* band) const
+{
+    const unsigned kd = bandDiagonals();
+    const unsigned ldb = kd + 1;
+    const real c[3] = { 1, -2, 1 };
+    
+    for ( unsigned p = 2; p < nPoints; ++p )
+    {
+        real * col = band + ldb * DIM * ( p - 2 );
+        for ( unsigned b = 0; b < 3; ++b )
+        for ( unsigned a = b; a < 3 && DIM * ( a - b ) <= kd; ++a )
+        {
+            const real val = rfRigidity * c[a] * c[b];
+            for ( unsigned d = 0; d < DIM; ++d )
+                col[DIM*(a-b)+ldb*(DIM*b+d)] -= val;
+        }
+    }
+}
+
+
+/**
+ The preconditionner block is M = I + beta * P * A, where A is the stiffness
+ block and P = I - J' * inv( J * J' ) * J is the projection of the constraints,
+ with ( J * X )[s] = rfDiff[s] . ( X[s+1] - X[s] ).
+ Introducing the Lagrange multipliers L = inv( J * J' ) * J * A * Y,
+ the system M * Y = X is equivalent to the augmented system:
+ 
+     ( I + beta * A ) * Y - beta * J' * L = X
+                 - J * A * Y + J * J' * L = 0
+ 
+ If the multiplier of segment `s` is placed after the coordinates of vertex `s`,
+ this matrix is banded, and its LU factorization has a cost linear in nbPoints().
+ The terms of A coupling vertices further apart than bandWidth() are neglected,
+ and so is the correction to the projection P'.
+ The matrix A is read from the band set by Meca in stiffnessBand().
+ */
+int Mecafil::factorBandBlock(const real beta)
+{
+    const unsigned W = bandWidth();
+    const BandSize S(nPoints, W);
+    const int D1 = DIM + 1;
+    
+    assert_true( rfBandAlc >= (size_t)S.N );
+    zero_real(S.LDAB*S.N, rfBand);
+    
+    real const* stiff = rfBand + ( S.LDAB + 1 ) * rfBandAlc;
+    const int ldk = S.KD + 1;
+    // element (i, j) of the symmetric stiffness block, for |i-j| <= KD:
+    auto mat = [stiff, ldk](int i, int j) -> real
+    {
+        return ( i >= j ) ? stiff[i-j+ldk*j] : stiff[j-i+ldk*i];
+    };
+
+    real * band = rfBand + 2 * S.KL;
+    const int ldb = S.LDAB - 1;
+    // address of the element (i, j) of the matrix in LAPACK band storage:
+    auto val = [band, ldb](int i, int j) -> real& { return band[i+ldb*j]; };
+    
+    const unsigned last = nPoints - 1;
+    for ( unsigned p = 0; p < nPoints; ++p )
+    {
+        const unsigned inf = ( p > W ) ? p - W : 0;
+        const unsigned sup = std::min(p + W, last);
+        for ( int a = 0; a < DIM; ++a )
+        {
+            const int i = D1 * p + a;
+            // ( I + beta * A ) * Y
+            for ( unsigned q = inf; q <= sup; ++q )
+                for ( int b = 0; b < DIM; ++b )
+                    val(i, D1*q+b) = beta * mat(DIM*p+a, DIM*q+b);
+            val(i, i) += 1.0;
+            // - beta * J' * L
+            if ( p > 0 )
+                val(i, D1*p-1) = -beta * rfDiff[DIM*(p-1)+a];
+            if ( p < last )
+                val(i, D1*p+DIM) = beta * rfDiff[DIM*p+a];
+        }
+    }
+    
+    for ( unsigned s = 0; s < last; ++s )
+    {
+        const int i = D1 * s + DIM;
+        const real * dif = rfDiff + DIM * s;
+        // - J * A * Y, using only the terms of A within the band
+        const unsigned inf = ( s > W ) ? s - W : 0;
+        const unsigned sup = std::min(s + 1 + W, last);
+        for ( unsigned q = inf; q <= sup; ++q )
+        {
+            for ( int b = 0; b < DIM; ++b )
+            {
+                const int j = DIM * q + b;
+                real sum = 0;
+                for ( int a = 0; a < DIM; ++a )
+                {
+                    if ( q + W >= s + 1 )
+                        sum += dif[a] * mat(DIM*(s+1)+a, j);
+                    if ( q <= s + W )
+                        sum -= dif[a] * mat(DIM*s+a, j);
+                }
+                val(i, D1*q+b) = -sum;
+            }
+        }
+        // J * J' * L
+        val(i, i) = 2 * blas::dot(DIM, dif, dif);
+        if ( s > 0 )
+            val(i, i-D1) = -blas::dot(DIM, dif, dif-DIM);
+        if ( s + 1 < last )
+            val(i, i+D1) = -blas::dot(DIM, dif, dif+DIM);
+    }
+    
+    int info = 0;
+    lapack::xgbtrf(S.N, S.N, S.KL, S.KL, rfBand, S.LDAB, rfBandPivot, &info);
+    return info;
+}
+
+
+/**
+ Solve the augmented system, with the Lagrange multipliers set to zero in the RHS
+ */
+void Mecafil::solveBandBlock(real* vec) const
+{
+    const BandSize S(nPoints, bandWidth());
+    real * tmp = rfBand + S.LDAB * rfBandAlc;
+    
+    for ( unsigned p = 0; p < nPoints; ++p )
+    {
+        for ( int d = 0; d < DIM; ++d )
+            tmp[(DIM+1)*p+d] = vec[DIM*p+d];
+        if ( p < nPoints - 1 )
+            tmp[(DIM+1)*p+DIM] = 0;
+    }
+    
+    int info = 0;
+    lapack::xgbtrs('N', S.N, S.KL, S.KL, 1, rfBand, S.LDAB, rfBandPivot, tmp, S.N, &info);
+    
+    for ( unsigned p = 0; p < nPoints; ++p )
+    {
+        for ( int d = 0; d < DIM; ++d )
+            vec[DIM*p+d] = tmp[(DIM+1)*p+d];
+    }
+}
+
+
 void Mecafil::printTensions(FILE * out, char c) const
 {
     fprintf(out, "\n%c%s ", c, reference().c_str());
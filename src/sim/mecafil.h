@@ -43,6 +43,15 @@ private:
     /// true if all elements of mtJJtiJforce[] are null
     bool        useProjectionDiff;
     
+    /// LU factorization of the augmented preconditionner block in band storage, followed by a work vector and the stiffness band
+    real   *    rfBand;
+    
+    /// pivots of the LU factorization of rfBand[]
+    int    *    rfBandPivot;
+    
+    /// allocated size of rfBandPivot[]
+    size_t      rfBandAlc;
+    
 protected:
     
     /// mobility of the points (all points have the same drag coefficient)
@@ -139,6 +148,9 @@ public:
     
     /// print projection matrix
     void        printProjection(std::ostream&) const;
+    
+    /// calculate Y <- X + alpha * mobility * P * ( Y + Rigidity * X + P' * X ) in two passes
+    bool        multiplyFused(real alpha, const real* X, real* Y) const;
 
     //--------------------- Rigidity
 
@@ -147,6 +159,21 @@ public:
     
     /// add rigidity terms to upper side of matrix
     void        addRigidityUpper(real*, unsigned) const;
+    
+    /// bending elasticity couples each vertex to the two vertices on each side
+    unsigned    bandWidth() const;
+    
+    /// memory to hold the stiffness block in band storage
+    real*       stiffnessBand();
+    
+    /// add rigidity terms to a matrix in band storage
+    void        addRigidityBand(real*) const;
+    
+    /// factorize the augmented preconditionner block in band storage
+    int         factorBandBlock(real beta);
+    
+    /// apply the preconditionner block computed by factorBandBlock()
+    void        solveBandBlock(real* vec) const;
 
 };
 
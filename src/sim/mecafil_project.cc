@@ -569,6 +569,191 @@ void Mecafil::printProjection(std::ostream& os) const
 
 
 
+//------------------------------------------------------------------------------
+#pragma mark - Fused multiplication
+
+/**
+ Add the bending elasticity forces, and perform the first calculation of the
+ projection, in a single pass over the vertices:
+ 
+     Y <- Y + Rigidity * X
+     mul <- J * Y
+ 
+ This is equivalent to add_rigidityF() followed by projectForcesU(), for nbp > 3
+ */
+void add_rigidity_projectU(unsigned nbp, const real* dif, const real* X, const real R1, real* Y, real* mul)
+{
+    assert_true( nbp > 3 );
+    const real R2 = R1 * 2;
+    const real R4 = R1 * 4;
+    const real R5 = R1 * 5;
+    const real R6 = R1 * 6;
+    
+    // the first two vertices have special terms:
+    for ( int d = 0; d < DIM; ++d )
+    {
+        Y[d    ] += R2 * X[d+DIM] - R1 * ( X[d] + X[d+DIM*2] );
+        Y[d+DIM] += R2 * X[d] + R4 * X[d+DIM*2] - R5 * X[d+DIM] - R1 * X[d+DIM*3];
+    }
+    mul[0] = dif[0] * ( Y[DIM] - Y[0] ) + dif[1] * ( Y[DIM+1] - Y[1] )
+#if ( DIM > 2 )
+           + dif[2] * ( Y[DIM+2] - Y[2] )
+#endif
+    ;
+
+    const unsigned end = nbp - 2;
+    for ( unsigned p = 2; p < end; ++p )
+    {
+        real * y = Y + DIM * p;
+        real const* x = X + DIM * p;
+        real const* d = dif + DIM * ( p - 1 );
+        y[0] += R4 * ( x[-DIM  ] + x[DIM  ] ) - R1 * ( x[-DIM*2  ] + x[DIM*2  ] ) - R6 * x[0];
+        y[1] += R4 * ( x[-DIM+1] + x[DIM+1] ) - R1 * ( x[-DIM*2+1] + x[DIM*2+1] ) - R6 * x[1];
+#if ( DIM > 2 )
+        y[2] += R4 * ( x[-DIM+2] + x[DIM+2] ) - R1 * ( x[-DIM*2+2] + x[DIM*2+2] ) - R6 * x[2];
+#endif
+        // the segment ending at vertex `p` is now complete:
+        mul[p-1] = d[0] * ( y[0] - y[-DIM] ) + d[1] * ( y[1] - y[1-DIM] )
+#if ( DIM > 2 )
+                 + d[2] * ( y[2] - y[2-DIM] )
+#endif
+        ;
+    }
+    
+    // the last two vertices have special terms:
+    real * y = Y + DIM * end;
+    real const* x = X + DIM * end;
+    for ( int d = 0; d < DIM; ++d )
+    {
+        y[d    ] += R2 * x[d+DIM] + R4 * x[d-DIM] - R5 * x[d] - R1 * x[d-DIM*2];
+        y[d+DIM] += R2 * x[d] - R1 * ( x[d-DIM] + x[d+DIM] );
+    }
+    for ( unsigned p = end; p <= end+1; ++p )
+    {
+        real const* d = dif + DIM * ( p - 1 );
+        real const* z = Y + DIM * p;
+        mul[p-1] = d[0] * ( z[0] - z[-DIM] ) + d[1] * ( z[1] - z[1-DIM] )
+#if ( DIM > 2 )
+                 + d[2] * ( z[2] - z[2-DIM] )
+#endif
+        ;
+    }
+}
+
+
+/**
+ Perform the second calculation needed by projectForces, followed by the
+ scaling and addition needed in Meca::multiply():
+ 
+     Y <- X + alpha * ( Y + Jt * mul )
+ 
+ This is equivalent to projectForcesD() followed by blas::xpay()
+ */
+void projectForcesD_xpay_(unsigned nbs, const real* dif, const real* X, const real alpha,
+                          const real* mul, real* Y)
+{
+    for ( unsigned d = 0, e = DIM*nbs; d < DIM; ++d, ++e )
+    {
+        Y[d] = X[d] + alpha * ( Y[d] + dif[d    ] * mul[    0] );
+        Y[e] = X[e] + alpha * ( Y[e] - dif[e-DIM] * mul[nbs-1] );
+    }
+    
+    for ( unsigned jj = 1; jj < nbs; ++jj )
+    {
+        const unsigned kk = DIM*jj;
+        Y[kk  ] = X[kk  ] + alpha * ( Y[kk  ] + dif[kk  ] * mul[jj] - dif[kk-DIM  ] * mul[jj-1] );
+        Y[kk+1] = X[kk+1] + alpha * ( Y[kk+1] + dif[kk+1] * mul[jj] - dif[kk-DIM+1] * mul[jj-1] );
+#if ( DIM > 2 )
+        Y[kk+2] = X[kk+2] + alpha * ( Y[kk+2] + dif[kk+2] * mul[jj] - dif[kk-DIM+2] * mul[jj-1] );
+#endif
+    }
+}
+
+
+#if ( DIM == 3 ) && defined(__AVX2__) && defined(__FMA__) && REAL_IS_DOUBLE
+
+#include "simd.h"
+
+/**
+ AVX2 version of projectForcesD_xpay_(), processing 4 vertices (12 scalars) at once.
+ The multipliers are distributed to the coordinates with permute4x64:
+     ( m0 m0 m0 m1 ) ( m1 m1 m2 m2 ) ( m2 m3 m3 m3 )
+ */
+void projectForcesD_xpay_AVX(unsigned nbs, const real* dif, const real* X, const real alpha,
+                             const real* mul, real* Y)
+{
+    for ( unsigned d = 0, e = DIM*nbs; d < DIM; ++d, ++e )
+    {
+        Y[d] = X[d] + alpha * ( Y[d] + dif[d    ] * mul[    0] );
+        Y[e] = X[e] + alpha * ( Y[e] - dif[e-DIM] * mul[nbs-1] );
+    }
+    
+    const vec4 aa = set4(alpha);
+    unsigned jj = 1;
+    for ( ; jj + 4 <= nbs; jj += 4 )
+    {
+        const unsigned kk = DIM*jj;
+        vec4 m = loadu4(mul+jj);
+        vec4 n = loadu4(mul+jj-1);
+        vec4 m0 = permute4x64(m, 0x40), m1 = permute4x64(m, 0xA5), m2 = permute4x64(m, 0xFE);
+        vec4 n0 = permute4x64(n, 0x40), n1 = permute4x64(n, 0xA5), n2 = permute4x64(n, 0xFE);
+        vec4 y0 = _mm256_fmadd_pd(loadu4(dif+kk  ), m0, loadu4(Y+kk  ));
+        vec4 y1 = _mm256_fmadd_pd(loadu4(dif+kk+4), m1, loadu4(Y+kk+4));
+        vec4 y2 = _mm256_fmadd_pd(loadu4(dif+kk+8), m2, loadu4(Y+kk+8));
+        y0 = _mm256_fnmadd_pd(loadu4(dif+kk-DIM  ), n0, y0);
+        y1 = _mm256_fnmadd_pd(loadu4(dif+kk-DIM+4), n1, y1);
+        y2 = _mm256_fnmadd_pd(loadu4(dif+kk-DIM+8), n2, y2);
+        storeu4(Y+kk  , _mm256_fmadd_pd(aa, y0, loadu4(X+kk  )));
+        storeu4(Y+kk+4, _mm256_fmadd_pd(aa, y1, loadu4(X+kk+4)));
+        storeu4(Y+kk+8, _mm256_fmadd_pd(aa, y2, loadu4(X+kk+8)));
+    }
+    
+    for ( ; jj < nbs; ++jj )
+    {
+        const unsigned kk = DIM*jj;
+        Y[kk  ] = X[kk  ] + alpha * ( Y[kk  ] + dif[kk  ] * mul[jj] - dif[kk-DIM  ] * mul[jj-1] );
+        Y[kk+1] = X[kk+1] + alpha * ( Y[kk+1] + dif[kk+1] * mul[jj] - dif[kk-DIM+1] * mul[jj-1] );
+        Y[kk+2] = X[kk+2] + alpha * ( Y[kk+2] + dif[kk+2] * mul[jj] - dif[kk-DIM+2] * mul[jj-1] );
+    }
+}
+
+#  define projectForcesD_xpay projectForcesD_xpay_AVX
+#else
+#  define projectForcesD_xpay projectForcesD_xpay_
+#endif
+
+
+/**
+ Calculate the product needed by Meca::multiply(), in two passes over the vertices:
+ 
+     Y <- X + alpha * mobility * P * ( Y + Rigidity * X + P' * X )
+ 
+ where the projection P is calculated as in projectForces().
+ The multipliers are left in rfLLG[], as done by projectForces()
+ */
+bool Mecafil::multiplyFused(const real alpha, const real* X, real* Y) const
+{
+#if NEW_FIBER_LOOP
+    if ( rfRigidityLoop )
+        return false;
+#endif
+    if ( nPoints < 4 )
+        return false;
+    
+    const unsigned nbs = nbSegments();
+    if ( useProjectionDiff )
+        addProjectionDiff(X, Y);
+    
+    add_rigidity_projectU(nPoints, rfDiff, X, rfRigidity, Y, rfLLG);
+    
+    // rfLLG <- inv( J * Jt ) * rfLLG to find the Lagrange multipliers
+    lapack::xptts2(nbs, 1, mtJJt, mtJJtU, rfLLG, nbs);
+    
+    projectForcesD_xpay(nbs, rfDiff, X, alpha * rfPointMobility, rfLLG, Y);
+    return true;
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark - Projection DIFF
 //#include "cytoblas.h"
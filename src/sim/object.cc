@@ -2,6 +2,7 @@
 
 #include "object.h"
 #include "iowrapper.h"
+#include "delta_codec.h"
 #include "exceptions.h"
 #include "property.h"
 #include "object_set.h"
@@ -183,6 +184,28 @@ void Object::writeHeader(Outputter& out, ObjectTag g) const
 }
 
 
+/**
+ In a compressed frame, the coordinates are quantized and delta-encoded
+ by the DeltaCodec, using codecKey() to match them with the previous frame.
+ */
+void Object::writePoints(Outputter& out, real const* ptr, size_t cnt, char before) const
+{
+    if ( out.codec() )
+        out.codec()->write(out, codecKey(), ptr, cnt, DIM);
+    else
+        out.writeFloats(ptr, cnt, DIM, before);
+}
+
+
+void Object::readPoints(Inputter& in, real* ptr, size_t cnt) const
+{
+    if ( in.codec() )
+        in.codec()->read(in, codecKey(), ptr, cnt, in.vectorSize(), DIM);
+    else
+        in.readFloats(ptr, cnt, DIM);
+}
+
+
 void Object::readHeader(Inputter& in, bool fat, unsigned& ix, ObjectID& id, ObjectMark& mk)
 {
     if ( in.binary() )
@@ -106,6 +106,15 @@ public:
     /// read Object from file, within the Simul
     virtual void    read(Inputter&, Simul&, ObjectTag) = 0;
     
+    /// key identifying the coordinates of this object in compressed frames
+    uint64_t        codecKey() const { return (uint64_t)tag() << 32 | identity(); }
+    
+    /// write `cnt` vectors, which are compressed if `out` has a codec
+    void            writePoints(Outputter&, real const*, size_t cnt, char before = 0) const;
+    
+    /// read `cnt` vectors written by writePoints()
+    void            readPoints(Inputter&, real*, size_t cnt) const;
+    
     //--------------------------
 
     /// returns container ObjectSet
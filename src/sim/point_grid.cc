@@ -7,12 +7,19 @@
 #include "space.h"
 #include "meca.h"
 
+#if defined(__AVX__) && REAL_IS_DOUBLE
+#  include "simd.h"
+#  define STERIC_USES_AVX 1
+#else
+#  define STERIC_USES_AVX 0
+#endif
+
 extern Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
 PointGrid::PointGrid()
-: max_diameter(0)
+: pCells(nullptr), nPanes(1), max_diameter(0)
 {
 }
 
@@ -57,9 +64,11 @@ size_t PointGrid::setGrid(Space const* spc, real min_step)
     return pGrid.nbCells();
 }
 
-void PointGrid::createCells()
+void PointGrid::createCells(unsigned nb_panes)
 {
-    pGrid.createCells();
+    nPanes = std::max(1U, nb_panes);
+    delete[] pCells;
+    pCells = new PointGridCell[nPanes*pGrid.nbCells()];
 
     //Create side regions suitable for pairwise interactions:
     pGrid.createSideRegions(1);
@@ -73,6 +82,15 @@ void PointGrid::createCells()
 }
 
 
+void PointGrid::clear()
+{
+    PointGridCell * c = pCells;
+    PointGridCell const* last = pCells + nPanes * pGrid.nbCells();
+    for ( ; c < last; ++c )
+        c->clear();
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -80,15 +98,24 @@ void PointGrid::createCells()
 #define CHECK_RANGE 0
 
 
-#if ( NB_STERIC_PANES != 1 )
+/**
+ Objects with `steric == p` are placed in pane `p`.
+ If there is only one pane, all objects are placed in it, irrespective of `p`.
+ */
+unsigned PointGrid::pane(unsigned p) const
+{
+    if ( nPanes == 1 )
+        return 1;
+    if ( p == 0 || p > nPanes )
+        throw InvalidParameter("object:steric is out-of-range (should be <= simul:steric)");
+    return p;
+}
+
 
 void PointGrid::add(unsigned pan, Mecapoint const& pe, real rd, real rg) const
 {
-    if ( pan == 0 || pan > NB_STERIC_PANES )
-        throw InvalidParameter("object:steric is out-of-range");
-
     Vector w = pe.pos();
-    point_list(w, pan).new_val().set(pe, rd, rg, w);
+    cell(w, pane(pan)).points.add(w, std::max(rd, rg)).set(pe, rd, rg, w);
     
 #if ( CHECK_RANGE )
     //we check that the grid would correctly detect collision of two particles
@@ -105,12 +132,9 @@ void PointGrid::add(unsigned pan, Mecapoint const& pe, real rd, real rg) const
 
 void PointGrid::add(unsigned pan, FiberSegment const& fl, real rd, real rg) const
 {
-    if ( pan == 0 || pan > NB_STERIC_PANES )
-        throw InvalidParameter("object:steric is out-of-range");
-
     // link in the cell containing the middle of the segment:
     Vector w = fl.center();
-    segment_list(w, pan).new_val().set(fl, rd, rg);
+    cell(w, pane(pan)).segments.add(w, 0.5*fl.len()+std::max(rd, rg)).set(fl, rd, rg);
     
 #if ( CHECK_RANGE )
     //we check that the grid would correctly detect collision of two segments
@@ -128,9 +152,6 @@ void PointGrid::add(unsigned pan, FiberSegment const& fl, real rd, real rg) cons
 }
 
 
-#endif
-
-
 //------------------------------------------------------------------------------
 #pragma mark - Steric functions
 
@@ -448,188 +469,212 @@ inline bool adjacent(FatSegment const* a, FatSegment const* b)
 #pragma mark - Check all possible object pairs from two Cells
 
 /**
- This will consider once all pairs of objects from the given lists
+ Call `func(j)` for every index `j >= start` of `list`, such that the bounding
+ sphere of object `j` overlaps with the bounding sphere of object `i` of `base`.
+ Other objects cannot interact with object `i`, and are skipped.
+ The indices are visited in increasing order, such that the interactions are
+ set in the same order as without this selection.
+ With periodic boundary conditions, all indices are visited.
  */
-void PointGrid::setInteractions(Meca& meca, PointGridParam const& stiff,
-                                FatPointList & pots, FatSegmentList & locs) const
+template < typename BASE, typename LIST, typename FUNC >
+static inline void forOverlapping(BASE const& base, size_t i, LIST const& list, size_t start, FUNC const& func)
 {
-    for ( FatPoint* ii = pots.begin(); ii < pots.end(); ++ii )
+    const size_t end = list.size();
+    size_t j = start;
+
+    if ( modulo )
     {
-        for ( FatPoint* jj = ii+1; jj < pots.end(); ++jj )
-            if ( !adjacent(ii, jj) )
-                checkPP(meca, stiff, *ii, *jj);
-        
-        for ( FatSegment* kk = locs.begin(); kk < locs.end(); ++kk )
-            if ( !adjacent(ii, kk) )
-                checkPL(meca, stiff, *ii, *kk);
+        for ( ; j < end; ++j )
+            func(j);
+        return;
     }
-    
-    for ( FatSegment* ii = locs.begin(); ii < locs.end(); ++ii )
+
+    const real x = base.cenX[i];
+    const real y = base.cenY[i];
+    const real z = base.cenZ[i];
+    const real r = base.reach[i];
+    real const* X = list.cenX.data();
+    real const* Y = list.cenY.data();
+    real const* Z = list.cenZ.data();
+    real const* R = list.reach.data();
+
+#if STERIC_USES_AVX
+    // test 4 spheres at once:
+    const vec4 vx = set4(x), vy = set4(y), vz = set4(z), vr = set4(r);
+    for ( ; j + 4 <= end; j += 4 )
     {
-        for ( FatSegment* jj = ii+1; jj < locs.end(); ++jj )
-            if ( !adjacent(ii, jj) )
-                checkLL(meca, stiff, *ii, *jj);
+        vec4 dx = sub4(loadu4(X+j), vx);
+        vec4 dy = sub4(loadu4(Y+j), vy);
+        vec4 dz = sub4(loadu4(Z+j), vz);
+        vec4 s = add4(loadu4(R+j), vr);
+        vec4 d = add4(add4(mul4(dx, dx), mul4(dy, dy)), mul4(dz, dz));
+        int m = _mm256_movemask_pd(cmp4(d, mul4(s, s), _CMP_LT_OQ));
+        while ( m )
+        {
+            func(j+__builtin_ctz(m));
+            m &= m - 1;
+        }
+    }
+#endif
+    for ( ; j < end; ++j )
+    {
+        if ( square(X[j]-x) + square(Y[j]-y) + square(Z[j]-z) < square(R[j]+r) )
+            func(j);
     }
 }
 
 
 /**
- This will consider once all pairs of objects from the given lists,
- assuming that the list are different and no object is repeated
+ This will consider once all pairs of objects from the given cell
  */
-void PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
-                                FatPointList & pots1, FatSegmentList & locs1,
-                                FatPointList & pots2, FatSegmentList & locs2) const
+void PointGrid::setInteractions(Meca& meca, PointGridParam const& stiff,
+                                PointGridCell const& cel) const
 {
-    assert_true( &pots1 != &pots2 );
-    assert_true( &locs1 != &locs2 );
+    FatPointList const& pots = cel.points;
+    FatSegmentList const& locs = cel.segments;
     
-    for ( FatPoint* ii = pots1.begin(); ii < pots1.end(); ++ii )
+    for ( size_t i = 0; i < pots.size(); ++i )
     {
-        for ( FatPoint* jj = pots2.begin(); jj < pots2.end(); ++jj )
-            if ( !adjacent(ii, jj) )
-                checkPP(meca, pam, *ii, *jj);
+        FatPoint const* ii = &pots[i];
+        
+        forOverlapping(pots, i, pots, i+1, [&](size_t j)
+        {
+            if ( !adjacent(ii, &pots[j]) )
+                checkPP(meca, stiff, *ii, pots[j]);
+        });
         
-        for ( FatSegment* kk = locs2.begin(); kk < locs2.end(); ++kk )
-            if ( !adjacent(ii, kk) )
-                checkPL(meca, pam, *ii, *kk);
+        forOverlapping(pots, i, locs, 0, [&](size_t k)
+        {
+            if ( !adjacent(ii, &locs[k]) )
+                checkPL(meca, stiff, *ii, locs[k]);
+        });
     }
     
-    for ( FatSegment* ii = locs1.begin(); ii < locs1.end(); ++ii )
+    for ( size_t i = 0; i < locs.size(); ++i )
     {
-        for ( FatPoint* jj = pots2.begin(); jj < pots2.end(); ++jj )
-            if ( !adjacent(jj, ii) )
-                checkPL(meca, pam, *jj, *ii);
+        FatSegment const* ii = &locs[i];
         
-        for ( FatSegment* kk = locs2.begin(); kk < locs2.end(); ++kk )
+        forOverlapping(locs, i, locs, i+1, [&](size_t j)
         {
-            if ( !adjacent(ii, kk)  )
-                checkLL(meca, pam, *ii, *kk);
-        }
+            if ( !adjacent(ii, &locs[j]) )
+                checkLL(meca, stiff, *ii, locs[j]);
+        });
     }
 }
 
 
-#if ( NB_STERIC_PANES == 1 )
-
 /**
- Check interactions between objects contained in the grid.
+ This will consider once all pairs of objects from the given cells,
+ assuming that the cells are different and no object is repeated
  */
-void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam) const
+void PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
+                                PointGridCell const& cel1, PointGridCell const& cel2) const
 {
-    assert_true(pam.stiff_push >= 0);
-    assert_true(pam.stiff_pull >= 0);
-    //std::clog << "----" << std::endl;
-
-    // scan all cells to examine each pair of particles:
-    for ( unsigned inx = 0; inx < pGrid.nbCells(); ++inx )
+    assert_true( &cel1 != &cel2 );
+    FatPointList const& pots1 = cel1.points;
+    FatSegmentList const& locs1 = cel1.segments;
+    FatPointList const& pots2 = cel2.points;
+    FatSegmentList const& locs2 = cel2.segments;
+    
+    for ( size_t i = 0; i < pots1.size(); ++i )
     {
-        int * region;
-        int nr = pGrid.getRegion(region, inx);
-        assert_true(region[0] == 0);
+        FatPoint const* ii = &pots1[i];
         
-        // We consider each pair of objects (ii, jj) only once:
+        forOverlapping(pots1, i, pots2, 0, [&](size_t j)
+        {
+            if ( !adjacent(ii, &pots2[j]) )
+                checkPP(meca, pam, *ii, pots2[j]);
+        });
         
-        FatPointList & baseP = point_list(inx);
-        FatSegmentList & baseL = segment_list(inx);
+        forOverlapping(pots1, i, locs2, 0, [&](size_t k)
+        {
+            if ( !adjacent(ii, &locs2[k]) )
+                checkPL(meca, pam, *ii, locs2[k]);
+        });
+    }
+    
+    for ( size_t i = 0; i < locs1.size(); ++i )
+    {
+        FatSegment const* ii = &locs1[i];
         
-        setInteractions(meca, pam, baseP, baseL);
+        forOverlapping(locs1, i, pots2, 0, [&](size_t j)
+        {
+            if ( !adjacent(&pots2[j], ii) )
+                checkPL(meca, pam, pots2[j], *ii);
+        });
         
-        for ( int reg = 1; reg < nr; ++reg )
+        forOverlapping(locs1, i, locs2, 0, [&](size_t k)
         {
-            FatPointList & sideP = point_list(inx+region[reg]);
-            FatSegmentList & sideL = segment_list(inx+region[reg]);
-            
-            setInteractions(meca, pam, baseP, baseL, sideP, sideL);
-        }
+            if ( !adjacent(ii, &locs2[k]) )
+                checkLL(meca, pam, *ii, locs2[k]);
+        });
     }
 }
 
 
-#else
-
 /**
- Check interactions between the FatPoints contained in Pane `pan`.
+ Check interactions between the FatPoints contained in Pane `pan`,
+ for the cells of index in [start, stop[ and their neighbors.
  */
 void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
-                                 const unsigned pan) const
+                                 const unsigned pan, const size_t start, const size_t stop) const
 {
     assert_true(pam.stiff_push >= 0);
     assert_true(pam.stiff_pull >= 0);
+    assert_true(stop <= pGrid.nbCells());
     
-    // scan all cells to examine each pair of particles:
-    for ( unsigned inx = 0; inx < pGrid.nbCells(); ++inx )
+    // scan cells to examine each pair of particles:
+    for ( size_t inx = start; inx < stop; ++inx )
     {
         int * region;
         int nr = pGrid.getRegion(region, inx);
         assert_true(region[0] == 0);
         
         // We consider each pair of objects (ii, jj) only once:
+        PointGridCell const& base = cell(inx, pan);
         
-        FatPointList & baseP = point_list(inx, pan);
-        FatSegmentList & baseL = segment_list(inx, pan);
+        setInteractions(meca, pam, base);
         
-        setInteractions(meca, pam, baseP, baseL);
-
         for ( int reg = 1; reg < nr; ++reg )
-        {
-            FatPointList & sideP = point_list(inx+region[reg], pan);
-            FatSegmentList & sideL = segment_list(inx+region[reg], pan);
-            
-            setInteractions(meca, pam, baseP, baseL, sideP, sideL);
-        }
+            setInteractions(meca, pam, base, cell(inx+region[reg], pan));
     }
 }
 
 
 /**
  Check interactions between the FatPoints contained in Panes `pan1` and `pan2`,
- where ( pan1 != pan2 )
+ where ( pan1 != pan2 ), for the cells of index in [start, stop[ and their neighbors.
  */
 void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam,
-                                 const unsigned pan1, const unsigned pan2) const
+                                 const unsigned pan1, const unsigned pan2,
+                                 const size_t start, const size_t stop) const
 {
     assert_true(pam.stiff_push >= 0);
     assert_true(pam.stiff_pull >= 0);
     assert_true(pan1 != pan2);
+    assert_true(stop <= pGrid.nbCells());
     
-    // scan all cells to examine each pair of particles:
-    for ( unsigned inx = 0; inx < pGrid.nbCells(); ++inx )
+    // scan cells to examine each pair of particles:
+    for ( size_t inx = start; inx < stop; ++inx )
     {
         int * region;
         int nr = pGrid.getRegion(region, inx);
         assert_true(region[0] == 0);
 
         // We consider each pair of objects (ii, jj) only once:
+        PointGridCell const& base1 = cell(inx, pan1);
         
-        FatPointList & baseP = point_list(inx, pan1);
-        FatSegmentList & baseL = segment_list(inx, pan1);
-
         for ( int reg = 0; reg < nr; ++reg )
-        {
-            FatPointList & sideP = point_list(inx+region[reg], pan2);
-            FatSegmentList & sideL = segment_list(inx+region[reg], pan2);
-
-            setInteractions(meca, pam, baseP, baseL, sideP, sideL);
-        }
+            setInteractions(meca, pam, base1, cell(inx+region[reg], pan2));
         
-        FatPointList & baseP2 = point_list(inx, pan2);
-        FatSegmentList & baseL2 = segment_list(inx, pan2);
+        PointGridCell const& base2 = cell(inx, pan2);
         
         for ( int reg = 1; reg < nr; ++reg )
-        {
-            FatPointList & sideP = point_list(inx+region[reg], pan1);
-            FatSegmentList & sideL = segment_list(inx+region[reg], pan1);
-            
-            setInteractions(meca, pam, baseP2, baseL2, sideP, sideL);
-        }
+            setInteractions(meca, pam, base2, cell(inx+region[reg], pan1));
     }
 }
 
 
-#endif
-
-
 //------------------------------------------------------------------------------
 #pragma mark - Display
 
@@ -117,94 +117,81 @@ public:
 };
 
 
-/// type for a list of FatPoint
-typedef Array<FatPoint> FatPointList;
-
-/// type for a list of FatSegment
-typedef Array<FatSegment> FatSegmentList;
-
-
-/// number of panes in the steric engine
-/** This should normally be set equal to 1, for optimal performance */
-#define NB_STERIC_PANES 1
-
-
-/// a set of lists associated with the same location
-class PointGridCell
+/// a list of FatPoint or FatSegment, with a copy of their bounding spheres
+/**
+ The centers and radii of the spheres enclosing the objects are recorded by add(),
+ when the grid is filled, and stored as structure-of-arrays, such that they can
+ be compared with SIMD instructions. This is used to skip the pairs of objects
+ that cannot interact, without accessing the vertices of the objects.
+ The radius of a sphere includes the range of interaction of its object.
+ */
+template < typename FAT >
+class FatList : public Array<FAT>
 {
-    friend class PointGrid;
-    
-#if ( NB_STERIC_PANES == 1 )
-    
-    /// unique steric pane
-    FatPointList point_pane;
-    
-    /// unique steric pane
-    FatSegmentList segment_pane;
-
-#else
-
-    /// different steric panes
-    FatPointList point_panes_0[NB_STERIC_PANES];
-
-    /// different steric panes
-    FatSegmentList segment_panes_0[NB_STERIC_PANES];
-
-    /// alias to the array of panes, with index 1 refering to point_panes_0[0]
-    FatPointList * point_panes;
-
-    /// alias to the array of panes, with index 1 refering to segment_panes_0[0]
-    FatSegmentList * segment_panes;
-
-#endif
-    
 public:
     
-#if ( NB_STERIC_PANES == 1 )
+    /// coordinates of the centers of the bounding spheres
+    Array<real> cenX, cenY, cenZ;
     
-    PointGridCell()
-    {
-    }
+    /// radii of the bounding spheres
+    Array<real> reach;
     
-    /// clear all panes
+    /// clear all lists
     void clear()
     {
-        point_pane.clear();
-        segment_pane.clear();
+        Array<FAT>::clear();
+        cenX.clear();
+        cenY.clear();
+        cenZ.clear();
+        reach.clear();
     }
-
-#else
     
-    PointGridCell() : point_panes(point_panes_0), segment_panes(segment_panes_0)
+    /// add an object with bounding sphere of center `w` and radius `rad`, and return it
+    FAT& add(Vector const& w, real rad)
     {
-        --point_panes;
-        --segment_panes;
+        cenX.push_back(w.XX);
+#if ( DIM > 1 )
+        cenY.push_back(w.YY);
+#else
+        cenY.push_back(0);
+#endif
+#if ( DIM > 2 )
+        cenZ.push_back(w.ZZ);
+#else
+        cenZ.push_back(0);
+#endif
+        reach.push_back(rad);
+        return Array<FAT>::new_val();
     }
+};
+
+
+/// type for a list of FatPoint
+typedef FatList<FatPoint> FatPointList;
+
+/// type for a list of FatSegment
+typedef FatList<FatSegment> FatSegmentList;
+
+
+/// the lists of objects associated with the same location and the same pane
+class PointGridCell
+{
+    friend class PointGrid;
     
-    /// clear all panes
-    void clear()
-    {
-        for ( unsigned p = 1; p <= NB_STERIC_PANES; ++p )
-        {
-            point_panes[p].clear();
-            segment_panes[p].clear();
-        }
-    }
+    /// spherical objects
+    FatPointList points;
     
-    FatPointList& point_list(unsigned p)
-    {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return point_panes[p];
-    }
+    /// segments of fibers
+    FatSegmentList segments;
     
+public:
     
-    FatSegmentList& segment_list(unsigned p)
+    /// clear lists
+    void clear()
     {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return segment_panes[p];
+        points.clear();
+        segments.clear();
     }
-
-#endif
 };
 
 
@@ -232,13 +219,30 @@ public:
  - Function setStericInteraction() uses pGrid to find pairs of FatPoints that may overlap.
  It then calculates their actual distance, and set a interaction from Meca if necessary
  .
+ Objects are placed in different 'panes', and each location of the grid holds
+ one PointGridCell for each pane. The cells of the same location are contiguous.
+ Interactions are calculated within a pane, or between two panes, such that
+ the objects of panes that should not interact are never compared.
+ The number of panes is set by createCells().
+ 
+ The pairs are only read from the grid, and setInteractions() can be called
+ concurrently for different ranges of cells, if each thread records the
+ interactions in a different Meca (see Simul::setAllInteractionsParallel).
+ Since a cell is only paired with neighbors of higher index, each pair of
+ objects is considered by exactly one range.
 */
 class PointGrid
 {
 private:
     
     /// grid for divide-and-conquer strategies:
-    Grid<PointGridCell, DIM> pGrid;
+    GridBase<DIM> pGrid;
+    
+    /// array of cells, of size nPanes * pGrid.nbCells()
+    PointGridCell * pCells;
+    
+    /// number of panes
+    unsigned nPanes;
     
     /// max radius that can be included
     real max_diameter;
@@ -260,125 +264,73 @@ private:
     /// check two Line segments
     void checkLL(Meca&, PointGridParam const&, FatSegment const&, FatSegment const&) const;
 
-    /// check all interacting pairs between the two lists
-    void setInteractions(Meca&, PointGridParam const&,
-                         FatPointList &, FatSegmentList &) const;
-    
-    /// check all interacting pairs between the two lists
-    void setInteractions(Meca&, PointGridParam const&,
-                         FatPointList &, FatSegmentList &,
-                         FatPointList &, FatSegmentList &) const;
-
-#if ( NB_STERIC_PANES == 1 )
-
-    /// cell corresponding to position `w`, and pane `p`
-    FatPointList& point_list(Vector const& w) const
-    {
-        return pGrid.cell(w).point_pane;
-    }
-
-    /// cell corresponding to position `w`, and pane `p`
-    FatSegmentList& segment_list(Vector const& w) const
-    {
-        return pGrid.cell(w).segment_pane;
-    }
-
-    /// cell corresponding to index `w`, and pane `p`
-    FatPointList& point_list(const unsigned w) const
-    {
-        return pGrid.icell(w).point_pane;
-    }
+    /// check all interacting pairs within one cell
+    void setInteractions(Meca&, PointGridParam const&, PointGridCell const&) const;
     
-    /// cell corresponding to index `w`, and pane `p`
-    FatSegmentList& segment_list(const unsigned w) const
-    {
-        return pGrid.icell(w).segment_pane;
-    }
-    
-#else
-    
-    /// cell corresponding to position `w`, and pane `p`
-    FatPointList& point_list(Vector const& w, const unsigned p) const
+    /// check all interacting pairs between two different cells
+    void setInteractions(Meca&, PointGridParam const&, PointGridCell const&, PointGridCell const&) const;
+
+    /// cell of index `c` in pane `p`
+    PointGridCell& cell(const size_t c, const unsigned p) const
     {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return pGrid.cell(w).point_panes[p];
+        assert_true( 0 < p && p <= nPanes );
+        return pCells[nPanes*c+p-1];
     }
     
-    /// cell corresponding to position `w`, and pane `p`
-    FatSegmentList& segment_list(Vector const& w, const unsigned p) const
+    /// cell corresponding to position `w` in pane `p`
+    PointGridCell& cell(Vector const& w, const unsigned p) const
     {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return pGrid.cell(w).segment_panes[p];
+        return cell(pGrid.index(w), p);
     }
+
+    /// return pane in which objects with `steric == p` are placed
+    unsigned pane(unsigned p) const;
     
-    /// cell corresponding to index `c`, and pane `p`
-    FatPointList& point_list(const unsigned c, const unsigned p) const
-    {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return pGrid.icell(c).point_panes[p];
-    }
+    /// Disabled copy constructor
+    PointGrid(PointGrid const&);
     
-    /// cell corresponding to index `c`, and pane `p`
-    FatSegmentList& segment_list(const unsigned c, const unsigned p) const
-    {
-        assert_true( 0 < p && p <= NB_STERIC_PANES );
-        return pGrid.icell(c).segment_panes[p];
-    }
+    /// Disabled copy assignment, since pCells[] is owned
+    PointGrid& operator=(PointGrid const&);
 
-#endif
-    
 public:
     
     /// creator
     PointGrid();
     
+    /// destructor
+    ~PointGrid() { delete[] pCells; }
+    
     /// define grid covering specified Space, with cell of size min_step at least
     size_t setGrid(Space const*, real min_step);
     
-    /// allocate memory for grid
-    void createCells();
+    /// allocate memory for grid, with given number of panes
+    void createCells(unsigned nb_panes);
     
     /// true if the grid was initialized by calling setGrid()
-    size_t hasGrid() const  { return pGrid.hasCells(); }
-    
-    /// clear the grid
-    void clear()            { pGrid.clear(); }
-    
-#if ( NB_STERIC_PANES == 1 )
+    size_t hasGrid() const  { return pCells ? pGrid.nbCells() : 0; }
     
-    /// place Mecapoint on the grid
-    void add(Mecapoint const& p, real radius, real extra_range) const
-    {
-        Vector w = p.pos();
-        point_list(w).new_val().set(p, radius, extra_range, w);
-    }
-    
-    /// place FiberSegment on the grid
-    void add(FiberSegment const& p, real radius, real extra_range) const
-    {
-        //we use the middle of the segment (interpolation coefficient is ignored)
-        Vector w = p.center();
-        segment_list(w).new_val().set(p, radius, extra_range);
-    }
+    /// number of cells in the grid
+    size_t nbCells() const  { return pGrid.nbCells(); }
     
-    /// enter interactions into Meca with given stiffness
-    void setInteractions(Meca&, PointGridParam const& pam) const;
+    /// number of panes
+    unsigned nbPanes() const { return nPanes; }
 
-#else
- 
-    /// place Mecapoint on the grid
-    void add(unsigned pane, Mecapoint const&, real radius, real extra_range) const;
+    /// clear the grid
+    void clear();
     
-    /// place FiberSegment on the grid
-    void add(unsigned pane, FiberSegment const&, real radius, real extra_range) const;
+    /// place Mecapoint on the grid, in pane `pan`
+    void add(unsigned pan, Mecapoint const&, real radius, real extra_range) const;
     
-    /// enter interactions into Meca in one panes with given parameters
-    void setInteractions(Meca&, PointGridParam const& pam, unsigned pan) const;
-
-    /// enter interactions into Meca between two panes with given parameters
-    void setInteractions(Meca&, PointGridParam const& pam, unsigned pan1, unsigned pan2) const;
+    /// place FiberSegment on the grid, in pane `pan`
+    void add(unsigned pan, FiberSegment const&, real radius, real extra_range) const;
+    
+    /// enter interactions into Meca in one pane with given parameters, for cells in [start, stop[
+    void setInteractions(Meca&, PointGridParam const& pam, unsigned pan,
+                         size_t start, size_t stop) const;
 
-#endif
+    /// enter interactions into Meca between two panes with given parameters, for cells in [start, stop[
+    void setInteractions(Meca&, PointGridParam const& pam, unsigned pan1, unsigned pan2,
+                         size_t start, size_t stop) const;
     
     /// OpenGL display function
     void draw() const;
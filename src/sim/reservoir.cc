@@ -0,0 +1,267 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "reservoir.h"
+#include "assert_macro.h"
+#include "exceptions.h"
+#include "messages.h"
+#include "fiber_set.h"
+#include "random.h"
+#include "space.h"
+#include <cmath>
+
+
+/**
+ The grid covers the boundaries of the Space with cubic voxels of size `step`.
+ The volume that each voxel shares with the Space is estimated by testing a
+ regular array of points within the voxel.
+ */
+void Reservoir::setGrid(Space const* spc, real step, real diff, real time_step)
+{
+    if ( !spc )
+        throw InvalidParameter("a Space is needed for reservoir_step");
+    if ( step <= 0 )
+        throw InvalidParameter("reservoir_step should be > 0");
+
+    space_ = spc;
+
+    Vector inf, sup;
+    spc->boundaries(inf, sup);
+
+    real infs[3] = { 0, 0, 0 };
+    real sups[3] = { 0, 0, 0 };
+    int size[3] = { 1, 1, 1 };
+
+    // we use cubic cells, centered on the Space:
+    for ( int d = 0; d < DIM; ++d )
+    {
+        size[d] = std::max(1, (int)ceil( ( sup[d] - inf[d] ) / step ));
+        real mid = 0.5 * ( inf[d] + sup[d] );
+        infs[d] = mid - 0.5 * step * size[d];
+        sups[d] = mid + 0.5 * step * size[d];
+    }
+    grid_.setDimensions(infs, sups, size);
+
+    const index_t nbc = grid_.nbCells();
+    pools_.clear();
+    pools_.resize(nbc);
+    vol_.resize(nbc);
+
+    // volume inside the Space, using SUB^DIM points per voxel:
+    const int SUB = 4;
+    int nbp = 1;
+    for ( int d = 0; d < DIM; ++d )
+        nbp *= SUB;
+
+    for ( index_t i = 0; i < nbc; ++i )
+    {
+        real w[3] = { 0, 0, 0 };
+        grid_.setPositionFromIndex(w, i, 0);
+        int cnt = 0;
+        for ( int p = 0; p < nbp; ++p )
+        {
+            real x[3] = { 0, 0, 0 };
+            int s = p;
+            for ( int d = 0; d < DIM; ++d )
+            {
+                x[d] = w[d] + step * ( ( s % SUB ) + 0.5 ) / SUB;
+                s /= SUB;
+            }
+            cnt += spc->inside(Vector(x));
+        }
+        vol_[i] = grid_.cellVolume() * cnt / nbp;
+    }
+
+    /*
+     Objects cannot diffuse out of a voxel that has no volume inside the Space,
+     and they are instead redirected to the voxel inside with the nearest center.
+     */
+    dst_.resize(nbc);
+    for ( index_t i = 0; i < nbc; ++i )
+    {
+        dst_[i] = i;
+        if ( vol_[i] > 0 )
+            continue;
+        real w[3] = { 0, 0, 0 };
+        grid_.setPositionFromIndex(w, i, 0.5);
+        real dis = INFINITY;
+        for ( index_t j = 0; j < nbc; ++j )
+        {
+            if ( vol_[j] > 0 )
+            {
+                real x[3] = { 0, 0, 0 };
+                grid_.setPositionFromIndex(x, j, 0.5);
+                real d = 0;
+                for ( int k = 0; k < DIM; ++k )
+                    d += ( x[k] - w[k] ) * ( x[k] - w[k] );
+                if ( d < dis )
+                {
+                    dis = d;
+                    dst_[i] = j;
+                }
+            }
+        }
+        if ( dis == INFINITY )
+            throw InvalidParameter("reservoir_step is too large compared to the Space");
+    }
+
+    /*
+     The probability to hop from `i` to `j` is scaled by min(V_i, V_j) / V_i,
+     such that V_i * P(i->j) = V_j * P(j->i), and a uniform concentration is
+     stationary. Voxels outside the Space are never entered.
+     */
+    const real rate = diff * time_step / ( step * step );
+    sub_ = (unsigned)ceil( 4 * DIM * rate );
+    if ( sub_ > 16 )
+        Cytosim::warn << "reservoir_step is small compared to the diffusion length: " << sub_ << " sub-steps are needed\n";
+    const real hop = ( sub_ > 0 ) ? rate / sub_ : 0;
+
+    hop_.resize(2*DIM*nbc);
+    nab_.resize(2*DIM*nbc);
+
+    for ( index_t i = 0; i < nbc; ++i )
+    {
+        int coord[3] = { 0, 0, 0 };
+        grid_.setCoordinatesFromIndex(coord, i);
+        real cum = 0;
+        for ( int k = 0; k < 2*DIM; ++k )
+        {
+            const int d = k / 2;
+            int c[3] = { coord[0], coord[1], coord[2] };
+            c[d] += ( k & 1 ) ? 1 : -1;
+            index_t j = i;
+            real p = 0;
+            if ( 0 <= c[d] && c[d] < (int)grid_.breadth(d) )
+            {
+                j = grid_.pack(c);
+                if ( vol_[i] > 0 && vol_[j] > 0 )
+                    p = hop * std::min(real(1), vol_[j] / vol_[i]);
+            }
+            cum += p;
+            hop_[2*DIM*i+k] = cum;
+            nab_[2*DIM*i+k] = j;
+        }
+    }
+
+    Cytosim::log("Reservoir set with %lu cells of size %.3f um and %u diffusion sub-steps\n", nbc, step, sub_);
+}
+
+
+size_t Reservoir::count() const
+{
+    size_t res = 0;
+    for ( Pool const& p : pools_ )
+        res += p.size();
+    return res;
+}
+
+
+void Reservoir::add(Object * obj, Vector const& pos)
+{
+    assert_true( pools_.size() == grid_.nbCells() );
+    pools_[dst_[grid_.index(pos)]].push_back(obj);
+}
+
+
+/**
+ Each object leaves its voxel with the probability given by `hop_`.
+ The objects that move are collected first, and then distributed,
+ such that an object cannot hop twice in the same sub-step.
+ */
+void Reservoir::diffuse()
+{
+    const index_t nbc = pools_.size();
+
+    for ( unsigned s = 0; s < sub_; ++s )
+    {
+        for ( index_t i = 0; i < nbc; ++i )
+        {
+            Pool & pool = pools_[i];
+            real const* cum = hop_.data() + 2*DIM*i;
+            const real all = cum[2*DIM-1];
+            if ( pool.empty() || all <= 0 )
+                continue;
+
+            size_t n = pool.size();
+            while ( n-- > 0 )
+            {
+                const real u = RNG.preal();
+                if ( u < all )
+                {
+                    int k = 0;
+                    while ( cum[k] <= u )
+                        ++k;
+                    moves_.push_back(pool[n]);
+                    dests_.push_back(nab_[2*DIM*i+k]);
+                    pool[n] = pool.back();
+                    pool.pop_back();
+                }
+            }
+        }
+
+        for ( size_t n = 0; n < moves_.size(); ++n )
+            pools_[dests_[n]].push_back(moves_[n]);
+
+        moves_.clear();
+        dests_.clear();
+    }
+}
+
+
+/**
+ Uses rejection sampling within the voxel, and falls back to projecting
+ on the edge of the Space if that fails.
+ */
+Vector Reservoir::randomPosition(index_t i) const
+{
+    real w[3] = { 0, 0, 0 };
+    grid_.setPositionFromIndex(w, i, 0);
+    Vector pos;
+    for ( int n = 0; n < 1024; ++n )
+    {
+        real x[3] = { 0, 0, 0 };
+        for ( int d = 0; d < DIM; ++d )
+            x[d] = w[d] + RNG.preal() * grid_.cellWidth(d);
+        pos = Vector(x);
+        if ( space_->inside(pos) )
+            return pos;
+    }
+    return space_->project(pos);
+}
+
+
+/**
+ The segments of the fibers are assigned to the voxel containing their middle,
+ or to the nearest voxel inside the Space, as done in add().
+ On a segment assigned to voxel `i`, the sites are distributed with exponential
+ spacing of average `factor * volume(i) / pool(i).size()`.
+ This is the equivalent of FiberSet::uniFiberSites() with a local concentration.
+ */
+void Reservoir::fiberSites(FiberSet const& fibers, const real factor,
+                           Array<FiberSite>& loc, Array<index_t>& vox) const
+{
+    loc.clear();
+    vox.clear();
+
+    for ( Fiber * fib = fibers.first(); fib; fib = fib->next() )
+    {
+        const real len = fib->segmentation();
+        const unsigned nbs = fib->nbSegments();
+        for ( unsigned n = 0; n < nbs; ++n )
+        {
+            Vector mid = 0.5 * ( fib->posP(n) + fib->posP(n+1) );
+            index_t i = dst_[grid_.index(mid)];
+            size_t cnt = pools_[i].size();
+            if ( cnt > 0 )
+            {
+                const real spread = factor * vol_[i] / cnt;
+                real abs = spread * RNG.exponential();
+                while ( abs < len )
+                {
+                    loc.push_back(FiberSite(fib, fib->abscissaPoint(n)+abs));
+                    vox.push_back(i);
+                    abs += spread * RNG.exponential();
+                }
+            }
+        }
+    }
+}
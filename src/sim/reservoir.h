@@ -0,0 +1,129 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef RESERVOIR_H
+#define RESERVOIR_H
+
+#include "dim.h"
+#include "vector.h"
+#include "array.h"
+#include "grid_base.h"
+#include "fiber_site.h"
+#include <vector>
+
+class Space;
+class Object;
+class Property;
+class FiberSet;
+
+
+/// Coarse-grained representation of freely diffusing objects
+/**
+ This is used for `fast_diffusion` when `reservoir_step > 0`.
+
+ The Space is covered by a coarse grid of cubic voxels, and the free objects
+ are stored in the voxel containing them, without a position. Each voxel
+ knows the volume that it shares with the Space.
+
+ Diffusion is simulated by random hops between adjacent voxels: with cells of
+ width `h` and a diffusion constant `D`, an object leaves by each face with
+ probability `D * time_step / h^2`. The hopping probabilities are corrected
+ by the inside volumes of the two voxels, such that a uniform concentration
+ is stationary, even if the edge of the Space crosses the voxels.
+ An object added in a voxel that has no volume inside the Space is stored in
+ the nearest voxel that has some, such that it cannot be trapped.
+ The time step is divided into sub-steps if needed to keep these probabilities
+ small. The outer faces of the grid are reflecting.
+
+ fiberSites() generates binding sites on the segments of the fibers, with a
+ density proportional to the concentration of free objects in the voxel
+ containing the middle of each segment.
+ */
+class Reservoir
+{
+public:
+
+    /// list of objects in a voxel
+    typedef std::vector<Object*> Pool;
+
+    /// index of a voxel
+    typedef GridBase<DIM>::index_t index_t;
+
+private:
+
+    /// the class of the objects
+    Property const* prop_;
+
+    /// the grid of voxels
+    GridBase<DIM> grid_;
+
+    /// the Space covered by the grid
+    Space const* space_;
+
+    /// volume of the intersection of each voxel with the Space
+    std::vector<real> vol_;
+
+    /// cumulated hopping probabilities, 2*DIM values per voxel
+    std::vector<real> hop_;
+
+    /// index of neighboring voxels, 2*DIM values per voxel
+    std::vector<index_t> nab_;
+
+    /// voxel receiving the objects located in each voxel, which has a non-zero volume
+    std::vector<index_t> dst_;
+
+    /// the objects in each voxel
+    std::vector<Pool> pools_;
+
+    /// number of sub-steps for diffusion in one time step
+    unsigned sub_;
+
+    /// temporary list of objects in transit
+    std::vector<Object*> moves_;
+
+    /// temporary list of destinations
+    std::vector<index_t> dests_;
+
+    /// Disabled copy constructor
+    Reservoir(Reservoir const&);
+
+    /// Disabled copy assignment
+    Reservoir& operator=(Reservoir const&);
+
+public:
+
+    /// constructor
+    Reservoir(Property const* p) : prop_(p), space_(nullptr), sub_(0) {}
+
+    /// the class of the objects
+    Property const* property() const { return prop_; }
+
+    /// cover `spc` with voxels of size `step`, for objects with diffusion constant `diff`
+    void    setGrid(Space const* spc, real step, real diff, real time_step);
+
+    /// number of voxels
+    size_t  nbCells() const { return pools_.size(); }
+
+    /// volume of voxel `i` that is inside the Space
+    real    volume(index_t i) const { return vol_[i]; }
+
+    /// objects in voxel `i`
+    Pool&   pool(index_t i) { return pools_[i]; }
+
+    /// total number of objects
+    size_t  count() const;
+
+    /// add object to the voxel containing `pos`, or the nearest voxel inside the Space
+    void    add(Object *, Vector const& pos);
+
+    /// move objects between adjacent voxels, to simulate one time step of diffusion
+    void    diffuse();
+
+    /// random position inside voxel `i` and inside the Space
+    Vector  randomPosition(index_t i) const;
+
+    /// set `loc` with sites distributed on the fibers, and `vox` with the voxel of each site
+    void    fiberSites(FiberSet const&, real factor, Array<FiberSite>& loc, Array<index_t>& vox) const;
+};
+
+#endif
+
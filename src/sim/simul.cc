@@ -77,12 +77,19 @@ singles(*this), couples(*this), organizers(*this), events(*this)
     precondCPU[3] = 0;
     precondMethod = 1;
     precondCounter = 0;
+    frameWriter    = nullptr;
+    outputCodec    = nullptr;
+    inputCodec     = nullptr;
     
     prop = new SimulProp("undefined");
 }
 
 Simul::~Simul()
 {
+    // this writes any remaining frame:
+    delete(frameWriter);
+    delete(outputCodec);
+    delete(inputCodec);
     erase();
     delete(pMeca1D);
     delete(prop);
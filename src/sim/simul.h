@@ -32,6 +32,9 @@ const char TRAJECTORY[] = "objects.cmo";
 
 
 /// Simulator class containing all Objects
+class FrameWriter;
+class DeltaCodec;
+
 class Simul
 {
 public:
@@ -64,6 +67,24 @@ private:
     
     /// a copy of the properties as they were stored to file
     mutable std::string properties_saved;
+    
+    /// thread writing the trajectory in the background, if `write_queue > 0`
+    mutable FrameWriter * frameWriter;
+    
+    /// encoder of coordinates for compressed frames, if `compress > 0`
+    mutable DeltaCodec * outputCodec;
+    
+    /// decoder of coordinates for compressed frames
+    DeltaCodec *    inputCodec;
+    
+    /// reset the codec if a frame was lost by the background writer
+    void            forgetLostFrames() const;
+
+    /// write current state in compressed form
+    void            writeCompressed(Outputter&, std::string const& filename, bool append) const;
+    
+    /// read compressed frame, given the header line
+    void            readCompressed(Inputter&, std::istream& header, ObjectSet* subset);
 
 public:
 
@@ -170,6 +191,9 @@ public:
     
     /// call setInteractions(Meca) for all objects (this is called before `solve()`
     void            setAllInteractions(Meca&) const;
+    
+    /// call setInteractions(Meca) for all objects, using the threads of Meca
+    void            setAllInteractionsParallel(Meca&) const;
 
     /// display Meca's links
     void            drawLinks() const;
@@ -212,6 +236,12 @@ private:
     /// initialize the grid for steric interaction (pointGrid)
     void            setStericGrid(Space const*) const;
     
+    /// distribute spheres, solids and fibers on the grid for steric interactions
+    void            fillStericGrid() const;
+    
+    /// add steric interactions for a range of cells of the steric grid
+    void            setStericInteractions(Meca&, size_t start, size_t stop) const;
+
     /// add steric interactions between spheres, solids and fibers to Meca
     void            setStericInteractions(Meca&) const;
     
@@ -315,6 +345,9 @@ public:
     /// write sim-world in binary or text mode, appending to existing file or creating new file
     void      writeObjects(std::string const& filename, bool append, bool binary) const;
     
+    /// wait until all frames passed to writeObjects() have been written to file
+    void      flushObjects() const;
+    
     //----------------------------- REPORTING ----------------------------------
 
     /// call `Simul::report0`, adding lines before and after with 'start' and 'end' tags.
@@ -331,6 +364,9 @@ public:
     
     /// give a summary of the System
     void      reportSystem(std::ostream&) const;
+    
+    /// print statistics of the linear solver for the last time steps
+    void      reportSolver(std::ostream&) const;
 
     /// print the length and the points of each fiber
 
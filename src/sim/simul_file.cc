@@ -4,6 +4,9 @@
 #include <fstream>
 #include <unistd.h>
 #include "filepath.h"
+#include "delta_codec.h"
+#include "frame_index.h"
+#include "frame_writer.h"
 #include "messages.h"
 #include "parser.h"
 #include "print_color.h"
@@ -101,10 +104,53 @@ void Simul::writeObjects(Outputter& out) const
  If this file does not exist, it is created de novo.
  If `append == true` the state is added to the file, otherwise it is cleared.
  If `binary == true` a binary format is used, otherwise a text-format is used.
+ If `compress > 0`, the frame is compressed (see writeCompressed()).
+ The position of the frame is recorded in the index (see FrameIndex).
+ 
+ If `write_queue > 0`, the frame is serialized into memory and passed
+ to a FrameWriter, which writes it to file in the background.
 */
 void Simul::writeObjects(std::string const& name, bool append, bool binary) const
 {
-    Outputter out(name.c_str(), append, binary);
+    const bool compress = ( prop->compress > 0 );
+
+    if ( prop->write_queue > 0 )
+    {
+        forgetLostFrames();
+        char * buf = nullptr;
+        size_t len = 0;
+        FILE * f = open_memstream(&buf, &len);
+        if ( !f )
+            throw InvalidIO("could not allocate memory to serialize frame");
+        try
+        {
+            Outputter mem(f, binary);
+            if ( compress )
+                writeCompressed(mem, name, append);
+            else
+                writeObjects(mem);
+            // the destructor of `mem` closes the stream and finalizes `buf`
+        }
+        catch( InvalidIO & e )
+        {
+            free(buf);
+            std::cerr << "Error writing trajectory file: " << e.what() << '\n';
+            return;
+        }
+        if ( !frameWriter )
+        {
+            frameWriter = new FrameWriter;
+            frameWriter->start(prop->write_queue);
+        }
+        frameWriter->push(name, append, buf, len, prop->time);
+        return;
+    }
+    
+    // frames waiting to be written must be written first:
+    flushObjects();
+    forgetLostFrames();
+
+    Outputter out(name.c_str(), append, binary || compress);
     
     if ( ! out.good() )
         throw InvalidIO("could not open output file `"+name+"' for writing");
@@ -112,8 +158,17 @@ void Simul::writeObjects(std::string const& name, bool append, bool binary) cons
     try
     {
         out.lock();
-        writeObjects(out);
+        // the position is undefined before the first write in append mode:
+        fseeko(out, 0, SEEK_END);
+        long long start = ftello(out);
+        if ( compress )
+            writeCompressed(out, name, append);
+        else
+            writeObjects(out);
+        long long end = ftello(out);
         out.unlock();
+        if ( 0 <= start && start < end )
+            FrameIndex::record(name, start, end, prop->time);
     }
     catch( InvalidIO & e )
     {
@@ -121,6 +176,89 @@ void Simul::writeObjects(std::string const& name, bool append, bool binary) cons
     }
 }
 
+
+/**
+ If a frame written in the background was lost, the next compressed frame
+ cannot refer to it, and it must be a keyframe. Frames that were already
+ queued after the lost frame cannot be decoded, since they refer to it.
+ */
+void Simul::forgetLostFrames() const
+{
+    if ( frameWriter && frameWriter->failed() && outputCodec )
+        outputCodec->clear();
+}
+
+
+/**
+ This writes the current state in compressed form.
+ The frame is serialized into memory in binary format, with the coordinates
+ of the Mecables rounded and stored as differences with the previous frame
+ by a DeltaCodec, and the result is compressed with `deflate`.
+ The compressed data is enclosed by the usual lines starting and ending a frame,
+ and preceded by the time, and by a line with the information needed to decode it:
+
+     #compressed DISTANCE PRECISION SIZE COMPRESSED_SIZE
+
+ where DISTANCE is the number of frames since the last keyframe.
+ A keyframe is written every `compress[1]` frames, or if the previous frame
+ was not written to the same file.
+ */
+void Simul::writeCompressed(Outputter& out, std::string const& name, bool append) const
+{
+    if ( !outputCodec )
+        outputCodec = new DeltaCodec;
+    DeltaCodec * codec = outputCodec;
+
+    size_t dis = 0;
+    if ( append && codec->valid() && codec->name() == name && codec->quantum() == prop->compress )
+        dis = ( codec->distance() + 1 ) % std::max(1U, prop->keyframe);
+
+    // if anything fails below, the codec remains invalid and the next frame is a keyframe
+    codec->begin(dis, prop->compress);
+    codec->name(name);
+
+    char * buf = nullptr;
+    size_t len = 0;
+    FILE * f = open_memstream(&buf, &len);
+    if ( !f )
+        throw InvalidIO("could not allocate memory to serialize frame");
+    
+    std::vector<unsigned char> zip;
+    try
+    {
+        {
+            Outputter mem(f, true);
+            mem.codec(codec);
+            writeObjects(mem);
+        }
+        DeltaCodec::compress(zip, buf, len);
+    }
+    catch( Exception & )
+    {
+        free(buf);
+        throw;
+    }
+    free(buf);
+
+    fprintf(out, "\n\n#Cytosim  %i  %s", getpid(), TicToc::date());
+    fprintf(out, "\n#time %.6f sec", prop->time);
+    fprintf(out, "\n#compressed %lu %.12g %lu %lu\n", (unsigned long)dis,
+            prop->compress, (unsigned long)len, (unsigned long)zip.size());
+    if ( zip.size() != fwrite(zip.data(), 1, zip.size(), out) )
+        throw InvalidIO("failed to write compressed frame");
+    out.put_line("\n#end cytosim");
+    fprintf(out, " %s\n\n", TicToc::date());
+    
+    codec->end();
+}
+
+
+void Simul::flushObjects() const
+{
+    if ( frameWriter )
+        frameWriter->flush();
+}
+
 //------------------------------------------------------------------------------
 #pragma mark - Read Objects
 
@@ -402,11 +540,48 @@ int Simul::loadObjects(Inputter& in, ObjectSet* subset)
 }
 
 
+/**
+ This reads a frame written by writeCompressed(), after its line `#compressed`.
+ A frame that is not a keyframe can only be decoded if the frame preceding it
+ was the last frame read by this Simul, and if all its objects were loaded.
+ */
+void Simul::readCompressed(Inputter& in, std::istream& header, ObjectSet* subset)
+{
+    unsigned long dis = 0, len = 0, zlen = 0;
+    real quantum = 0;
+    if ( !( header >> dis >> quantum >> len >> zlen ) )
+        throw InvalidIO("invalid header of compressed frame");
+    
+    std::vector<char> zip(zlen), raw;
+    if ( zlen != fread(zip.data(), 1, zlen, in.file()) )
+        throw InvalidIO("unexpected end of file in compressed frame");
+    DeltaCodec::uncompress(raw, len, zip.data(), zlen);
+    
+    if ( !inputCodec )
+        inputCodec = new DeltaCodec;
+    inputCodec->begin(dis, quantum);
+    
+    FILE * f = fmemopen(raw.data(), raw.size(), "rb");
+    if ( !f )
+        throw InvalidIO("could not open compressed frame");
+    
+    Inputter sub(DIM, f);
+    sub.codec(inputCodec);
+    int res = readObjects(sub, subset);
+    if ( res == 1 || res == 2 )
+        throw InvalidIO("incomplete compressed frame");
+    // if objects were skipped, the codec is left invalid until the next keyframe:
+    if ( res == 0 )
+        inputCodec->end();
+}
+
+
 /**
  Create an Inputter 'in' and call 'loadObjects(in)'
  */
 int Simul::loadObjects(char const* filename)
 {
+    flushObjects();
     Inputter in(DIM, filename, true);
 
     if ( ! in.good() )
@@ -428,6 +603,7 @@ int Simul::loadObjects(char const* filename)
  - 0 : success
  - 1 : EOF
  - 2 : the file does not appear to be a valid cytosim archive
+ - 3 : a compressed frame was read, but some objects could not be loaded
  
   */
 int Simul::readObjects(Inputter& in, ObjectSet* subset)
@@ -435,6 +611,7 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
     ObjectSet * objset = nullptr;
     std::string section, line;
     int has_frame = 0;
+    int skipped = 0;
     int tag = 0, c = 0;
     int fat = 0;
 
@@ -513,6 +690,11 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
                 //if ( f != currentFormatID )
                 //    std::clog << "Cytosim is reading data format "<<f<<"\n";
             }
+            // compressed frame "#compressed 0 0.0001 1234567 123456"
+            else if ( tok == "compressed" )
+            {
+                readCompressed(in, iss, subset);
+            }
             // time data "#time 1.2345"
             else if ( tok == "time" )
             {
@@ -547,10 +729,10 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
             {
                 iss >> tok;
                 if ( tok == "cytosim" )
-                    return 0;
+                    return skipped;
 #ifdef BACKWARD_COMPATIBILITY
                 if ( tok == "frame" )
-                    return 0;
+                    return skipped;
 #endif
             }
         }
@@ -613,6 +795,9 @@ int Simul::readObjects(Inputter& in, ObjectSet* subset)
             }
             catch( Exception & e )
             {
+                // the coordinates of a compressed frame would be an incomplete reference:
+                if ( in.codec() )
+                    skipped = 3;
                 if ( section.size() )
                 {
                     std::cerr << "Error in section " << section << ": " << e.what() << std::endl;
@@ -25,16 +25,29 @@ void SimulProp::clear()
     tolerance         = 0.05;
     acceptable_prob   = 0.5;
     precondition      = 1;
+    precondition_drift = 0.01;
+    solver            = SOLVER_BCGS;
+    solver_dim        = 4;
+    warm_start        = 0;
+    threads           = 1;
+    matrix_format     = 0;
+    mixed_precision   = 0;
     random_seed       = 0;
     steric            = 0;
     
-    steric_stiffness_push[0] = 100;
-    steric_stiffness_pull[0] = 100;
-    steric_stiffness_push[1] = 100;
-    steric_stiffness_pull[1] = 100;
+    for ( unsigned p = 0; p < STERIC_MAX_PANES; ++p )
+    {
+        steric_stiffness_push[p] = 100;
+        steric_stiffness_pull[p] = 100;
+        steric_pairs[p] = 1U << p;
+    }
 
     steric_max_range  = -1;
     binding_grid_step = -1;
+    binding_grid_skin = 0;
+    binding_grid_layout = 0;
+    detach_queue      = false;
+    batch_couples     = false;
     
     verbose           = 0;
 
@@ -43,6 +56,9 @@ void SimulProp::clear()
     trajectory_file   = TRAJECTORY;
     clear_trajectory  = true;
     skip_free_couple  = false;
+    write_queue       = 0;
+    compress          = 0;
+    keyframe          = 16;
     
     display           = "";
     display_fresh     = false;
@@ -74,15 +90,31 @@ void SimulProp::read(Glossary& glos)
     glos.set(tolerance,         "tolerance");
     glos.set(acceptable_prob,   "acceptable_prob");
     glos.set(precondition,      "precondition");
+    glos.set(precondition_drift, "precondition_drift");
+    glos.set(solver,            "solver", {{"bicgstab", SOLVER_BCGS}, {"idrs", SOLVER_IDRS}, {"pipelined", SOLVER_PBCGS}});
+    glos.set(solver_dim,        "solver", 1);
+    glos.set(warm_start,        "warm_start");
+    glos.set(threads,           "threads");
+    glos.set(matrix_format,     "matrix_format");
+    glos.set(mixed_precision,   "mixed_precision");
     
-    glos.set(steric,                   "steric", {{"off", 0}, {"on", 1}});
+    // accept the number of panes, or `off` and `on`:
+    if ( glos.is_positive_integer("steric", 0) )
+        glos.set(steric,               "steric");
+    else
+        glos.set(steric,               "steric", {{"off", 0}, {"on", 1}});
     glos.set(steric_stiffness_push[0], "steric", 1);
     glos.set(steric_stiffness_pull[0], "steric", 2);
-    glos.set(steric_stiffness_push, 2, "steric_stiffness_push");
-    glos.set(steric_stiffness_pull, 2, "steric_stiffness_pull");
+    glos.set(steric_stiffness_push, STERIC_MAX_PANES, "steric_stiffness_push");
+    glos.set(steric_stiffness_pull, STERIC_MAX_PANES, "steric_stiffness_pull");
+    glos.set(steric_pairs, STERIC_MAX_PANES, "steric_pairs");
     glos.set(steric_max_range,         "steric_max_range");
 
     glos.set(binding_grid_step, "binding_grid_step");
+    glos.set(binding_grid_skin, "binding_grid_skin");
+    glos.set(binding_grid_layout, "binding_grid_layout");
+    glos.set(detach_queue,      "detach_queue");
+    glos.set(batch_couples,     "batch_couples");
     
     // these parameters are not written:
     glos.set(verbose,           "verbose");
@@ -108,6 +140,9 @@ void SimulProp::read(Glossary& glos)
 
     glos.set(clear_trajectory,  "clear_trajectory");
     glos.set(skip_free_couple,  "skip_free_couple");
+    glos.set(write_queue,       "write_queue");
+    glos.set(compress,          "compress");
+    glos.set(keyframe,          "compress", 1);
     glos.set(random_seed,       "random_seed");
     
     if ( glos.set(display, "display") )
@@ -143,6 +178,38 @@ void SimulProp::complete(Simul const& sim)
         
         if ( kT == 0 && tolerance > 0.01 )
             throw InvalidParameter("if simul:kT==0, simul:tolerance must be set small");
+        
+        if ( solver_dim < 1 || solver_dim > 8 )
+            throw InvalidParameter("simul:solver[1] must be in [1, 8]");
+        
+        if ( matrix_format > 1 )
+            throw InvalidParameter("simul:matrix_format must be 0 or 1");
+        
+        if ( mixed_precision > 1 )
+            throw InvalidParameter("simul:mixed_precision must be 0 or 1");
+        
+        if ( binding_grid_skin < 0 )
+            throw InvalidParameter("simul:binding_grid_skin must be >= 0");
+        
+        if ( binding_grid_layout > 1 )
+            throw InvalidParameter("simul:binding_grid_layout must be 0 or 1");
+        
+        if ( compress < 0 )
+            throw InvalidParameter("simul:compress must be >= 0");
+        
+        if ( keyframe < 1 )
+            throw InvalidParameter("simul:compress[1] must be >= 1");
+        
+        if ( steric < 0 || steric > STERIC_MAX_PANES )
+            throw InvalidParameter("simul:steric must be in [0, ", STERIC_MAX_PANES, "]");
+        
+        // make the interactions between panes symmetric:
+        for ( int p = 0; p < steric; ++p )
+        for ( int q = 0; q < steric; ++q )
+        {
+            if ( steric_pairs[p] & ( 1U << q ) )
+                steric_pairs[q] |= 1U << p;
+        }
     }
     /*
      If the Global parameters have changed, we update all derived parameters.
@@ -167,11 +234,27 @@ void SimulProp::write_values(std::ostream& os) const
     write_value(os, "tolerance",       tolerance);
     write_value(os, "acceptable_prob", acceptable_prob);
     write_value(os, "precondition",    precondition);
+    write_value(os, "precondition_drift", precondition_drift);
+    write_value(os, "solver",          solver, solver_dim);
+    write_value(os, "warm_start",      warm_start);
+    write_value(os, "threads",         threads);
+    write_value(os, "matrix_format",   matrix_format);
+    write_value(os, "mixed_precision", mixed_precision);
     write_value(os, "random_seed",     random_seed);
     std::endl(os);
     write_value(os, "steric", steric, steric_stiffness_push[0], steric_stiffness_pull[0]);
+    if ( steric > 1 )
+    {
+        write_value(os, "steric_stiffness_push", steric_stiffness_push, steric);
+        write_value(os, "steric_stiffness_pull", steric_stiffness_pull, steric);
+        write_value(os, "steric_pairs", steric_pairs, steric);
+    }
     write_value(os, "steric_max_range",  steric_max_range);
     write_value(os, "binding_grid_step", binding_grid_step);
+    write_value(os, "binding_grid_skin", binding_grid_skin);
+    write_value(os, "binding_grid_layout", binding_grid_layout);
+    write_value(os, "detach_queue", detach_queue);
+    write_value(os, "batch_couples", batch_couples);
     write_value(os, "verbose", verbose);
     std::endl(os);
     write_value(os, "display", "("+display+")");
@@ -18,6 +18,18 @@ class Space;
  */
 #define NEW_CYTOPLASMIC_FLOW 0
 
+/// maximum number of panes in the steric engine
+#define STERIC_MAX_PANES 8
+
+
+/// iterative methods that can be used to solve the system of equations
+enum SolverMethod
+{
+    SOLVER_BCGS = 0,   ///< BiConjugate Gradient Stabilized
+    SOLVER_IDRS = 1,   ///< Induced Dimension Reduction IDR(s)
+    SOLVER_PBCGS = 2   ///< pipelined BiConjugate Gradient Stabilized
+};
+
 /**
  @defgroup Parameters All object parameters
  List of parameters for user-accessible objects.
@@ -168,8 +180,15 @@ public:
      to try the different accepted values of `precondition`:
      - 0 : do not use preconditionning
      - 1 : use a block preconditionner
+     - 2 : use a block preconditionner, keeping blocks over multiple time steps
+     - 3 : use a block preconditionner, with band matrices for Fibers
      .
      
+     With `precondition = 2`, the block of a Mecable is only recalculated if
+     the Mecable has changed significantly since the last calculation: if any
+     vertex has moved by more than `precondition_drift`, if the number of
+     vertices has changed, or if the number of attached Hands has changed.
+     
      With `precondition = 1`, Cytosim calculates a matrix (the preconditionner)
      that is approximately equal to the inverse of the matrix that characterize the
      dynamical system. Using this preconditionner can reduce the number of iterations
@@ -180,21 +199,164 @@ public:
      In some cases, using `precondition=1` can degrade preformance, 
      in particular if some objects have many vertices.
      
+     With `precondition = 3`, the block of a Fiber is represented by a band matrix,
+     which includes the Lagrange multipliers of the length constraints, such that
+     it can be factorized and applied at a cost linear in the number of vertices.
+     This neglects interactions between distant vertices of the same fiber, and is
+     recommended for fibers with many vertices. Other objects use dense blocks.
+     
      If there is only one filament in the system, `precondition=0` should perform best.
      With many filaments, trying `precondition = [0, 1]' is the recommended strategy.
      <em>default value = 0</em>
      */
     int       precondition;
+    
+    
+    /// Displacement of a vertex that triggers the recalculation of a preconditionner block
+    /**
+     This is only used if `precondition = 2`.
+     A smaller value updates the preconditionner more often, which is more costly,
+     but keeps it closer to the inverse of the current matrix, such that the number
+     of iterations needed by the solver remains small.
+     <em>default value = 0.01</em>
+     */
+    real      precondition_drift;
+    
+    
+    /// Iterative method used to solve the system of equations
+    /**
+     - 0 or `bicgstab` : BiConjugate Gradient Stabilized
+     - 1 or `idrs` : Induced Dimension Reduction IDR(s)
+     - 2 or `pipelined` : BiConjugate Gradient Stabilized, with fused vector operations
+     .
+     IDR(s) stores `3 * s + 3` vectors, where `s` is given as second value,
+     for example `solver = idrs, 4`, and it may need fewer iterations than
+     BiCGStab, since the matrix of the system is not symmetric.
+     The pipelined method performs the same number of iterations as BiCGStab,
+     but reads the vectors fewer times in each iteration.
+     If the method fails, Meca::solve() will try the others before giving up.
+     <em>default value = bicgstab, 4</em>
+     */
+    unsigned  solver;
+    
+    /// dimension of the shadow space in IDR(s), second value of `solver`
+    unsigned  solver_dim;
+
+    
+    /// A flag to use the solution of the previous step as initial guess for the solver
+    /**
+     The system is solved iteratively for the displacement of the vertices during
+     one time step. If the objects move smoothly, the displacement calculated at
+     the previous step is a better initial guess than zero, and the solver may
+     then converge in fewer iterations. With this option, Mecables are ordered
+     by identity, such that their position in the system is stable over time.
+
+     - 0 : start from zero
+     - 1 : start from the previous solution
+     - 2 : start from the previous solution, and also solve from zero to report the number of iterations saved
+     .
+     
+     This is most useful with small Brownian motion, since the random component of
+     the displacement is not correlated between consecutive steps.
+     <em>default value = 0</em>
+     */
+    unsigned  warm_start;
+    
+    
+    /// Number of threads used to solve the system of equations
+    /**
+     The calculations done in Meca for each Mecable (Fiber, Solid, Sphere, Bead)
+     are distributed over a pool of threads that persists during the simulation.
+     Mecables are assigned to threads in proportion to their number of vertices,
+     and idle threads steal work from busy ones to keep the load balanced.
+     The interactions (Couple, Single, Organizer, confinement) are also set in parallel,
+     each thread recording into its own matrices, which are then added together.
+     
+     - 1 : run everything in the main thread
+     - N : use N threads, including the main thread
+     - 0 : use as many threads as there are processors on the machine
+     .
+     Since a thread is only useful if it can run on a dedicated core, `threads`
+     should not exceed the number of cores available to the job.
+     <em>default value = 1</em>
+     */
+    unsigned  threads;
+    
+    
+    /// Storage format used to multiply the isotropic part of the matrix
+    /**
+     - 0 : compressed columns, with symmetric storage (MatrixSparseSymmetric1)
+     - 1 : Sliced ELLPACK SELL-C-sigma, with both halves stored (MatrixSparseSELL)
+     .
+     With format 1, the rows of the matrix are processed independently by groups
+     of 4 using SIMD instructions, and the multiplication is distributed over
+     `threads`. This uses twice more memory than format 0.
+     <em>default value = 0</em>
+     */
+    unsigned  matrix_format;
+    
+    
+    /// Precision used to store the matrices of the linear system
+    /**
+     - 0 : double precision
+     - 1 : single precision (mixed precision)
+     .
+     With `mixed_precision = 1`, copies of the sparse matrices are made in
+     single precision, and used during the iterations of the solver, while the
+     vectors and the sums of products remain in double precision. The matrix
+     of isotropic terms is then stored in the SELL format (see `matrix_format`).
+     Similarly, the dense blocks of the preconditionner are factorized in double
+     precision, but stored in single precision (`precondition = 1` and `2`).
+     This halves the memory read for these matrices at each iteration.
+     After convergence, the residual is calculated with the matrices in double
+     precision, and the solution is corrected if this residual is too large,
+     such that the accuracy is still controlled by `tolerance`.
+     The rigidity of the Mecables is always applied in double precision.
+     <em>default value = 0</em>
+     */
+    unsigned  mixed_precision;
 
     
-    /// A flag to control the engine that implement steric interactions between objects
+    /// Number of panes of the engine that implements steric interactions between objects
+    /**
+     With `steric = 0`, steric interactions are disabled.
+     Otherwise, objects are placed in the pane specified by their own `steric`
+     parameter, which should be in [1, `steric`]. If there is only one pane,
+     all objects with `steric > 0` are placed in it. Objects only interact
+     with objects of the same pane, or of a pane listed in `steric_pairs`.
+     At most STERIC_MAX_PANES = 8 panes can be used.
+     
+     Syntax:
+     
+         steric = NB_PANES, STIFFNESS_PUSH, STIFFNESS_PULL
+     
+     where the stiffness values apply to the first pane.
+     */
     int       steric;
     
-    /// Stiffness for repulsive steric interaction
-    real      steric_stiffness_push[2];
+    /// Stiffness for repulsive steric interaction, for each pane
+    /**
+     Interactions between different panes use the stiffness of the pane of lowest index.
+     */
+    real      steric_stiffness_push[STERIC_MAX_PANES];
+    
+    /// Stiffness for attractive steric interaction, for each pane
+    real      steric_stiffness_pull[STERIC_MAX_PANES];
     
-    /// Stiffness for attractive steric interaction
-    real      steric_stiffness_pull[2];
+    /// Panes that interact with each pane, as a bit-field
+    /**
+     `steric_pairs[p-1]` is a bit-field, in which bit `q-1` indicates that
+     objects in pane `p` interact with objects in pane `q`.
+     The relationship is made symmetric: if `p` interacts with `q`,
+     then `q` interacts with `p`. For example, with 2 panes,
+     
+         steric_pairs = 3, 0
+     
+     specifies that pane 1 interacts with itself and with pane 2, while objects
+     within pane 2 do not interact with each other.
+     <em>default value = each pane only interacts with itself</em>
+     */
+    unsigned  steric_pairs[STERIC_MAX_PANES];
     
     /// Lattice size used to determine steric interactions
     /**
@@ -236,6 +398,62 @@ public:
      */
     real      binding_grid_step;
     
+    /// Margin added to the binding range, to avoid recalculating the grid at every step
+    /**
+     If `binding_grid_skin > 0`, the segments of the Fibers are associated with the
+     cells of the grid using a distance extended by `binding_grid_skin`, and this
+     is only recalculated once a vertex has moved by `binding_grid_skin` or more,
+     or if Fibers were created, deleted, or their number of vertices changed.
+     The results are statistically unchanged, but the grid contains more segments,
+     such that attachment is slower, while less time is spent painting the grid.
+     A value comparable to the displacement of the Fibers over a few time steps
+     is usually adequate. With `binding_grid_skin = 0` (default), the grid is
+     recalculated at every step.
+     */
+    real      binding_grid_skin;
+    
+    /// Memory layout of the grid used to determine the attachment of Hand to Fiber
+    /**
+     Possible values:
+     - 0 : each cell of the grid has its own list of segments (default),
+     - 1 : all segments are stored in a single array, and each cell refers to a
+           contiguous range of this array. This array is rebuilt by counting sort
+           every time the grid is painted.
+     .
+     The two layouts give statistically equivalent results, but the random numbers
+     are not used in the same way, and simulations will differ in their details.
+     */
+    unsigned  binding_grid_layout;
+    
+    /// Flag to detach Hands of Couples from a queue of precomputed detachment times
+    /**
+     A plain Hand (activity = bind) with `unbinding_force = inf` detaches with a
+     constant rate. Its time of detachment can then be calculated at attachment.
+     If `detach_queue = 1`, these times are kept in a priority queue in CoupleSet,
+     and the Hands are only visited when their time has come.
+     This applies to Couples for which both Hands fulfill this condition,
+     and that do not have specialized functions, i.e. not `duo` or `slide`.
+     A bridging Couple of this type is then not visited at all during step().
+     Hands with load-dependent detachment are processed at every time step as usual.
+     The results are statistically equivalent, but simulations will differ in their
+     details, because the order of the events is not the same.
+     <em>default value = 0</em>
+     */
+    bool      detach_queue;
+    
+    /// Flag to step the Couples in batches of identical class
+    /**
+     If `batch_couples = 1`, the Couples that are attached are also stored in
+     arrays, separately for each class of Couple, and each array is processed
+     by a function specialized for the classes of its Hands.
+     This avoids the virtual function calls for the most common Hands
+     (activity = bind or move), and the Couples can be prefetched from memory.
+     The results are statistically equivalent, but the Couples are processed
+     in a different order, and simulations will differ in their details.
+     <em>default value = 0</em>
+     */
+    bool      batch_couples;
+    
     /// level of verbosity
     int           verbose;
 
@@ -254,6 +472,37 @@ public:
     /// If `true` free couples are not saved/read to/from file (<em>default = false</em>)
     bool          skip_free_couple;
     
+    /// Number of frames that can be waiting to be written by a background thread
+    /**
+     If `write_queue > 0`, each frame is serialized into memory, and written to the
+     trajectory file by a separate thread, while the simulation continues.
+     The simulation is paused if `write_queue` frames are already waiting to be written.
+     This can help if writing to the file is slow, for example on a network file system,
+     at the cost of keeping up to `write_queue` frames in memory.
+     With `write_queue = 0`, frames are written directly (<em>default = 0</em>).
+     */
+    unsigned      write_queue;
+    
+    /// Precision of coordinates in a compressed trajectory file
+    /**
+     If `compress > 0`, each frame is written in binary format and compressed:
+     the coordinates of the points of Fibers, Solids, Beads and Spheres, and the
+     positions of Singles and of free Couples are rounded to a multiple of `compress`,
+     and stored as differences with the previous frame, before the whole frame
+     is compressed with `deflate`.
+     Other values are stored as in the binary format.
+     Use `compress = 0` to write uncompressed frames (<em>default = 0</em>).
+     
+     The second value `compress[1]` is the interval between keyframes, which are frames
+     encoded without reference to the preceding ones (<em>default = 16</em>).
+     To access a frame, the preceding keyframe and all the intermediate frames must be read.
+     The tool `sieve` can convert between compressed and uncompressed trajectory files.
+     */
+    real          compress;
+    
+    /// Interval between keyframes in a compressed trajectory file (see `compress`)
+    unsigned      keyframe;
+    
     /// Display parameters (see @ref DisplayPar)
     std::string   display;
 
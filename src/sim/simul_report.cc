@@ -117,6 +117,7 @@ void Simul::report(std::ostream& out, std::string arg, Glossary& opt) const
  `field`         | Total quantity of substance in field and Lattices
  `time`          | Time
  `inventory`     | summary list of objects
+ `solver`        | Statistics of the linear solver for the last time steps
  `property`      | All object properties
  `parameter`     | All object properties
  
@@ -347,6 +348,12 @@ void Simul::report0(std::ostream& out, std::string const& arg, Glossary& opt) co
     {
         return reportSystem(out);
     }
+    if ( who == "solver" )
+    {
+        if ( what.empty() )
+            return reportSolver(out);
+        throw InvalidSyntax("I only know `solver'");
+    }
     if ( who == "property" || who == "parameter" )
     {
         if ( what.empty() )
@@ -1272,6 +1279,39 @@ void Simul::reportSystem(std::ostream& out) const
 }
 
 
+/**
+ Export statistics recorded by Meca::solve() for the last MECA_HISTORY calls,
+ in chronological order. The times are wall-clock durations in milliseconds:
+ - `prepare` is spent in Meca::prepare(),
+ - `assembly` is spent setting the interactions,
+ - `precond` is spent computing the preconditionner,
+ - `krylov` is spent in the iterative solvers, including any fallback.
+ .
+ `count` is the number of matrix-vector products of the last solver called,
+ and `fallback` the number of alternative methods that were tried.
+ The statistics are only available in the program that solved the system,
+ and not if the state was read from a trajectory file.
+ */
+void Simul::reportSolver(std::ostream& out) const
+{
+    out << COM << "time" << SEP << "size" << SEP << "nnz_B" << SEP << "nnz_C";
+    out << SEP << "method" << SEP << "count" << SEP << "residual" << SEP << "fallback";
+    out << SEP << "prepare" << SEP << "assembly" << SEP << "precond" << SEP << "krylov";
+    
+    for ( size_t i = 0; i < sMeca.nbStatistics(); ++i )
+    {
+        MecaStatistics const& S = sMeca.statistics(i);
+        out << LIN << std::fixed << std::setprecision(4) << S.time;
+        out << SEP << S.size << SEP << S.nnzB << SEP << S.nnzC;
+        out << SEP << S.precond << SEP << S.count;
+        out << SEP << std::scientific << std::setprecision(2) << S.residual;
+        out << SEP << S.fallback << std::fixed << std::setprecision(3);
+        out << SEP << S.prepare << SEP << S.assembly;
+        out << SEP << S.precondition << SEP << S.krylov;
+    }
+}
+
+
 /**
  Export position of all organizers
  */
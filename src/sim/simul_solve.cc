@@ -93,32 +93,26 @@ void Simul::setStericGrid(Space const* spc) const
         Cytosim::log("adjusting simul:steric_max_range = %.3f\n", res);
         prop->steric_max_range = res;
     }
-    pointGrid.createCells();
+    pointGrid.createCells(std::max(1, prop->steric));
 }
 
 
 /**
- The prop->steric of each object is a bit-field that
- specify one or more 'pane' where the object is present.
- The different panes are then treated consecutively and independently, 
- and only objects in the same pane may interact.
+ The number of 'panes' is set by `simul:steric`, and the prop->steric of each
+ object indicates the pane in which it is placed, in [1, simul:steric].
+ Each pane has its own cells in the grid, and objects from two panes interact
+ only if the corresponding bit is set in `simul:steric_pairs`:
  
-     for ( int pane=1; pane<=2 && pane<=prop->steric; ++pane )
-     {
-         if ( obj->prop->steric & pane )
-         ...
-     }
+     steric_pairs[p-1] & ( 1 << (q-1) )
  
  With this mechanism, the user can flexibly configure which objects
  may see each other and thus control the steric interactions.
- 
- At present, we only support 1 pane (Simul property steric).
- This can be extended if necessary, but the steric_stiffness[]
- properties should be extended as well.
+ With a single pane, all objects with steric enabled are in the same pane.
  */
-void Simul::setStericInteractions(Meca& meca) const
+void Simul::fillStericGrid() const
 {
-    if ( !pointGrid.hasGrid() )
+    const unsigned nbp = std::max(1, prop->steric);
+    if ( !pointGrid.hasGrid() || pointGrid.nbPanes() != nbp )
     {
         if (!spaces.master())
             return;
@@ -138,11 +132,7 @@ void Simul::setStericInteractions(Meca& meca) const
         
             // include segments, in the cell associated with their center
             for ( unsigned r = 0; r < fib->nbSegments(); ++r )
-#if ( NB_STERIC_PANES == 1 )
-                pointGrid.add(FiberSegment(fib, r), rad, ran);
-#else
                 pointGrid.add(fib->prop->steric, FiberSegment(fib, r), rad, ran);
-#endif
         }
     }
     
@@ -150,22 +140,14 @@ void Simul::setStericInteractions(Meca& meca) const
     for ( Sphere* sp=spheres.first(); sp; sp=sp->next() )
     {
         if ( sp->prop->steric )
-#if ( NB_STERIC_PANES == 1 )
-            pointGrid.add(Mecapoint(sp, 0), sp->radius(), sp->radius()+sp->prop->steric_range);
-#else
             pointGrid.add(sp->prop->steric, Mecapoint(sp, 0), sp->radius(), sp->radius()+sp->prop->steric_range);
-#endif
     }
     
     // include Beads
     for ( Bead* bd=beads.first(); bd; bd=bd->next() )
     {
         if ( bd->prop->steric )
-#if ( NB_STERIC_PANES == 1 )
-            pointGrid.add(Mecapoint(bd, 0), bd->radius(), bd->radius()+bd->prop->steric_range);
-#else
             pointGrid.add(bd->prop->steric, Mecapoint(bd, 0), bd->radius(), bd->radius()+bd->prop->steric_range);
-#endif
     }
         
     // include Points that have a radius from Solids
@@ -176,37 +158,134 @@ void Simul::setStericInteractions(Meca& meca) const
             for ( unsigned i = 0; i < so->nbPoints(); ++i )
             {
                 if ( so->radius(i) > REAL_EPSILON )
-#if ( NB_STERIC_PANES == 1 )
-                    pointGrid.add(Mecapoint(so, i), so->radius(i), so->radius(i)+so->prop->steric_range);
-#else
                     pointGrid.add(so->prop->steric, Mecapoint(so, i), so->radius(i), so->radius(i)+so->prop->steric_range);
-#endif
             }
         }
     }
-    
-    /// create parameters
-    PointGridParam pam(prop->steric_stiffness_push[0], prop->steric_stiffness_pull[0]);
-    
-#if ( NB_STERIC_PANES == 1 )
-    
-    pointGrid.setInteractions(meca, pam);
+}
 
-#elif ( NB_STERIC_PANES == 2 )
-    
-    // add steric interactions inside pane 1:
-    pointGrid.setInteractions(meca, pam, 1);
-    // add steric interactions between panes 1 and 2:
-    pointGrid.setInteractions(meca, pam, 1, 2);
-    //pointGrid.setInteractions(meca, pam, 2, 1);
 
-#else
-    
-    // add steric interactions between different panes:
-    for ( unsigned p = 1; p <= NB_STERIC_PANES; ++p )
-        pointGrid.setInteractions(meca, pam, p);
+/**
+ Add steric interactions for the cells of pointGrid in [start, stop[,
+ which must have been filled by fillStericGrid()
+ */
+void Simul::setStericInteractions(Meca& meca, size_t start, size_t stop) const
+{
+    const unsigned nbp = pointGrid.nbPanes();
+    real const* push = prop->steric_stiffness_push;
+    real const* pull = prop->steric_stiffness_pull;
 
-#endif
+    for ( unsigned a = 1; a <= nbp; ++a )
+    {
+        PointGridParam pam(push[a-1], pull[a-1]);
+        // add steric interactions inside pane `a`:
+        if ( prop->steric_pairs[a-1] & ( 1U << (a-1) ) )
+            pointGrid.setInteractions(meca, pam, a, start, stop);
+        // add steric interactions between panes `a` and `b > a`:
+        for ( unsigned b = a+1; b <= nbp; ++b )
+        {
+            if ( prop->steric_pairs[a-1] & ( 1U << (b-1) ) )
+                pointGrid.setInteractions(meca, pam, a, b, start, stop);
+        }
+    }
+}
+
+
+void Simul::setStericInteractions(Meca& meca) const
+{
+    fillStericGrid();
+    if ( pointGrid.hasGrid() )
+        setStericInteractions(meca, 0, pointGrid.nbCells());
+}
+
+
+//------------------------------------------------------------------------------
+/**
+ This is equivalent to the serial loops of setAllInteractions(), but the objects
+ are distributed over the threads of `meca`. For steric interactions, the grid is
+ filled serially, and its cells are then divided in slabs of consecutive indices,
+ which are processed by different threads, without conflicts since the grid is
+ only read.
+ Each thread records its interactions in a secondary system (Meca::shard),
+ and these are finally added to the matrices and vector of `meca`.
+ Since the order of summation depends on the distribution of work,
+ results may differ in the last digits from the serial calculation.
+ */
+void Simul::setAllInteractionsParallel(Meca & meca) const
+{
+    Array<Space const*> spcs;
+    spcs.allocate(spaces.size());
+    for ( Space const* s=spaces.first(); s; s=s->next() )
+        spcs.push_back(s);
+
+    Array<Mecable const*> mecs;
+    mecs.allocate(fibers.size()+solids.size()+spheres.size()+beads.size());
+    for ( Fiber const* f=fibers.first(); f ; f=f->next() )
+        mecs.push_back(f);
+    for ( Solid const* s=solids.first(); s ; s=s->next() )
+        mecs.push_back(s);
+    for ( Sphere const* o=spheres.first(); o ; o=o->next() )
+        mecs.push_back(o);
+    for ( Bead const* b=beads.first(); b ; b=b->next() )
+        mecs.push_back(b);
+    
+    Array<Single const*> sins;
+    sins.allocate(singles.sizeA());
+    for ( Single const* i=singles.firstA(); i ; i=i->next() )
+        sins.push_back(i);
+    
+    Array<Couple const*> cous;
+    cous.allocate(couples.sizeAA());
+    for ( Couple const* c=couples.firstAA(); c ; c=c->next() )
+        cous.push_back(c);
+    
+    Array<Organizer const*> orgs;
+    orgs.allocate(organizers.size());
+    for ( Organizer const* a = organizers.first(); a; a=a->next() )
+        orgs.push_back(a);
+
+    // index ranges of the different categories of objects:
+    const size_t n0 = spcs.size();
+    const size_t n1 = n0 + mecs.size();
+    const size_t n2 = n1 + sins.size();
+    const size_t n3 = n2 + cous.size();
+    const size_t n4 = n3 + orgs.size();
+    FiberSet const& fibs = fibers;
+    
+    // steric interactions are calculated in slabs of cells:
+    size_t nbc = 0, nbs = 0;
+    if ( prop->steric )
+    {
+        fillStericGrid();
+        nbc = pointGrid.nbCells();
+        nbs = std::min(nbc, (size_t)16*meca.nbThreads());
+    }
+    const size_t n5 = n4 + nbs;
+
+    meca.forAllInteractions(n5, [&](size_t i, Meca& mec)
+    {
+        if ( i >= n4 )
+        {
+            size_t s = i - n4;
+            setStericInteractions(mec, s*nbc/nbs, (s+1)*nbc/nbs);
+            return;
+        }
+        if ( i < n1 )
+        {
+            if ( i < n0 )
+                spcs[i]->setInteractions(mec, fibs);
+            else
+                mecs[i-n0]->setInteractions(mec);
+        }
+        else if ( i < n2 )
+            sins[i-n1]->setInteractions(mec);
+        else if ( i < n3 )
+            cous[i-n2]->setInteractions(mec);
+        else
+            orgs[i-n3]->setInteractions(mec);
+    });
+    
+    meca.mergeShards();
 }
 
 
@@ -220,36 +299,41 @@ void Simul::setStericInteractions(Meca& meca) const
  */
 void Simul::setAllInteractions(Meca & meca) const
 {
-    for ( Space * s=spaces.first(); s; s=s->next() )
-        s->setInteractions(meca, fibers);
-    
-    for ( Fiber * f=fibers.first(); f ; f=f->next() )
-        f->setInteractions(meca);
-    
-    for ( Solid * s=solids.first(); s ; s=s->next() )
-        s->setInteractions(meca);
-    
-    for ( Sphere * o=spheres.first(); o ; o=o->next() )
-        o->setInteractions(meca);
-    
-    for ( Bead * b=beads.first(); b ; b=b->next() )
-        b->setInteractions(meca);
-
-    for ( Single * i=singles.firstA(); i ; i=i->next() )
-        i->setInteractions(meca);
+    if ( meca.nbThreads() > 1 && !meca.drawLinks )
+        setAllInteractionsParallel(meca);
+    else
+    {
+        for ( Space * s=spaces.first(); s; s=s->next() )
+            s->setInteractions(meca, fibers);
+        
+        for ( Fiber * f=fibers.first(); f ; f=f->next() )
+            f->setInteractions(meca);
+        
+        for ( Solid * s=solids.first(); s ; s=s->next() )
+            s->setInteractions(meca);
+        
+        for ( Sphere * o=spheres.first(); o ; o=o->next() )
+            o->setInteractions(meca);
+        
+        for ( Bead * b=beads.first(); b ; b=b->next() )
+            b->setInteractions(meca);
+        
+        for ( Single * i=singles.firstA(); i ; i=i->next() )
+            i->setInteractions(meca);
+        
+        for ( Couple * c=couples.firstAA(); c ; c=c->next() )
+            c->setInteractions(meca);
+        
+        for ( Organizer * a = organizers.first(); a; a=a->next() )
+            a->setInteractions(meca);
 
-    for ( Couple * c=couples.firstAA(); c ; c=c->next() )
-        c->setInteractions(meca);
-    
-    for ( Organizer * a = organizers.first(); a; a=a->next() )
-        a->setInteractions(meca);
+        // add steric interactions
+        if ( prop->steric )
+            setStericInteractions(meca);
+    }
 
     //for ( Event * e = events.first(); e; e=e->next() )
     //    e->setInteractions(meca);
-
-    // add steric interactions
-    if ( prop->steric )
-        setStericInteractions(meca);
     
     
     // ALL THE FORCES BELOW WERE DONE FOR TESTING PURPOSES:
@@ -51,7 +51,7 @@ void Simul::setFiberGrid(Space const* spc) const
     //std::clog << "simul:binding_grid_step = " << prop->binding_grid_step << "\n";
 
     // create the grid cells:
-    fiberGrid.createCells();
+    fiberGrid.createCells(prop->binding_grid_layout);
 
     //Cytosim::log("simul:binding_grid_step %.3f\n", prop->binding_grid_step);
     Cytosim::log(" BindingGrid has %i cells of size %.3f um\n", fiberGrid.nbCells(), step);
@@ -130,7 +130,10 @@ void Simul::step()
         range = std::max(range, static_cast<HandProp const*>(i)->binding_range);
 
     // distribute Fibers over a grid for binding of Hands:
-    fiberGrid.paintGrid(fibers.first(), nullptr, range);
+    if ( prop->binding_grid_skin > 0 )
+        fiberGrid.updateGrid(fibers, range, prop->binding_grid_skin);
+    else
+        fiberGrid.paintGrid(fibers.first(), nullptr, range);
     
 #if ( 0 )
     
@@ -156,7 +156,7 @@ void Single::setInteractions(Meca & meca) const
 void Single::write(Outputter& out) const
 {
     sHand->write(out);
-    out.writeFloats(sPos, DIM);
+    writePoints(out, sPos, 1);
 }
 
 
@@ -164,7 +164,7 @@ void Single::read(Inputter& in, Simul& sim, ObjectTag tag)
 {
     const bool s = attached();
     sHand->read(in, sim);
-    in.readFloats(sPos, DIM);
+    readPoints(in, sPos, 1);
     
     /*
      Because the SingleSet has 2 lists where Single are stored depending
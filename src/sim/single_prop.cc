@@ -81,6 +81,7 @@ void SingleProp::clear()
     length            = 0;
     diffusion         = 0;
     fast_diffusion    = false;
+    reservoir_step    = 0;
 #if NEW_MOBILE_SINGLE
     speed.reset();
 #endif
@@ -102,6 +103,7 @@ void SingleProp::read(Glossary& glos)
     else
         glos.set(diffusion,  "diffusion");
     glos.set(fast_diffusion, "fast_diffusion");
+    glos.set(reservoir_step, "reservoir_step", 0, "fast_diffusion", 1);
 #if NEW_MOBILE_SINGLE
     glos.set(speed,          "speed");
 #endif
@@ -139,6 +141,9 @@ void SingleProp::complete(Simul const& sim)
             throw InvalidParameter(name()+":confine_space `"+confine_space+"' was not found");
     }
 
+    if ( reservoir_step < 0 )
+        throw InvalidParameter(name()+":reservoir_step must be >= 0");
+
     if ( hand.empty() )
         throw InvalidParameter("single:hand must be defined");
     hand_prop = sim.findProperty<HandProp>("hand", hand);
@@ -192,6 +197,7 @@ void SingleProp::write_values(std::ostream& os) const
     write_value(os, "length",         length);
     write_value(os, "diffusion",      diffusion);
     write_value(os, "fast_diffusion", fast_diffusion);
+    write_value(os, "reservoir_step", reservoir_step);
 #if NEW_MOBILE_SINGLE
     write_value(os, "speed",          speed);
 #endif
@@ -24,6 +24,7 @@ class SingleProp : public Property
     friend class Single;
     friend class Wrist;
     friend class WristLong;
+    friend class SingleSet;
 
 public:
     
@@ -75,6 +76,21 @@ public:
      */
     int          fast_diffusion;
     
+    /// if set > 0, free Singles are counted on a grid of this size (also known as `fast_diffusion[1]`)
+    /**
+     This refines `fast_diffusion = 1`, for systems where the free Singles or the
+     fibers are not uniformly distributed. The Space is divided in voxels of size
+     `reservoir_step`, and each free Single is only recorded in the voxel in which
+     it was released. Singles hop between adjacent voxels at a rate derived from
+     `diffusion`, and attach along the fibers in proportion to the local
+     concentration in the voxel containing each segment of the fiber.
+     
+     The step should be larger than the segmentation of the fibers, and
+     comparable to `sqrt(diffusion * time_step)` or larger.
+     This is ignored if `fast_diffusion != 1`.
+     */
+    real         reservoir_step;
+    
 #if NEW_MOBILE_SINGLE
     /// constant drift
     Vector       speed;
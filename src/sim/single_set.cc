@@ -22,6 +22,13 @@ Property* SingleSet::newProperty(const std::string& cat, const std::string& nom,
 
 //------------------------------------------------------------------------------
 
+SingleSet::~SingleSet()
+{
+    for ( Reservoir * r : uniGrids )
+        delete r;
+}
+
+
 void SingleSet::prepare(PropertyList const& properties)
 {
     uni = uniPrepare(properties);
@@ -471,6 +478,47 @@ void SingleSet::removeWrists(Object const* arg)
 #pragma mark - Fast Diffusion
 
 
+/**
+ Attach Single `s` at the site `i`, if this is allowed.
+ */
+bool SingleSet::uniAttach(FiberSite& i, Single * s)
+{
+    Hand const* h = s->hand();
+    
+    if ( h->attachmentAllowed(i) )
+    {
+        Vector pos = i.pos();
+        
+        if ( s->prop->confine == CONFINE_ON )
+        {
+            // Only attach if position is near the edge of the Space:
+            Vector prj = s->confineSpace()->project(pos);
+            if ( distanceSqr(pos, prj) >= square(h->prop->binding_range) )
+                return false;
+            // Single will be placed on the edge of the Space:
+            pos = prj;
+        }
+        else
+        {
+#if ( DIM > 1 )
+            /*
+             Place the Single in the line perpendicular to the attachment point,
+             at a random distance within the range of attachment of the Hand.
+             This simulates a uniform spatial distribution of Single.
+             */
+            pos += i.dirFiber().randOrthoB(h->prop->binding_range);
+#endif
+        }
+        
+        s->setPosition(pos);
+        s->attach(i);
+        link(s);
+        return true;
+    }
+    return false;
+}
+
+
 /**
  Distribute Singles on the sites specified in `loc`.
  */
@@ -480,43 +528,46 @@ void SingleSet::uniAttach(Array<FiberSite>& loc, SingleReserveList& can)
     {
         if ( can.empty() )
             return;
-        Single * s = can.back();
-        Hand const* h = s->hand();
-        
-        if ( h->attachmentAllowed(i) )
-        {
-            Vector pos = i.pos();
-            
-            if ( s->prop->confine == CONFINE_ON )
-            {
-                // Only attach if position is near the edge of the Space:
-                Vector prj = s->confineSpace()->project(pos);
-                if ( distanceSqr(pos, prj) >= square(h->prop->binding_range) )
-                    continue;
-                // Single will be placed on the edge of the Space:
-                pos = prj;
-            }
-            else
-            {
-#if ( DIM > 1 )
-                /*
-                 Place the Single in the line perpendicular to the attachment point,
-                 at a random distance within the range of attachment of the Hand.
-                 This simulates a uniform spatial distribution of Single.
-                 */
-                pos += i.dirFiber().randOrthoB(h->prop->binding_range);
-#endif
-            }
+        if ( uniAttach(i, can.back()) )
+            can.pop_back();
+    }
+}
+
 
+/**
+ Distribute Singles on the sites specified in `loc`,
+ taking the Singles from the voxels specified in `vox`
+ */
+void SingleSet::uniAttach(Array<FiberSite>& loc, Array<Reservoir::index_t>& vox, Reservoir& res)
+{
+    for ( size_t n = 0; n < loc.size(); ++n )
+    {
+        Reservoir::Pool & can = res.pool(vox[n]);
+        if ( !can.empty() && uniAttach(loc[n], static_cast<Single*>(can.back())) )
             can.pop_back();
-            s->setPosition(pos);
-            s->attach(i);
-            link(s);
-        }
     }
 }
 
 
+/**
+ Variant of uniAttach() used if ( single:reservoir_step > 0 ), in which the
+ free Singles are counted in the voxels of a coarse grid, and diffuse between
+ adjacent voxels. The density of binding sites along a segment of fiber is
+ derived from the number of Singles in the voxel containing this segment.
+ */
+void SingleSet::uniAttach(FiberSet const& fibers, Reservoir& res)
+{
+    SingleProp const* p = static_cast<SingleProp const*>(res.property());
+    
+    Array<FiberSite> loc(1024);
+    Array<Reservoir::index_t> vox(1024);
+
+    res.diffuse();
+    res.fiberSites(fibers, 1 / p->hand_prop->bindingSectionProb(), loc, vox);
+    uniAttach(loc, vox, res);
+}
+
+
 /**
  Implements a Monte-Carlo approach for attachments of free Single, assumming that
  diffusion is sufficiently fast to maintain a uniform spatial distribution,
@@ -551,7 +602,10 @@ void SingleSet::uniAttach(FiberSet const& fibers)
         {
             unlink(obj);
             assert_true((size_t)p->number() < uniLists.size());
-            uniLists[p->number()].push_back(obj);
+            if ( uniGrids[p->number()] )
+                uniGrids[p->number()]->add(obj, obj->position());
+            else
+                uniLists[p->number()].push_back(obj);
         }
         obj = nxt;
     }
@@ -582,13 +636,21 @@ void SingleSet::uniAttach(FiberSet const& fibers)
             uniAttach(loc, reserve);
         }
     }
+    
+    // attachment from the local concentration of gridded reserves:
+    for ( Reservoir * r : uniGrids )
+    {
+        if ( r )
+            uniAttach(fibers, *r);
+    }
 }
 
 
 /**
  
  Return true if at least one single:fast_diffusion is true,
- and in this case allocate uniLists.
+ and in this case allocate uniLists, and uniGrids for the classes
+ with `single:reservoir_step > 0`.
  
  The Volume of the Space is assumed to remain constant until the next uniPrepare()
  */
@@ -604,8 +666,28 @@ bool SingleSet::uniPrepare(PropertyList const& properties)
         last = std::max(last, p->number());
     }
     
+    // objects that are still held by the Reservoirs are returned to the lists:
+    uniRelax();
+    for ( Reservoir * r : uniGrids )
+        delete r;
+    uniGrids.clear();
+
     if ( res )
+    {
         uniLists.resize(last+1);
+        uniGrids.resize(last+1, nullptr);
+        
+        for ( Property const* i : properties.find_all("single") )
+        {
+            SingleProp const* p = static_cast<SingleProp const*>(i);
+            if ( p->fast_diffusion == 1 && p->reservoir_step > 0 )
+            {
+                Reservoir * r = new Reservoir(p);
+                r->setGrid(p->confine_space_ptr, p->reservoir_step, p->diffusion, simul.time_step());
+                uniGrids[p->number()] = r;
+            }
+        }
+    }
     
     return res;
 }
@@ -627,5 +709,23 @@ void SingleSet::uniRelax()
         }
         reserve.clear();
     }
+    
+    // Singles are placed randomly within their voxel:
+    for ( Reservoir * r : uniGrids )
+    {
+        if ( !r )
+            continue;
+        for ( Reservoir::index_t i = 0; i < r->nbCells(); ++i )
+        {
+            for ( Object * o : r->pool(i) )
+            {
+                Single * s = static_cast<Single*>(o);
+                assert_true(!s->attached());
+                s->setPosition(r->randomPosition(i));
+                link(s);
+            }
+            r->pool(i).clear();
+        }
+    }
 }
 
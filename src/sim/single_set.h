@@ -4,6 +4,7 @@
 
 #include "object_set.h"
 #include "single.h"
+#include "reservoir.h"
 
 
 /// a list of pointers to Single
@@ -50,9 +51,21 @@ private:
     /// initialize couple:fast_diffusion attachment algorithm
     bool          uniPrepare(PropertyList const& properties);
     
+    /// uniGrids[p] contains the diffusing Singles of class p, if ( single:reservoir_step > 0 )
+    std::vector<Reservoir*> uniGrids;
+    
+    /// attach Single at given site, returning true if attachment occured
+    bool          uniAttach(FiberSite&, Single *);
+
     /// distribute Singles to fiber with average distance `spread`
     void          uniAttach(Array<FiberSite>&, SingleReserveList&);
     
+    /// attach Singles from the voxels specified in `vox`
+    void          uniAttach(Array<FiberSite>&, Array<Reservoir::index_t>& vox, Reservoir&);
+    
+    /// single:reservoir_step attachment algorithm, using the local concentration of free Singles
+    void          uniAttach(FiberSet const&, Reservoir&);
+    
     /// couple:fast_diffusion attachment algorithm; assumes free Singles are uniformly distributed
     void          uniAttach(FiberSet const&);
     
@@ -64,6 +77,9 @@ public:
     ///creator
     SingleSet(Simul& s) : ObjectSet(s) {}
     
+    /// destructor
+    ~SingleSet();
+    
     //--------------------------
 
     /// identifies the class
@@ -1170,6 +1170,14 @@ void Solid::projectForces(const real* X, real* Y) const
 void Solid::write(Outputter& out) const
 {
     out.writeUInt16(nPoints);
+    if ( out.codec() )
+    {
+        // in a compressed frame, the coordinates are stored together:
+        writePoints(out, pPos, nPoints);
+        for ( unsigned p = 0; p < nPoints ; ++p )
+            out.writeFloat(soRadius[p]);
+        return;
+    }
     for ( unsigned p = 0; p < nPoints ; ++p )
     {
         out.writeFloats(pPos + DIM * p, DIM, '\n');
@@ -1185,10 +1193,19 @@ void Solid::read(Inputter& in, Simul&, ObjectTag)
     {
         unsigned nbp = in.readUInt16();
         setNbPoints(nbp);
-        for ( unsigned i = 0; i < nbp ; ++i )
+        if ( in.codec() )
+        {
+            readPoints(in, pPos, nbp);
+            for ( unsigned i = 0; i < nbp ; ++i )
+                soRadius[i] = in.readFloat();
+        }
+        else
         {
-            in.readFloats(pPos+DIM*i, DIM);
-            soRadius[i] = in.readFloat();
+            for ( unsigned i = 0; i < nbp ; ++i )
+            {
+                in.readFloats(pPos+DIM*i, DIM);
+                soRadius[i] = in.readFloat();
+            }
         }
     }
     catch( Exception & e )
@@ -0,0 +1,264 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "space_grid.h"
+#include "assert_macro.h"
+#include "exceptions.h"
+#include "messages.h"
+#include "space.h"
+#include <cmath>
+
+
+void SpaceGrid::clear()
+{
+    flag_.clear();
+    prj_.clear();
+}
+
+
+size_t SpaceGrid::node(const int c[]) const
+{
+    size_t res = 0;
+    for ( int d = 0; d < DIM; ++d )
+        res += c[d] * stride_[d];
+    return res;
+}
+
+
+/**
+ Multilinear interpolation of the projections stored at the 2^DIM corners of cell `c`
+ */
+Vector SpaceGrid::interpolate(const int c[], real const* w) const
+{
+    real t[3] = { 0, 0, 0 };
+    for ( int d = 0; d < DIM; ++d )
+        t[d] = ( w[d] - grid_.position(d, c[d]) ) * grid_.delta(d);
+
+    real const* ptr = prj_.data() + DIM * node(c);
+    real res[3] = { 0, 0, 0 };
+    for ( int k = 0; k < (1<<DIM); ++k )
+    {
+        real a = 1;
+        for ( int d = 0; d < DIM; ++d )
+            a *= ( k >> d & 1 ) ? t[d] : 1 - t[d];
+        real const* p = ptr + DIM * corner_[k];
+        for ( int d = 0; d < DIM; ++d )
+            res[d] += a * p[d];
+    }
+    return Vector(res);
+}
+
+
+/**
+ The projections of the nodes of cell `c` and of the cells surrounding it,
+ are compared with the affine function defined by the first corner of `c`
+ and its neighbors along each dimension. This is true if all these nodes
+ project on the same flat edge or on the same vertex of the Space.
+ Testing the neighboring cells is necessary, because a boundary between the
+ regions projecting on different features may end inside cell `c` without
+ separating its corners, but this boundary will then cross a neighboring cell.
+ Returns false if cell `c` is on the border of the grid.
+ */
+bool SpaceGrid::affine(const int c[], real tol) const
+{
+    for ( int d = 0; d < DIM; ++d )
+        if ( c[d] < 1 || (int)grid_.breadth(d) < c[d] + 2 )
+            return false;
+
+    const size_t o = node(c);
+    real const* ori = prj_.data() + DIM * o;
+    real const* dir[3] = { ori, ori, ori };
+    for ( int d = 0; d < DIM; ++d )
+        dir[d] = prj_.data() + DIM * ( o + stride_[d] );
+
+    int nbn = 1;
+    for ( int d = 0; d < DIM; ++d )
+        nbn *= 4;
+
+    for ( int n = 0; n < nbn; ++n )
+    {
+        // node offset by -1, 0, 1 or 2 from the first corner, in each dimension:
+        int off[3] = { 0, 0, 0 };
+        int x[3] = { 0, 0, 0 };
+        int s = n;
+        for ( int d = 0; d < DIM; ++d )
+        {
+            off[d] = s % 4 - 1;
+            x[d] = c[d] + off[d];
+            s /= 4;
+        }
+        real const* p = prj_.data() + DIM * node(x);
+        real nrm = 0;
+        for ( int e = 0; e < DIM; ++e )
+        {
+            real v = ori[e];
+            for ( int d = 0; d < DIM; ++d )
+                v += off[d] * ( dir[d][e] - ori[e] );
+            nrm += ( p[e] - v ) * ( p[e] - v );
+        }
+        if ( nrm > tol * tol )
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ Compare the interpolated and exact projections at all the points of cell `c`
+ for which each coordinate is at the start, middle or end of the cell,
+ excluding the corners where the two are equal by construction.
+ In 3D, this tests 12 edge midpoints, 6 face centers and the center of the cell.
+ */
+bool SpaceGrid::matching(Space const* spc, index_t i, const int c[], real tol) const
+{
+    int nbp = 1;
+    for ( int d = 0; d < DIM; ++d )
+        nbp *= 3;
+
+    for ( int p = 0; p < nbp; ++p )
+    {
+        real w[3] = { 0, 0, 0 };
+        grid_.setPositionFromIndex(w, i, 0);
+        bool corner = true;
+        int s = p;
+        for ( int d = 0; d < DIM; ++d )
+        {
+            w[d] += 0.5 * ( s % 3 ) * grid_.cellWidth(d);
+            corner &= ( s % 3 != 1 );
+            s /= 3;
+        }
+        if ( corner )
+            continue;
+        if ( distanceSqr(interpolate(c, w), spc->project(Vector(w))) > tol * tol )
+            return false;
+    }
+    return true;
+}
+
+
+/**
+ The grid covers the boundaries of the Space, with a margin of two cells on each side.
+ The exact methods of the Space are called for each node and for a few points in each
+ cell, and this can take a while if the grid is fine.
+ The grid is released if `step <= 0`.
+ */
+void SpaceGrid::build(Space const* spc, const real step)
+{
+    // this must be done first, since `spc` may call our inside() and project()
+    clear();
+
+    if ( step <= 0 )
+        return;
+
+    Vector inf, sup;
+    spc->boundaries(inf, sup);
+
+    real infs[3] = { 0, 0, 0 };
+    real sups[3] = { 0, 0, 0 };
+    int size[3] = { 1, 1, 1 };
+
+    for ( int d = 0; d < DIM; ++d )
+    {
+        size[d] = 4 + (int)ceil( ( sup[d] - inf[d] ) / step );
+        real mid = 0.5 * ( inf[d] + sup[d] );
+        infs[d] = mid - 0.5 * step * size[d];
+        sups[d] = mid + 0.5 * step * size[d];
+    }
+    grid_.setDimensions(infs, sups, size);
+
+    size_t nbn = 1;
+    for ( int d = 0; d < DIM; ++d )
+    {
+        stride_[d] = nbn;
+        nbn *= size[d] + 1;
+    }
+
+    for ( int k = 0; k < (1<<DIM); ++k )
+    {
+        corner_[k] = 0;
+        for ( int d = 0; d < DIM; ++d )
+            if ( k >> d & 1 )
+                corner_[k] += stride_[d];
+    }
+
+    // projection and signed distance at the nodes:
+    std::vector<real> prj(DIM*nbn);
+    std::vector<real> dis(nbn);
+    for ( size_t n = 0; n < nbn; ++n )
+    {
+        real x[3] = { 0, 0, 0 };
+        size_t s = n;
+        for ( int d = 0; d < DIM; ++d )
+        {
+            x[d] = grid_.position(d, s % ( size[d] + 1 ));
+            s /= size[d] + 1;
+        }
+        Vector pos(x);
+        Vector p = spc->project(pos);
+        for ( int d = 0; d < DIM; ++d )
+            prj[DIM*n+d] = p[d];
+        real a = sqrt(distanceSqr(pos, p));
+        dis[n] = spc->inside(pos) ? -a : a;
+    }
+    prj_.swap(prj);
+
+    const index_t nbc = grid_.nbCells();
+    std::vector<unsigned char> flag(nbc, UNDECIDED);
+
+    // any point of a cell is within this distance of any corner:
+    const real diag = step * sqrt(real(DIM));
+    // tolerance on the interpolated projection:
+    const real tol = 1e-5 * step;
+
+    size_t cnt[2] = { 0, 0 };
+    for ( index_t i = 0; i < nbc; ++i )
+    {
+        int c[3] = { 0, 0, 0 };
+        grid_.setCoordinatesFromIndex(c, i);
+        const size_t o = node(c);
+        real dmin = dis[o], dmax = dis[o];
+        for ( int k = 1; k < (1<<DIM); ++k )
+        {
+            dmin = std::min(dmin, dis[o+corner_[k]]);
+            dmax = std::max(dmax, dis[o+corner_[k]]);
+        }
+
+        if ( dmin < -diag )
+            flag[i] = INSIDE;
+        else if ( dmax > diag )
+            flag[i] = OUTSIDE;
+        else
+            continue;
+        ++cnt[0];
+
+        if ( affine(c, tol) && matching(spc, i, c, tol) )
+        {
+            flag[i] |= LINEAR;
+            ++cnt[1];
+        }
+    }
+    flag_.swap(flag);
+
+    Cytosim::log("SpaceGrid set with %lu cells of size %.3f um: %lu classified, %lu interpolated\n", nbc, step, cnt[0], cnt[1]);
+}
+
+
+/**
+ The interpolation is only used for cells that are away from the edge
+ and in which the projection was found to be affine.
+ */
+bool SpaceGrid::project(Vector const& w, Vector& prj) const
+{
+    if ( ! grid_.inside(w.data()) )
+        return false;
+
+    index_t i = grid_.index(w.data());
+    if ( flag_[i] & LINEAR )
+    {
+        int c[3] = { 0, 0, 0 };
+        grid_.setCoordinatesFromIndex(c, i);
+        prj = interpolate(c, w.data());
+        return true;
+    }
+    return false;
+}
+
@@ -0,0 +1,112 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef SPACE_GRID_H
+#define SPACE_GRID_H
+
+#include "dim.h"
+#include "vector.h"
+#include "grid_base.h"
+#include <vector>
+
+class Space;
+
+
+/// Precomputed classification and projection for a Space with a costly geometry
+/**
+ This is used when `space:cache_step > 0`, by the shapes for which inside() and
+ project() are expensive, for example a polygon with many edges.
+
+ The bounding box of the Space is covered by a grid of cubic cells, and the
+ signed distance to the edge and the projection are calculated with the exact
+ methods of the Space at the nodes of this grid.
+
+ The signed distance is 1-Lipschitz, and a cell can be classified as entirely
+ inside or outside the Space if one of its corners is further from the edge than
+ the diagonal of the cell. For such a cell, inside() returns without calling
+ the Space. The cells that intersect the edge of the Space are undecided, and
+ the exact method must be used for them.
+
+ project() interpolates linearly the projection of the corners of a cell.
+ This is exact where the projection is affine, as is the case near a flat edge
+ or in the region facing a corner of a polygon. The interpolation is only used
+ for cells that are away from the edge, for which the projections of the nodes
+ of the cell and of the cells around it are the same affine function, and in
+ which the interpolation matches the exact result at the middle of all edges
+ and faces, and at the center of the cell.
+ */
+class SpaceGrid
+{
+public:
+
+    /// index of a cell
+    typedef GridBase<DIM>::index_t index_t;
+
+    /// flags attributed to each cell
+    enum { UNDECIDED = 0, INSIDE = 1, OUTSIDE = 2, LINEAR = 4 };
+
+private:
+
+    /// the cells
+    GridBase<DIM> grid_;
+
+    /// flags for each cell
+    std::vector<unsigned char> flag_;
+
+    /// projection of the nodes, DIM values per node
+    std::vector<real> prj_;
+
+    /// offset in `prj_` of the nodes at the corners of a cell, relative to the first corner
+    size_t corner_[1<<DIM];
+
+    /// stride of the nodes in each dimension
+    size_t stride_[3];
+
+    /// index of the node at the lowest corner of cell with coordinates `c`
+    size_t node(const int c[]) const;
+
+    /// interpolate the projection of the nodes, at position `w` in cell `c`
+    Vector interpolate(const int c[], real const* w) const;
+
+    /// true if the projections of the nodes around cell `c` are an affine function
+    bool   affine(const int c[], real tol) const;
+
+    /// true if the interpolated projection in cell `i` matches the exact projection of `spc`
+    bool   matching(Space const* spc, index_t i, const int c[], real tol) const;
+
+    /// Disabled copy constructor
+    SpaceGrid(SpaceGrid const&);
+
+    /// Disabled copy assignment
+    SpaceGrid& operator=(SpaceGrid const&);
+
+public:
+
+    /// constructor
+    SpaceGrid() {}
+
+    /// release memory
+    void    clear();
+
+    /// true if the grid was built
+    bool    ready() const { return flag_.size() > 0; }
+
+    /// calculate values from `spc`, using cells of size `step`
+    void    build(Space const* spc, real step);
+
+    /// returns 1 if `w` is inside, 0 if `w` is outside and -1 if this cannot be decided
+    int     inside(Vector const& w) const
+    {
+        if ( ! grid_.inside(w.data()) )
+            return 0;
+        unsigned f = flag_[grid_.index(w.data())];
+        if ( f & INSIDE ) return 1;
+        if ( f & OUTSIDE ) return 0;
+        return -1;
+    }
+
+    /// set `prj` and return true, if the projection of `w` can be interpolated
+    bool    project(Vector const& w, Vector& prj) const;
+};
+
+#endif
+
@@ -157,6 +157,7 @@ void SpaceProp::clear()
     shape         = "";
     display       = "";
     display_fresh = false;
+    cache_step    = 0;
 }
 
 
@@ -183,6 +184,8 @@ void SpaceProp::read(Glossary& glos)
     
     if ( glos.set(display, "display") )
         display_fresh = true;
+    
+    glos.set(cache_step, "cache_step");
 }
 
 //------------------------------------------------------------------------------
@@ -191,6 +194,9 @@ void SpaceProp::complete(Simul const& sim)
 {
     if ( shape.empty() )
         throw InvalidParameter("space:shape must be defined");
+
+    if ( cache_step < 0 )
+        throw InvalidParameter("space:cache_step must be >= 0");
 }
 
 //------------------------------------------------------------------------------
@@ -200,5 +206,6 @@ void SpaceProp::write_values(std::ostream& os) const
     //write_value(os, "geometry",   geometry);
     write_value(os, "shape",      shape);
     write_value(os, "display",    "("+display+")");
+    write_value(os, "cache_step", cache_step);
 }
 
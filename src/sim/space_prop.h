@@ -35,6 +35,17 @@ public:
     /// display string (see @ref PointDispPar)
     std::string  display;
     
+    /// size of the cells used to precompute inside() and project() (0 = disabled)
+    /**
+     If `cache_step > 0`, the position of the edge is precalculated on a grid
+     covering the Space, and used to accelerate inside() and project() away from
+     the edge. The cost of building the grid is proportional to its number of cells,
+     and this should only be used for shapes that are costly to evaluate, such as
+     polygons with many edges. This is currently used by `polygon`, `polygonZ`
+     and `banana`, and ignored by the other shapes.
+     */
+    real         cache_step;
+    
     /// @}
     
     /// BACKWARD_COMPATIBILITY
@@ -62,6 +62,8 @@ void SpaceBanana::update()
     bCenter[0] = 0;
     bCenter[1] = bRadius - bEnd[1];
     bCenter[2] = 0;
+    
+    cache_.build(this, prop->cache_step);
 }
 
 
@@ -107,6 +109,12 @@ Vector SpaceBanana::backbone(Vector const& pos) const
 
 bool SpaceBanana::inside(Vector const& pos) const
 {
+    if ( cache_.ready() )
+    {
+        int i = cache_.inside(pos);
+        if ( i >= 0 )
+            return i;
+    }
     Vector prj = backbone(pos);
     return ( distanceSqr(pos, prj) <= bWidthSqr );
 }
@@ -114,6 +122,10 @@ bool SpaceBanana::inside(Vector const& pos) const
 
 Vector SpaceBanana::project(Vector const& pos) const
 {
+    Vector prj;
+    if ( cache_.ready() && cache_.project(pos, prj) )
+        return prj;
+
     Vector cen = backbone(pos);
     Vector dif = pos - cen;
     real n = dif.normSqr();
@@ -136,6 +148,9 @@ void SpaceBanana::write(Outputter& out) const
 
 void SpaceBanana::setLengths(const real len[])
 {
+    // skip update() if nothing changed, as it may rebuild `cache_`
+    if ( bLength == len[0] && bWidth == len[1] && bRadius == len[2] && cache_.ready() )
+        return;
     bLength = len[0];
     bWidth  = len[1];
     bRadius = len[2];
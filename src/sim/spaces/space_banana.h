@@ -4,6 +4,7 @@
 #define SPACE_BANANA_H
 
 #include "space.h"
+#include "space_grid.h"
 
 /// a bent cylinder of constant diameter terminated by hemispheric caps
 /**
@@ -37,6 +38,9 @@ private:
     /// coordinates of the center of the torus
     Vector bCenter;
     
+    /// precomputed values, used if `cache_step > 0`
+    SpaceGrid cache_;
+    
     void update();
     
     /// project on the backbone circle
@@ -97,13 +97,21 @@ void SpacePolygon::update()
 
     real box[4];
     poly_.find_extremes(box);
-    inf_.set(box[0], box[2], 0);
-    sup_.set(box[1], box[3], 0);
+    inf_.set(box[0], box[2], -height_);
+    sup_.set(box[1], box[3],  height_);
+    
+    cache_.build(this, prop->cache_step);
 }
 
 
 bool SpacePolygon::inside(Vector const& w) const
 {
+    if ( cache_.ready() )
+    {
+        int i = cache_.inside(w);
+        if ( i >= 0 )
+            return i;
+    }
 #if ( DIM > 2 )
     if ( fabs(w.ZZ) > height_ )
         return false;
@@ -127,6 +135,8 @@ Vector SpacePolygon::randomPlace() const
 Vector SpacePolygon::project(Vector const& w) const
 {
     Vector p;
+    if ( cache_.ready() && cache_.project(w, p) )
+        return p;
 #if ( DIM == 1 )
     
     p.XX = w.XX;
@@ -4,6 +4,7 @@
 
 #include "space.h"
 #include "polygon.h"
+#include "space_grid.h"
 
 /// a polygonal convex region in space
 /**
@@ -45,6 +46,9 @@ private:
     /// half the total height in Z
     real        height_;
 
+    /// precomputed values, used if `cache_step > 0`
+    SpaceGrid   cache_;
+
     /// update
     void        update();
 
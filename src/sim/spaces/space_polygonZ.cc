@@ -102,18 +102,29 @@ void SpacePolygonZ::update()
     inf_.set(-box[1],-box[1], box[2]);
     sup_.set( box[1], box[1], box[3]);
 
+    cache_.build(this, prop->cache_step);
     volume_ = estimateVolumeZ(1<<17);
 }
 
 
 bool SpacePolygonZ::inside(Vector const& w) const
 {
+    if ( cache_.ready() )
+    {
+        int i = cache_.inside(w);
+        if ( i >= 0 )
+            return i;
+    }
     return poly_.inside(w.normXY(), w[2], 1);
 }
 
 
 Vector SpacePolygonZ::project(Vector const& w) const
 {
+    Vector p;
+    if ( cache_.ready() && cache_.project(w, p) )
+        return p;
+
     real P, Z, R = w.normXY();
     int hit;
     poly_.project(R, w.z(), P, Z, hit);
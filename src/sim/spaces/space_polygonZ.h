@@ -4,6 +4,7 @@
 
 #include "space.h"
 #include "polygon.h"
+#include "space_grid.h"
 
 /// an axisymmetric volume obtained by rotating a polygon around the Z axis
 /**
@@ -33,6 +34,9 @@ private:
     /// Volume calculated from polygon
     real              volume_;
 
+    /// precomputed values, used if `cache_step > 0`
+    SpaceGrid         cache_;
+
     /// update data structure
     void update();
     
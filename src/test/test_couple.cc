@@ -0,0 +1,116 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+/*
+ Test of the unbinding rate of Couples, in the different modes of CoupleSet:
+
+     test_couple
+
+ The Couples have a constant unbinding rate, and the fraction of attached
+ Hands that detach during a time step is measured, to estimate this rate.
+ This is done with `fast_diffusion`, in which case the Couples are attached
+ by CoupleSet::uniAttach(), with and without `simul:detach_queue`,
+ `simul:batch_couples` and `reservoir_step`.
+ Each Hand detaches in a time step with probability p = 1 - exp(-UNBINDING * dt),
+ and the number of detachments follows a binomial distribution. The program
+ returns a failure if any estimate differs from the rate given by more than
+ 4 standard deviations of this distribution. The random number generator is
+ seeded with a constant, such that the results are reproducible.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include "simul.h"
+#include "simul_prop.h"
+#include "messages.h"
+#include "exceptions.h"
+#include "test_couple.h"
+
+
+/// append the Hands of `set` that are attached
+void attachedHands(CoupleSet const& set, std::vector<Hand*>& res)
+{
+    res.clear();
+    for ( Couple * c = set.firstAA(); c; c = c->next() )
+    {
+        res.push_back(c->hand1());
+        res.push_back(c->hand2());
+    }
+    for ( Couple * c = set.firstAF(); c; c = c->next() )
+        res.push_back(c->hand1());
+    for ( Couple * c = set.firstFA(); c; c = c->next() )
+        res.push_back(c->hand2());
+}
+
+
+/**
+ Returns the fraction of attached Hands that are detached after one time step,
+ setting `cnt` with the number of attached Hands that were tested.
+ */
+real measure(std::string const& simul_opt, std::string const& couple_opt, size_t& cnt)
+{
+    Simul simul;
+    setupCouples(simul, simul_opt, couple_opt, 64, 10000, "inside");
+
+    // reach the steady state:
+    for ( int n = 0; n < 200; ++n )
+        simul.step();
+
+    std::vector<Hand*> hands;
+    size_t det = 0;
+    cnt = 0;
+    for ( int n = 0; n < 400; ++n )
+    {
+        attachedHands(simul.couples, hands);
+        simul.step();
+        cnt += hands.size();
+        for ( Hand const* h : hands )
+            det += !h->attached();
+    }
+    simul.relax();
+
+    if ( cnt == 0 )
+        return 0;
+    return (real)det / (real)cnt;
+}
+
+
+int main(int argc, char* argv[])
+{
+    Cytosim::all_silent();
+    const real dt = TIME_STEP;
+    const real prob = 1 - std::exp(-UNBINDING * dt);
+
+    const char * modes[][2] = {
+        { "", "" },
+        { "detach_queue = 1;", "" },
+        { "detach_queue = 1; batch_couples = 1;", "" },
+        { "", "reservoir_step = 1;" },
+        { "detach_queue = 1;", "reservoir_step = 1;" },
+        { "detach_queue = 1; batch_couples = 1;", "reservoir_step = 1;" }
+    };
+
+    int res = EXIT_SUCCESS;
+    try
+    {
+        for ( auto const& m : modes )
+        {
+            size_t cnt = 0;
+            real frac = measure(m[0], m[1], cnt);
+            // standard deviation of the fraction for a binomial distribution:
+            real sigma = std::sqrt(prob * ( 1 - prob ) / (real)std::max(cnt, size_t(1)));
+            bool bad = ( cnt == 0 ) || std::abs(frac - prob) > 4 * sigma;
+            real rate = -std::log(1 - frac) / dt;
+            printf("%-40s %-22s unbinding rate %.4f +/- %.4f %s\n", m[0], m[1], rate, sigma / ( ( 1 - prob ) * dt ), bad?"FAILED":"");
+            if ( bad )
+                res = EXIT_FAILURE;
+        }
+    }
+    catch( Exception & e )
+    {
+        std::cerr << "Error: " << e.brief() << '\n';
+        return EXIT_FAILURE;
+    }
+    return res;
+}
+
@@ -0,0 +1,53 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+/*
+ System used by test_couple and test_reservoir: filaments confined in a sphere,
+ and Couples with `fast_diffusion`, which bind and unbind with constant rates.
+*/
+
+#ifndef TEST_COUPLE_H
+#define TEST_COUPLE_H
+
+#include <string>
+#include "simul.h"
+#include "parser.h"
+#include "random.h"
+
+
+/// radius of the cell
+const real RADIUS = 4;
+
+/// time step of the simulation
+const real TIME_STEP = 0.01;
+
+/// unbinding rate of the Hands
+const real UNBINDING = 1;
+
+/// seed of the random number generator, such that the tests are reproducible
+const uint32_t SEED = 1;
+
+
+/**
+ Create a system with `nb_fibers` filaments and `nb_couples` Couples placed at `pos`.
+ The options are added to the parameters of the simul and of the couple.
+ The random number generator is seeded, such that each call gives the same system.
+ */
+inline void setupCouples(Simul& simul, std::string const& simul_opt, std::string const& couple_opt,
+                         int nb_fibers, int nb_couples, std::string const& pos)
+{
+    std::string conf =
+    "set simul system { time_step = " + std::to_string(TIME_STEP) + "; viscosity = 1; " + simul_opt + " }\n"
+    "set space cell { shape = sphere; }\n"
+    "new cell { radius = " + std::to_string(RADIUS) + "; }\n"
+    "set fiber filament { rigidity = 20; segmentation = 0.5; confine = inside, 100; }\n"
+    "new " + std::to_string(nb_fibers) + " filament { length = 6; }\n"
+    "set hand binder { binding = 10, 0.05; unbinding = " + std::to_string(UNBINDING) + ", inf; }\n"
+    "set couple complex { hand1 = binder; hand2 = binder; stiffness = 100; diffusion = 10; "
+    "fast_diffusion = 1; " + couple_opt + " }\n"
+    "new " + std::to_string(nb_couples) + " complex { position = " + pos + "; }\n";
+
+    RNG.seed(SEED);
+    Parser(simul, 1, 1, 1, 0, 0).evaluate(conf);
+    simul.prepare();
+}
+
+#endif
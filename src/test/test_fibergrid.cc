@@ -0,0 +1,148 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+/*
+ Benchmark of the layouts of FiberGrid, using a frame of a simulation.
+ This must be invoked in a directory containing the simulation output,
+ and compares the time needed to paint the grid and to find segments near
+ random positions, with a brute-force search over all segments, which is
+ the reference method implemented in `fiber_grid2.cc`
+*/
+
+#include <cstdio>
+#include "simul.h"
+#include "simul_prop.h"
+#include "frame_reader.h"
+#include "hand_monitor.h"
+#include "hand_prop.h"
+#include "glossary.h"
+#include "messages.h"
+#include "random.h"
+#include "timer.h"
+
+
+/// brute-force search of a segment near `pos`, as in fiber_grid2.cc
+size_t bruteForce(FiberSet const& set, Vector const& pos, real sup)
+{
+    size_t res = 0;
+    for ( Fiber const* fib=set.first(); fib; fib=fib->next() )
+    {
+        for ( unsigned p = 0; p < fib->nbSegments(); ++p )
+        {
+            real dis = INFINITY;
+            FiberSegment(fib, p).projectPoint(pos, dis);
+            res += ( dis < sup );
+        }
+    }
+    return res;
+}
+
+
+void benchmark(Simul& simul, unsigned layout, real step, real range, size_t cnt)
+{
+    FiberSet const& set = simul.fibers;
+    Space const* spc = simul.spaces.master();
+    FiberGrid grid;
+    // limit memory as done in Simul::setFiberGrid()
+    while ( grid.setGrid(spc, step) > ( 1 << 18 ) )
+        step *= 2;
+    grid.createCells(layout);
+
+    // measure the time needed to paint the grid:
+    const size_t rep = 64;
+    tic();
+    for ( size_t n = 0; n < rep; ++n )
+        grid.paintGrid(set.first(), nullptr, range);
+    double tp = toc(1e3*rep);
+
+    // generate random positions:
+    Vector * pos = new Vector[cnt];
+    for ( size_t n = 0; n < cnt; ++n )
+        pos[n] = spc->randomPlace();
+
+    // measure the time to bind a test Hand:
+    HandProp hp("test_binding");
+    hp.binding_rate  = INFINITY;
+    hp.binding_range = range;
+    hp.bind_also_end = BOTH_ENDS;
+    hp.complete(simul);
+    HandMonitor hm;
+    Hand ha(&hp, &hm);
+    size_t hit = 0;
+    tic();
+    for ( size_t n = 0; n < cnt; ++n )
+    {
+        grid.tryToAttach(pos[n], ha);
+        if ( ha.attached() )
+        {
+            ++hit;
+            ha.detach();
+        }
+    }
+    double ta = toc(cnt);
+
+    size_t err = grid.checkSegments(set, spc, range, 1024);
+    printf("layout %u : %7u cells   paint %10.1f us   attach %8.1f ns   hits %7lu   errors %lu\n",
+           layout, grid.nbCells(), tp, ta, hit, err);
+    delete[] pos;
+}
+
+
+void bruteForce(Simul& simul, real range, size_t cnt)
+{
+    FiberSet const& set = simul.fibers;
+    Space const* spc = simul.spaces.master();
+    const real sup = square(range);
+    size_t hit = 0;
+    cnt = std::max(cnt/256, (size_t)1);
+    tic();
+    for ( size_t n = 0; n < cnt; ++n )
+        hit += ( bruteForce(set, spc->randomPlace(), sup) > 0 );
+    double ta = toc(cnt);
+    printf("brute-force : %46.1f ns   hits %7lu / %lu\n", ta, hit, cnt);
+}
+
+
+int main(int argc, char* argv[])
+{
+    Cytosim::all_silent();
+
+    Glossary arg;
+    if ( arg.read_strings(argc-1, argv+1) )
+        return EXIT_FAILURE;
+
+    size_t frame = 0, cnt = 1 << 20;
+    real range = 0.05, step = 0;
+    arg.set(frame, "frame");
+    arg.set(range, "range");
+    arg.set(step, "step");
+    arg.set(cnt, "count");
+
+    Simul simul;
+    FrameReader reader;
+    RNG.seed();
+
+    try
+    {
+        simul.loadProperties();
+        reader.openFile(TRAJECTORY);
+        if ( reader.loadFrame(simul, frame) )
+        {
+            std::cerr << "Error: could not load frame " << frame << '\n';
+            return EXIT_FAILURE;
+        }
+        if ( step <= 0 )
+            step = simul.prop->binding_grid_step;
+        if ( step <= 0 )
+            step = range;
+        printf("%lu fibers, range %.3f um, grid step %.3f um\n", simul.fibers.size(), range, step);
+        benchmark(simul, 0, step, range, cnt);
+        benchmark(simul, 1, step, range, cnt);
+        bruteForce(simul, range, cnt);
+    }
+    catch( Exception & e )
+    {
+        std::cerr << "Aborted: " << e.what() << '\n';
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
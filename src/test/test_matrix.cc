@@ -13,6 +13,7 @@
 #include "matsparsesym1.h"
 #include "matsparsesym2.h"
 #include "matsparsesymblk.h"
+#include "matsparsesell.h"
 
 typedef MatrixSparseSymmetricBlock MatrixSparseSymmetricB;
 
@@ -408,6 +409,62 @@ This compares the Scalar and SIMD implementations of one matrix
 }
 
 
+/// compare isotropic multiplication of MatrixSparseSymmetric1 and its copy in SELL format
+void testMatrixSELL(const unsigned size, const unsigned fill)
+{
+    printf("------%iD size %i  filled %.3f %% :", DIM, size, fill*100.0/size/size);
+    MatrixSparseSymmetric1 mat1;
+    MatrixSparseSELL mat4;
+    
+    mat1.resize(size);
+    mat1.reset();
+    for ( unsigned n = 0; n < fill; ++n )
+    {
+        unsigned i = RNG.pint32(size);
+        unsigned j = RNG.pint32(size);
+        fillMatrixIso(mat1, std::max(i,j), std::min(i,j));
+    }
+    mat1.prepareForMultiply(DIM);
+    
+    tic();
+    for ( int n = 0; n < N_RUN; ++n )
+        mat4.build(mat1, 32);
+    double t0 = toc();
+
+    real * x = nullptr;
+    real * y = nullptr;
+    real * z = nullptr;
+    setVectors(DIM*size, x, y, z);
+    zero_real(DIM*size, y);
+
+    tic();
+    for ( int n = 0; n < N_RUN*N_MUL; ++n )
+#if ( DIM >= 3 )
+        mat1.vecMulAddIso3D(x, y);
+#else
+        mat1.vecMulAddIso2D(x, y);
+#endif
+    double t1 = toc();
+    
+    tic();
+    for ( int n = 0; n < N_RUN*N_MUL; ++n )
+#if ( DIM >= 3 )
+        mat4.vecMulAddIso3D(x, z);
+#else
+        mat4.vecMulAddIso2D(x, z);
+#endif
+    double t4 = toc();
+
+    printf("\n %20s : isomul %8.3f", mat1.what().c_str(), t1);
+    printf("\n %20s : isomul %8.3f  build %8.3f  error %e\n", mat4.what().c_str(), t4, t0,
+           diff(DIM*size, y, z) / diff(DIM*size, y, x));
+    
+    free_real(x);
+    free_real(y);
+    free_real(z);
+}
+
+
 void testMatrixBlock(const int size, const int fill)
 {
     int * inx = nullptr;
@@ -502,6 +559,13 @@ int main( int argc, char* argv[] )
         testMatrices(DIM*1359, 1<<18);
         testMatrices(DIM*2100, 1<<18);
     }
+    if ( 1 )
+    {
+        testMatrixSELL(17, 23);
+        testMatrixSELL(1024, 1<<12);
+        testMatrixSELL(8192, 1<<14);
+        testMatrixSELL(65536, 1<<16);
+    }
     if ( 0 )
     {
         //testMatrices(DIM*17, 23);
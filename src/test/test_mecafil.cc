@@ -0,0 +1,246 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+/*
+ Tests and benchmarks of the linear algebra of Mecafil, that can be run
+ without graphical display:
+ 
+     test_mecafil           compares the separate and fused multiplications
+     test_mecafil solver    compares the iterative solvers on a ring of fibers
+ 
+ The first test returns a failure if the two paths give different results
+*/
+
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "random.h"
+#include "timer.h"
+#include "cblas.h"
+#include "mecafil.h"
+#include "bicgstab.h"
+#include "idrs.h"
+
+
+/// a Mecafil that can be set without a FiberProp
+class TestFiber : public Mecafil
+{
+public:
+    
+    TestFiber(unsigned nbp, real rigidity)
+    {
+        targetSegmentation(1.0);
+        setStraight(Vector(0,0,0), Vector(1,0,0), nbp-1);
+        // bend the filament randomly:
+        for ( unsigned p = 0; p < nbPoints(); ++p )
+            setPoint(p, posPoint(p) + Vector::randU(0.1));
+        rfPointMobility = 1.0;
+        rfRigidity = rigidity;
+    }
+    
+    Property const* property() const { return nullptr; }
+    void write(Outputter&) const {}
+    void read(Inputter&, Simul&, ObjectTag) {}
+    void setDragCoefficient() {}
+    void prepareMecable() { storeDirections(); makeProjection(); }
+};
+
+
+/**
+ Compare the two paths that can be used in Meca::multiply() for a Fiber:
+ successive calls to addRigidity(), addProjectionDiff(), projectForces() and
+ blas::xpay(), or a single call to multiplyFused().
+ If `tension` is true, the fiber is stretched, such that the correction
+ to the projection P' is included. Returns the maximum difference.
+ */
+real benchmarkMultiply(unsigned nbp, unsigned cnt, bool tension)
+{
+    TestFiber fib(nbp, 1.0);
+    fib.prepareMecable();
+    
+    const unsigned n = DIM * fib.nbPoints();
+    const real alpha = -0.01;
+    real * x = new_real(n);
+    real * b = new_real(n);
+    real * y = new_real(n);
+    real * z = new_real(n);
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        x[i] = RNG.sreal();
+        b[i] = RNG.sreal();
+    }
+    
+    if ( tension )
+    {
+        // pull on the ends, to set positive Lagrange multipliers:
+        zero_real(n, y);
+        y[0] = -1.0;
+        y[n-DIM] = 1.0;
+        fib.projectForces(y, y);
+        fib.makeProjectionDiff(y);
+        if ( !fib.hasProjectionDiff() )
+        {
+            printf("error: the projection correction is not used\n");
+            return INFINITY;
+        }
+    }
+    
+    tic();
+    for ( unsigned k = 0; k < cnt; ++k )
+    {
+        copy_real(n, b, y);
+        fib.addRigidity(x, y);
+        if ( fib.hasProjectionDiff() )
+            fib.addProjectionDiff(x, y);
+        fib.projectForces(y, y);
+        blas::xpay(n, x, alpha*fib.leftoverMobility(), y);
+    }
+    double t0 = toc();
+    
+    tic();
+    for ( unsigned k = 0; k < cnt; ++k )
+    {
+        copy_real(n, b, z);
+        fib.multiplyFused(alpha, x, z);
+    }
+    double t1 = toc();
+    
+    real res = blas::max_diff(n, y, z);
+    printf("multiply %5u points %s:  separate %9.0f us  fused %9.0f us  |diff| %.2e\n",
+           fib.nbPoints(), tension?"P'":"  ", t0, t1, res);
+    
+    free_real(x);
+    free_real(b);
+    free_real(y);
+    free_real(z);
+    return res;
+}
+
+
+/**
+ A system of Fibers linked into a ring by springs connecting their vertices,
+ with the same structure as the system solved in Meca:
+     Y = X - time_step * mobility * P * ( Rigidity + Links ) * X
+ */
+class TestSystem
+{
+    std::vector<TestFiber*> fibs;
+    unsigned nbp;
+    real stiffness;
+    real beta;
+    
+public:
+    
+    TestSystem(unsigned nbf, unsigned n, real k, real dt)
+    {
+        nbp = n;
+        stiffness = k;
+        beta = -dt;
+        for ( unsigned f = 0; f < nbf; ++f )
+        {
+            fibs.push_back(new TestFiber(nbp, 1.0));
+            fibs.back()->prepareMecable();
+        }
+    }
+    
+    ~TestSystem()
+    {
+        for ( TestFiber * f : fibs )
+            delete(f);
+    }
+    
+    size_t dimension() const { return DIM * nbp * fibs.size(); }
+    
+    void multiply(const real* X, real* Y) const
+    {
+        const size_t N = DIM * nbp;
+        const size_t nbf = fibs.size();
+        for ( size_t f = 0; f < nbf; ++f )
+        {
+            const real * x = X + N * f;
+            const real * z = X + N * (( f + 1 ) % nbf );
+            const real * a = X + N * (( f + nbf - 1 ) % nbf );
+            real * y = Y + N * f;
+            for ( size_t i = 0; i < N; ++i )
+                y[i] = stiffness * ( z[i] + a[i] - 2 * x[i] );
+            fibs[f]->multiplyFused(beta, x, y);
+        }
+    }
+    
+    void precondition(const real* X, real* Y) const
+    {
+        copy_real(dimension(), X, Y);
+    }
+};
+
+
+/**
+ Compare the number of matrix-vector products and the time needed by the
+ iterative solvers to reach the same residual
+ */
+void benchmarkSolvers(unsigned nbf, unsigned nbp)
+{
+    TestSystem sys(nbf, nbp, 100.0, 0.1);
+    const size_t dim = sys.dimension();
+    real * rhs = new_real(dim);
+    real * sol = new_real(dim);
+    real * res = new_real(dim);
+    for ( size_t i = 0; i < dim; ++i )
+        rhs[i] = RNG.sreal();
+    
+    LinearSolvers::Allocator allocator;
+    const real tol = 1e-6;
+    printf("system %3u fibers of %4u points:\n", nbf, nbp);
+    
+    for ( int m = 0; m < 5; ++m )
+    {
+        LinearSolvers::Monitor monitor(2*dim, tol);
+        zero_real(dim, sol);
+        const char * name = "";
+        tic();
+        switch ( m )
+        {
+            case 0: name = "BCGS";    LinearSolvers::BCGS(sys, rhs, sol, monitor, allocator); break;
+            case 1: name = "PBCGS";   LinearSolvers::PBCGS(sys, rhs, sol, monitor, allocator); break;
+            case 2: name = "IDR(2)";  LinearSolvers::IDRS(sys, rhs, sol, 2, monitor, allocator); break;
+            case 3: name = "IDR(4)";  LinearSolvers::IDRS(sys, rhs, sol, 4, monitor, allocator); break;
+            case 4: name = "IDR(8)";  LinearSolvers::IDRS(sys, rhs, sol, 8, monitor, allocator); break;
+        }
+        double t = toc();
+        // verify the true residual:
+        sys.multiply(sol, res);
+        blas::xaxpy(dim, -1.0, rhs, 1, res, 1);
+        printf("    %-8s count %5lu  flag %i  residual %.2e  true %.2e  %9.0f us\n", name,
+               monitor.count(), monitor.flag(), monitor.residual(), blas::nrm8(dim, res), t);
+    }
+    free_real(rhs);
+    free_real(sol);
+    free_real(res);
+}
+
+
+int main(int argc, char* argv[])
+{
+    RNG.seed();
+    
+    if ( argc > 1 && 0 == strcmp(argv[1], "solver") )
+    {
+        benchmarkSolvers(16, 64);
+        benchmarkSolvers(64, 64);
+        benchmarkSolvers(16, 512);
+        return EXIT_SUCCESS;
+    }
+    
+    real err = 0;
+    for ( unsigned nbp = 16; nbp <= 4096; nbp *= 4 )
+    {
+        err = std::max(err, benchmarkMultiply(nbp, ( 1 << 22 ) / nbp, false));
+        err = std::max(err, benchmarkMultiply(nbp, ( 1 << 22 ) / nbp, true));
+    }
+    if ( !( err < 1e-6 ) )
+    {
+        printf("error: the fused multiplication differs from the reference\n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
@@ -0,0 +1,142 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+/*
+ Test of the coarse-grained diffusion of `fast_diffusion` with `reservoir_step`:
+
+     test_reservoir
+
+ 1. Free Couples are created near the center of a sphere, and should spread
+    uniformly by hopping between voxels. The fraction of Couples found in
+    concentric shells of equal volume is compared to the uniform expectation,
+    and to `fast_diffusion` without reservoir.
+ 2. With filaments, the number of attached Hands at steady state is compared
+    to the value obtained without reservoir, which tests the binding rate.
+
+ The tolerances are derived from the sampling errors, and the program returns
+ a failure if any value deviates by more than 4 standard deviations.
+ The random number generator is seeded, such that the results are reproducible.
+
+ With the reservoir, fewer Hands are attached if the voxels are small. On the
+ fibers, the density of binding sites matches the global concentration of free
+ Couples within 1%, but a binding site is lost if the Couples of its voxel have
+ all been used in the same time step. This happens where the fibers are bundled,
+ and limits the binding to the Couples present in each voxel. The fraction of
+ sites lost was 0.03% with `reservoir_step = 1`, 0.5% with 0.5, and 4% with 0.25.
+*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include "simul.h"
+#include "simul_prop.h"
+#include "messages.h"
+#include "exceptions.h"
+#include "test_couple.h"
+
+
+/// number of concentric shells of equal volume
+const int SHELLS = 4;
+
+
+/**
+ Distribute free Couples initially placed near the center, and returns
+ the largest deviation of the fraction in a shell from 1/SHELLS, in units of
+ the standard deviation expected if the Couples are distributed uniformly.
+ */
+real profile(std::string const& couple_opt)
+{
+    Simul simul;
+    setupCouples(simul, "", couple_opt, 0, 20000, "ball 1");
+
+    for ( int n = 0; n < 500; ++n )
+        simul.step();
+    simul.relax();
+
+    size_t cnt[SHELLS] = { 0 };
+    size_t sum = 0;
+    for ( Couple * c = simul.couples.firstFF(); c; c = c->next() )
+    {
+        // fraction of volume enclosed by the position:
+        real v = std::pow(c->position().norm() / RADIUS, DIM);
+        ++cnt[std::min(SHELLS-1, (int)( v * SHELLS ))];
+        ++sum;
+    }
+
+    // the counts follow a binomial distribution with p = 1 / SHELLS
+    const real sigma = std::sqrt((SHELLS-1) / (real)std::max(sum, size_t(1)));
+    real dev = 0;
+    printf("%-30s shells", couple_opt.c_str());
+    for ( int s = 0; s < SHELLS; ++s )
+    {
+        real f = SHELLS * (real)cnt[s] / (real)sum;
+        printf(" %.3f", f);
+        dev = std::max(dev, std::abs(f - 1) / sigma);
+    }
+    printf("  +/- %.3f\n", sigma);
+    return dev;
+}
+
+
+/**
+ Returns the average number of attached Hands at steady state, and sets `sigma`
+ with its standard error. The attached Hands are counted as a Poisson variable,
+ with a correlation time equal to the lifetime of an attached Hand.
+ */
+real binding(std::string const& couple_opt, real& sigma)
+{
+    const int cnt = 1000;
+    Simul simul;
+    setupCouples(simul, "", couple_opt, 64, 20000, "inside");
+
+    for ( int n = 0; n < 200; ++n )
+        simul.step();
+
+    real sum = 0;
+    for ( int n = 0; n < cnt; ++n )
+    {
+        simul.step();
+        CoupleSet const& set = simul.couples;
+        sum += set.sizeAF() + set.sizeFA() + 2 * set.sizeAA();
+    }
+    simul.relax();
+    sum /= cnt;
+    sigma = std::sqrt(2 * sum / ( UNBINDING * cnt * TIME_STEP ));
+    printf("%-30s attached hands %.1f +/- %.1f\n", couple_opt.c_str(), sum, sigma);
+    return sum;
+}
+
+
+int main(int argc, char* argv[])
+{
+    Cytosim::all_silent();
+
+    int res = EXIT_SUCCESS;
+    try
+    {
+        for ( std::string opt : { "", "reservoir_step = 1;", "reservoir_step = 0.5;" } )
+        {
+            if ( profile(opt) > 4 )
+            {
+                printf("FAILED: non-uniform concentration\n");
+                res = EXIT_FAILURE;
+            }
+        }
+        real sig = 0;
+        real ref = binding("", sig);
+        for ( std::string opt : { "reservoir_step = 1;", "reservoir_step = 0.5;" } )
+        {
+            real err = 0;
+            real val = binding(opt, err);
+            if ( std::abs(val - ref) > 4 * std::sqrt(sig * sig + err * err) )
+            {
+                printf("FAILED: different binding\n");
+                res = EXIT_FAILURE;
+            }
+        }
+    }
+    catch( Exception & e )
+    {
+        std::cerr << "Error: " << e.brief() << '\n';
+        return EXIT_FAILURE;
+    }
+    return res;
+}
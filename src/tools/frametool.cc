@@ -16,6 +16,10 @@
  
  Another tool 'sieve' can be used to read/write object-files,
  allowing finer manipulation of the simulation frames.
+
+ 'frametool reindex' rebuilds the index file (e.g. "objects.idx") that
+ gives the position of each frame, and which is used by other tools
+ to access frames directly. The format is described in FrameIndex.
 */
 
 #include <errno.h>
@@ -26,9 +30,10 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include "frame_index.h"
 
 
-enum { COUNT, COPY, LAST, SIZE, EPID, SPLIT };
+enum { COUNT, COPY, LAST, SIZE, EPID, SPLIT, REINDEX };
 enum { UNKNOWN, FRAME_START, FRAME_SECTION, FRAME_END };
 
 FILE * output = stdout;
@@ -337,6 +342,54 @@ void split(FILE * in)
     }
 }
 
+
+/**
+ Write the index of the frames in `in`, using FrameIndex::record(), such that
+ the file is the same as the one made by the simulation. A frame extends from
+ the end of the previous frame, to the end of its `#end` line, plus the blank
+ line that follows, as written by Simul::writeObjects().
+ */
+void reindex(FILE* in, const char name[])
+{
+    size_t frm = 0;
+    long long start = 0;
+    bool open = false;
+    int code = 0;
+    
+    while ( code != EOF )
+    {
+        long long pos = ftello(in);
+        code = whatline(in, nullptr);
+        
+        if ( code == FRAME_START )
+        {
+            // a frame without `#end` extends until the next frame:
+            if ( open )
+            {
+                FrameIndex::record(name, start, pos, frame_time);
+                start = pos;
+                ++frm;
+            }
+            open = true;
+            frame_time = 0;
+        }
+        else if ( code == FRAME_END && open )
+        {
+            long long end = ftello(in);
+            int c = getc(in);
+            if ( c == '\n' )
+                ++end;
+            else if ( c != EOF )
+                ungetc(c, in);
+            FrameIndex::record(name, start, end, frame_time);
+            start = end;
+            open = false;
+            ++frm;
+        }
+    }
+    fprintf(stderr, "%s: %lu frames\n", FrameIndex::filename(name).c_str(), frm);
+}
+
 //=============================================================================
 
 void help()
@@ -350,6 +403,7 @@ void help()
     printf("    frametool FILENAME pid=PID\n");
     printf("    frametool FILENAME INDICES\n");
     printf("    frametool FILENAME split\n");
+    printf("    frametool FILENAME reindex\n");
     printf(" where INDICES specifies an integer or a range of integers as:\n");
     printf("        INDEX\n");
     printf("        START:END\n");
@@ -358,6 +412,7 @@ void help()
     printf("        START:INCREMENT:\n");
     printf("        last\n");
     printf(" The option 'split' will create one file for each frame in the input\n");
+    printf(" The option 'reindex' will write the index of the frames (e.g. objects.idx)\n");
     printf("Examples:\n");
     printf("    frametool objects.cmo 0:2:\n");
     printf("    frametool objects.cmo 0:10\n");
@@ -427,6 +482,8 @@ int main(int argc, char* argv[])
                 mode = LAST;
             else if ( 0 == strncmp(cmd, "split", 5) )
                 mode = SPLIT;
+            else if ( 0 == strncmp(cmd, "reindex", 7) )
+                mode = REINDEX;
             else if ( 0 == strncmp(cmd, "size", 4) || *cmd == '+' )
                 mode = SIZE;
             else if ( 0 == strncmp(cmd, "count", 5) )
@@ -464,6 +521,8 @@ int main(int argc, char* argv[])
         countFrame(file_in, file);
     else if ( mode == SIZE )
         sizeFrame(file);
+    else if ( mode == REINDEX )
+        reindex(file, file_in);
     else
     {
         if ( *fileout )
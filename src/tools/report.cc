@@ -15,18 +15,38 @@
 #include "splash.h"
 #include "parser.h"
 #include "simul.h"
+#include "thread_pool.h"
+#include "modulo.h"
+
+extern Modulo const* modulo;
 
 int verbose = 1;
 int prefix = 0;
 size_t cnt = 0;
 
 
+/// a report requested on the command line, and its destination
+struct Request
+{
+    std::string     what;
+    std::string     file;
+    std::ostream *  os;
+    std::ofstream   ofs;
+    
+    Request(std::string const& w, std::string const& f) : what(w), file(f), os(&std::cout) {}
+};
+
+/// list of reports, all produced from the same frames
+std::vector<Request*> requests;
+
+
 void help(std::ostream& os)
 {
     os << "Cytosim-report "<<DIM<<"D, file version " << Simul::currentFormatID << '\n';
     os << "       generates reports/statistics from a trjacetory file\n";
     os << "Syntax:\n";
     os << "       report [time] WHAT [OPTIONS]\n";
+    os << "       report [time] WHAT=FILE_NAME [WHAT=FILE_NAME ...] [OPTIONS]\n";
     os << "Options:\n";
     os << "       precision=INTEGER\n";
     os << "       column=INTEGER\n";
@@ -35,6 +55,7 @@ void help(std::ostream& os)
     os << "       period=INTEGER\n";
     os << "       input=FILE_NAME\n";
     os << "       output=FILE_NAME\n";
+    os << "       threads=INTEGER\n";
     os << "\n";
     os << "  This tool must be invoked in a directory containing the simulation output,\n";
     os << "  and it will generate reports by calling Simul::report(). The only required\n";
@@ -46,12 +67,19 @@ void help(std::ostream& os)
     os << "  The input trajectory file is `objects.cmo` unless otherwise specified.\n";
     os << "  The result is sent to standard output unless a file is specified as `output`\n";
     os << "  Attention: there should be no whitespace in any of the option.\n";
+    os << "  Several reports can be made in one pass, by specifying `WHAT=FILE_NAME` pairs,\n";
+    os << "  where WHAT should contain a colon. Each frame is then read only once, and the\n";
+    os << "  reports are sent to the corresponding files. With `threads=N`, N frames are\n";
+    os << "  read and processed in parallel, each by a different copy of the simulation.\n";
+    os << "  This is not possible with periodic boundary conditions, or for reports that\n";
+    os << "  depend on the previous frame or use random numbers, such as fiber:displacement.\n";
     os << "\n";
     os << "Examples:\n";
     os << "       report fiber:points\n";
     os << "       report fiber:points frame=10 > fibers.txt\n";
     os << "       report fiber:points frame=10,20 > fibers.txt\n";
     os << "       report fiber:points period=8 > fibers.txt\n";
+    os << "       report fiber:points=fibers.txt single:position=singles.txt threads=4\n";
 }
 
 //------------------------------------------------------------------------------
@@ -99,15 +127,21 @@ void report_prefix(Simul const& simul, std::ostream& os, std::string const& what
 }
 
 
+/// make one report, which may throw an exception
+void report_frame(Simul const& simul, std::ostream& os, std::string const& what, int frm, Glossary& opt)
+{
+    if ( prefix )
+        report_prefix(simul, os, what, frm, opt);
+    else
+        report_raw(simul, os, what, frm, opt);
+}
+
+
 void report(Simul const& simul, std::ostream& os, std::string const& what, int frm, Glossary& opt)
 {
-    ++cnt;
     try
     {
-        if ( prefix )
-            report_prefix(simul, os, what, frm, opt);
-        else
-            report_raw(simul, os, what, frm, opt);
+        report_frame(simul, os, what, frm, opt);
     }
     catch( Exception & e )
     {
@@ -117,6 +151,137 @@ void report(Simul const& simul, std::ostream& os, std::string const& what, int f
 }
 
 
+/// load frame `frm`, returning 0 if successful, or aborting if the frame cannot be decoded
+int load_frame(FrameReader& reader, Simul& simul, unsigned frm)
+{
+    try
+    {
+        return reader.loadFrame(simul, frm);
+    }
+    catch( Exception & e )
+    {
+        std::cerr << "Aborted: frame " << frm << ": " << e.what() << '\n';
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/// load the next frame, returning 0 if successful, or aborting if the frame cannot be decoded
+int load_next_frame(FrameReader& reader, Simul& simul)
+{
+    try
+    {
+        return reader.loadNextFrame(simul);
+    }
+    catch( Exception & e )
+    {
+        std::cerr << "Aborted: frame " << reader.currentFrame()+1 << ": " << e.what() << '\n';
+        exit(EXIT_FAILURE);
+    }
+}
+
+
+/// make all requested reports for the current frame
+void report_all(Simul const& simul, int frm, Glossary& opt)
+{
+    for ( Request * req : requests )
+    {
+        ++cnt;
+        report(simul, *req->os, req->what, frm, opt);
+    }
+}
+
+
+/**
+ Returns a reason for which the reports cannot be made by multiple threads,
+ or nullptr if they can. Reports that depend on the previous frame must process
+ the frames in order, and those using the random number generator share it.
+ The Modulo is a global variable, that is set when the Space is loaded.
+ */
+const char * sequential_reason()
+{
+    if ( modulo )
+        return "periodic boundary conditions";
+    for ( Request const* req : requests )
+    {
+        for ( const char * s : { "fiber:displacement", "fiber:speckle", "fiber:sample" } )
+            if ( req->what.find(s) != std::string::npos )
+                return s;
+    }
+    return nullptr;
+}
+
+
+/// a worker, with its own copy of the simulation and of the options
+struct Worker
+{
+    Simul       simul;
+    FrameReader reader;
+    Glossary    opt;
+};
+
+
+/**
+ Process the frames given in `frames[]` with multiple threads, in batches.
+ Within each batch, each thread loads and reports a contiguous range of frames,
+ in its own Simul, and the results are written in order after the batch.
+ If `stop_at_end`, a missing frame indicates the end of the trajectory,
+ and otherwise this is an error.
+ The workers record errors, and the program is stopped by the main thread,
+ after all workers have finished.
+ */
+int report_parallel(std::vector<Worker*>& workers, ThreadPool& pool, std::vector<unsigned> const& frames, bool stop_at_end)
+{
+    const size_t nbr = requests.size();
+    const size_t nbf = frames.size();
+    std::vector<std::string> res(nbf*nbr);
+    std::vector<char> missing(nbf, 0);
+    std::vector<std::string> errors(nbf);
+    
+    auto func = [&](size_t i, unsigned rank)
+    {
+        Worker * w = workers[rank];
+        try
+        {
+            if ( w->reader.loadFrame(w->simul, frames[i]) )
+            {
+                missing[i] = 1;
+                return;
+            }
+            for ( size_t r = 0; r < nbr; ++r )
+            {
+                std::stringstream ss;
+                report_frame(w->simul, ss, requests[r]->what, frames[i], w->opt);
+                res[i*nbr+r] = ss.str();
+            }
+        }
+        catch( Exception & e )
+        {
+            errors[i] = e.what();
+        }
+    };
+    pool.run(nbf, nullptr, func);
+    
+    for ( size_t i = 0; i < nbf; ++i )
+    {
+        if ( errors[i].size() )
+        {
+            std::cerr << "Aborted: frame " << frames[i] << ": " << errors[i] << '\n';
+            exit(EXIT_FAILURE);
+        }
+        if ( missing[i] )
+        {
+            if ( stop_at_end )
+                return 1;
+            std::cerr << "Error: missing frame " << frames[i] << '\n';
+            exit(EXIT_FAILURE);
+        }
+        for ( size_t r = 0; r < nbr; ++r )
+            *requests[r]->os << res[i*nbr+r];
+    }
+    return 0;
+}
+
 //------------------------------------------------------------------------------
 
 
@@ -138,9 +303,7 @@ int main(int argc, char* argv[])
     Glossary arg;
 
     std::string input = TRAJECTORY;
-    std::string str, what;
-    std::ostream * osp = &std::cout;
-    std::ofstream ofs;
+    std::string str;
 
     // check for prefix:
     int ax = 1;
@@ -155,8 +318,20 @@ int main(int argc, char* argv[])
         ++ax;
     }
     
-    what = argv[ax++];
-    if ( arg.read_strings(argc-ax, argv+ax) )
+    // the first argument is always a report, and `WHAT=FILE` specifies other reports:
+    std::vector<char*> opts;
+    for ( int i = ax; i < argc; ++i )
+    {
+        std::string s(argv[i]);
+        size_t e = s.find('=');
+        if ( e != std::string::npos && s.find(':') < e )
+            requests.push_back(new Request(s.substr(0, e), s.substr(e+1)));
+        else if ( i == ax )
+            requests.push_back(new Request(s, ""));
+        else
+            opts.push_back(argv[i]);
+    }
+    if ( arg.read_strings(opts.size(), opts.data()) )
         return EXIT_FAILURE;
 
 #ifdef BACKWARD_COMPATIBILITY
@@ -186,17 +361,21 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    if ( arg.set(str, "output") )
+    arg.set(str, "output");
+    for ( Request * req : requests )
     {
-        try {
-            ofs.open(str.c_str());
-        }
-        catch( ... )
+        if ( req->file.empty() )
+            req->file = str;
+        if ( req->file.size() )
         {
-            std::clog << "Cannot open output file\n";
-            return EXIT_FAILURE;
+            req->ofs.open(req->file.c_str());
+            if ( !req->ofs.good() )
+            {
+                std::clog << "Cannot open output file `" << req->file << "'\n";
+                return EXIT_FAILURE;
+            }
+            req->os = &req->ofs;
         }
-        osp = &ofs;
     }
     
     Cytosim::all_silent();
@@ -206,8 +385,11 @@ int main(int argc, char* argv[])
         period = 0;
     arg.set(period, "period");
     
+    unsigned nb_threads = 1;
+    arg.set(nb_threads, "threads");
+    
     // process first record, at index 'frame':
-    if ( reader.loadFrame(simul, frame) )
+    if ( load_frame(reader, simul, frame) )
     {
         std::cerr << "Error: missing frame " << frame << '\n';
         return EXIT_FAILURE;
@@ -218,17 +400,80 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    report(simul, *osp, what, frame, arg);
+    report_all(simul, frame, arg);
 
-    if ( arg.nb_values("frame") > 1 )
+    if ( nb_threads > 1 )
+    {
+        const char * reason = sequential_reason();
+        if ( reason )
+        {
+            std::cerr << "Warning: using one thread, because of " << reason << '\n';
+            nb_threads = 1;
+        }
+    }
+
+    if ( nb_threads > 1 && ( period > 0 || arg.nb_values("frame") > 1 ) )
+    {
+        // create workers, each with a copy of the simulation:
+        ThreadPool pool;
+        pool.start(nb_threads);
+        std::vector<Worker*> workers;
+        try
+        {
+            for ( unsigned n = 0; n < nb_threads; ++n )
+            {
+                Worker * w = new Worker;
+                w->simul.loadProperties();
+                w->reader.openFile(input);
+                w->opt = arg;
+                workers.push_back(w);
+            }
+        }
+        catch( Exception & e )
+        {
+            std::clog << "Aborted: " << e.what() << '\n';
+            return EXIT_FAILURE;
+        }
+        
+        // process frames in batches, a few per thread:
+        const size_t batch = 4 * nb_threads;
+        std::vector<unsigned> frames;
+        // as in the serial case below, multiple frame indices take precedence:
+        if ( arg.nb_values("frame") > 1 )
+        {
+            unsigned s = 1;
+            do {
+                frames.clear();
+                while ( frames.size() < batch && arg.set(frame, "frame", s) )
+                {
+                    frames.push_back(frame);
+                    ++s;
+                }
+                report_parallel(workers, pool, frames, false);
+            } while ( frames.size() == batch );
+        }
+        else
+        {
+            unsigned f = frame;
+            do {
+                frames.clear();
+                while ( frames.size() < batch )
+                    frames.push_back(f += period);
+            } while ( 0 == report_parallel(workers, pool, frames, true) );
+        }
+        
+        for ( Worker * w : workers )
+            delete(w);
+    }
+    else if ( arg.nb_values("frame") > 1 )
     {
         // multiple record indices were specified:
         unsigned s = 1;
         while ( arg.set(frame, "frame", s) )
         {
             // try to load the specified frame:
-            if ( 0 == reader.loadFrame(simul, frame) )
-                report(simul, *osp, what, frame, arg);
+            if ( 0 == load_frame(reader, simul, frame) )
+                report_all(simul, frame, arg);
             else
             {
                 std::cerr << "Error: missing frame " << frame << '\n';
@@ -241,16 +486,20 @@ int main(int argc, char* argv[])
     {
         // process every 'period' record:
         unsigned f = frame;
-        while ( 0 == reader.loadNextFrame(simul)  )
+        while ( 0 == load_next_frame(reader, simul) )
         {
             ++f;
             if ( f % period == frame % period )
-                report(simul, *osp, what, f, arg);
+                report_all(simul, f, arg);
         }
     }
     
-    if ( ofs.is_open() )
-        ofs.close();
+    for ( Request * req : requests )
+    {
+        if ( req->ofs.is_open() )
+            req->ofs.close();
+        delete(req);
+    }
 
     /// check if all specified parameters were used:
     arg.print_warning(std::cerr, cnt, "\n");
@@ -18,6 +18,7 @@ void help()
     printf("\n");
     printf("   The system is written in the latest format, in either binary or text.\n");
     printf("   A category of objects can be removed with option skip=WHAT.\n");
+    printf("   Compressed trajectories can be read, and written with option compress.\n");
     printf("   If the specified output file already exists, data is appended to it.\n");
     printf("\n");
     printf("Usage:\n");
@@ -27,10 +28,12 @@ void help()
     printf("    binary=1     generate output in binary format\n");
     printf("    skip=WHAT    remove all objects of class WHAT\n");
     printf("    frame=INDEX  process only specified frame\n");
+    printf("    compress=PRECISION, KEYFRAME  generate compressed output\n");
     printf("\n");
     printf("Example:\n");
     printf("    sieve objects.cmo objects.txt binary=0\n");
     printf("    sieve objects.cmo objects.txt binary=0 skip=couple\n");
+    printf("    sieve objects.cmo small.cmo compress=0.0001,16\n");
 }
 
 
@@ -58,6 +61,20 @@ int main(int argc, char* argv[])
     bool binary = true;
     arg.set(binary, "binary");
     arg.set(simul.prop->skip_free_couple, "skip_free_couple");
+    arg.set(simul.prop->compress, "compress");
+    arg.set(simul.prop->keyframe, "compress", 1);
+    
+    // these values are not checked by SimulProp::complete():
+    if ( simul.prop->compress < 0 )
+    {
+        std::cerr << "Error: compress must be >= 0\n";
+        return EXIT_FAILURE;
+    }
+    if ( simul.prop->keyframe < 1 )
+    {
+        std::cerr << "Error: compress[1], the interval between keyframes, must be >= 1\n";
+        return EXIT_FAILURE;
+    }
     
     Inputter in(DIM);
     try {